@@ -0,0 +1,140 @@
+#include "bench.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "ahrs.h"
+
+/*
+ * One attitude update per gyro sample
+ * Compares the fixed point filter against the textbook single precision
+ * Mahony update, which on the M0+ runs entirely in the soft float library.
+ * The mag cases are the worst case, it only arrives on some samples.
+ */
+
+#define SAMPLES 64
+
+static q16_t   gyro_q16[SAMPLES][3];
+static float   gyro_f[SAMPLES][3];
+static int32_t acc[SAMPLES][3];
+static float   acc_f[SAMPLES][3];
+static int32_t mag[SAMPLES][3];
+static float   mag_f[SAMPLES][3];
+
+static ahrs_t ahrs;
+static float q_f[4] = {1, 0, 0, 0};
+
+static const uint32_t DT_US = 1316;  // 760 Hz
+
+
+static void mahony_float(const float *gyro, const float *a, const float *m) {
+    float q0 = q_f[0], q1 = q_f[1], q2 = q_f[2], q3 = q_f[3];
+    float gx = gyro[0], gy = gyro[1], gz = gyro[2];
+    const float two_kp = 2 * AHRS_DEFAULT_KP;
+    const float dt = DT_US * 1e-6f;
+
+    float r = 1 / sqrtf(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+    float ax = a[0] * r, ay = a[1] * r, az = a[2] * r;
+    float ex = 0, ey = 0, ez = 0;
+
+    float half_vx = q1 * q3 - q0 * q2;
+    float half_vy = q0 * q1 + q2 * q3;
+    float half_vz = q0 * q0 - 0.5f + q3 * q3;
+    ex = ay * half_vz - az * half_vy;
+    ey = az * half_vx - ax * half_vz;
+    ez = ax * half_vy - ay * half_vx;
+
+    if (m != NULL) {
+        r = 1 / sqrtf(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+        float mx = m[0] * r, my = m[1] * r, mz = m[2] * r;
+
+        float hx = 2 * (mx * (0.5f - q2 * q2 - q3 * q3) + my * (q1 * q2 - q0 * q3) + mz * (q1 * q3 + q0 * q2));
+        float hy = 2 * (mx * (q1 * q2 + q0 * q3) + my * (0.5f - q1 * q1 - q3 * q3) + mz * (q2 * q3 - q0 * q1));
+        float bx = sqrtf(hx * hx + hy * hy);
+        float bz = 2 * (mx * (q1 * q3 - q0 * q2) + my * (q2 * q3 + q0 * q1) + mz * (0.5f - q1 * q1 - q2 * q2));
+
+        float half_wx = bx * (0.5f - q2 * q2 - q3 * q3) + bz * (q1 * q3 - q0 * q2);
+        float half_wy = bx * (q1 * q2 - q0 * q3) + bz * (q0 * q1 + q2 * q3);
+        float half_wz = bx * (q0 * q2 + q1 * q3) + bz * (0.5f - q1 * q1 - q2 * q2);
+        ex += my * half_wz - mz * half_wy;
+        ey += mz * half_wx - mx * half_wz;
+        ez += mx * half_wy - my * half_wx;
+    }
+
+    gx = (gx + two_kp * ex) * 0.5f * dt;
+    gy = (gy + two_kp * ey) * 0.5f * dt;
+    gz = (gz + two_kp * ez) * 0.5f * dt;
+
+    q_f[0] = q0 - q1 * gx - q2 * gy - q3 * gz;
+    q_f[1] = q1 + q0 * gx + q2 * gz - q3 * gy;
+    q_f[2] = q2 + q0 * gy - q1 * gz + q3 * gx;
+    q_f[3] = q3 + q0 * gz + q1 * gy - q2 * gx;
+
+    r = 1 / sqrtf(q_f[0] * q_f[0] + q_f[1] * q_f[1] + q_f[2] * q_f[2] + q_f[3] * q_f[3]);
+    for (int i = 0; i < 4; i++) q_f[i] *= r;
+}
+
+
+static void update_float() {
+    for (int i = 0; i < SAMPLES; i++) mahony_float(gyro_f[i], acc_f[i], NULL);
+    bench_sink = (int32_t)(q_f[0] * 1000);
+}
+
+
+static void update_float_mag() {
+    for (int i = 0; i < SAMPLES; i++) mahony_float(gyro_f[i], acc_f[i], mag_f[i]);
+    bench_sink = (int32_t)(q_f[0] * 1000);
+}
+
+
+static void update_fixed() {
+    for (int i = 0; i < SAMPLES; i++) ahrs_update(&ahrs, gyro_q16[i], acc[i], NULL, DT_US);
+    bench_sink = ahrs.q[0];
+}
+
+
+static void update_fixed_mag() {
+    for (int i = 0; i < SAMPLES; i++) ahrs_update(&ahrs, gyro_q16[i], acc[i], mag[i], DT_US);
+    bench_sink = ahrs.q[0];
+}
+
+
+void bench_ahrs() {
+    // Gentle motion around level with noise, as from the GY-89 at rest
+    uint32_t seed = 1;
+    for (int i = 0; i < SAMPLES; i++) {
+        int32_t noise[9];
+        for (int j = 0; j < 9; j++) {
+            seed = seed * 1664525 + 1013904223;
+            noise[j] = (int32_t)(seed >> 24) - 128;
+        }
+
+        for (int j = 0; j < 3; j++) {
+            gyro_q16[i][j] = noise[j] * 64;
+            gyro_f[i][j]   = q16_to_float(gyro_q16[i][j]);
+        }
+        acc[i][0] = noise[3];
+        acc[i][1] = noise[4];
+        acc[i][2] = 8192 + noise[5];
+        mag[i][0] = 1375 + noise[6];
+        mag[i][1] = noise[7];
+        mag[i][2] = -3250 + noise[8];
+        for (int j = 0; j < 3; j++) {
+            acc_f[i][j] = acc[i][j];
+            mag_f[i][j] = mag[i][j];
+        }
+    }
+
+    ahrs_init(&ahrs, AHRS_DEFAULT_KP, AHRS_DEFAULT_KI);
+
+    bench_run("ahrs update, float", SAMPLES, update_float);
+    bench_run("ahrs update, q30", SAMPLES, update_fixed);
+    bench_run("ahrs update + mag, float", SAMPLES, update_float_mag);
+    bench_run("ahrs update + mag, q30", SAMPLES, update_fixed_mag);
+
+    Attitude att = ahrs_attitude(&ahrs);
+    float err = 0;
+    for (int i = 0; i < 4; i++) err = fmaxf(err, fabsf(q_f[i] - q30_to_float(ahrs.q[i])));
+    printf("ahrs q30 vs float after %d updates, max |dq| %.6f, roll %.2f pitch %.2f yaw %.2f\n",
+           2 * BENCH_ITERATIONS * SAMPLES, err, att.roll, att.pitch, att.yaw);
+}
@@ -0,0 +1,96 @@
+#include "bench.h"
+#include <math.h>
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "altitude.h"
+
+/*
+ * Pressure to altitude, once per barometer sample
+ * Compares the datasheet formula through pow() in double, as the BMP180
+ * driver used to, and in single precision, against the interpolated
+ * table. Then sweeps the table against the exact formula and checks it
+ * stays within the bounds altitude.h gives.
+ */
+
+#define SAMPLES 64
+
+// Lowest p / QNH of each band and the error altitude.h promises in it
+typedef struct error_bound {
+    double min_ratio;
+    double max_cm;
+    const char *range;
+} error_bound_t;
+
+static const error_bound_t BOUNDS[] = {
+    {0.75, 2.5, "2.4 km"},
+    {0.5,  5,   "5.5 km"},
+    {0.25, 17,  "10 km"},
+};
+
+static int32_t pressure_pa[SAMPLES];
+
+
+static void altitude_double() {
+    for (int i = 0; i < SAMPLES; i++) {
+        bench_sink = (int32_t)(4433000 * (1 - pow(pressure_pa[i] / 101325.0, 1 / 5.255)));
+    }
+}
+
+
+static void altitude_float() {
+    for (int i = 0; i < SAMPLES; i++) {
+        bench_sink = (int32_t)(4433000 * (1 - powf(pressure_pa[i] / 101325.0f, 1 / 5.255f)));
+    }
+}
+
+
+static void altitude_table() {
+    for (int i = 0; i < SAMPLES; i++) {
+        bench_sink = altitude_cm(pressure_pa[i]);
+    }
+}
+
+
+/*
+ * Largest error against the exact formula for p / QNH down to min_ratio
+ */
+static double worst_error_cm(uint32_t qnh, double min_ratio) {
+    double worst = 0;
+
+    for (int32_t p = (int32_t)(qnh * min_ratio) + 1; p <= (int32_t)(qnh * 1.25); p += 7) {
+        double exact = 4433000 * (1 - pow((double)p / qnh, 1 / 5.255));
+        double error = fabs(altitude_cm(p) - exact);
+        if (error > worst) worst = error;
+    }
+    return worst;
+}
+
+
+void bench_altitude() {
+    // Sea level to a few hundred metres, as in a flight
+    uint32_t seed = 1;
+    for (int i = 0; i < SAMPLES; i++) {
+        seed = seed * 1664525 + 1013904223;
+        pressure_pa[i] = 97000 + (int32_t)(seed >> 20);
+    }
+
+    bench_run("altitude, pow double", SAMPLES, altitude_double);
+    bench_run("altitude, powf", SAMPLES, altitude_float);
+    bench_run("altitude, table", SAMPLES, altitude_table);
+
+    static const uint32_t QNH[] = {95000, ALTITUDE_STANDARD_QNH_PA, 104000};
+    for (int i = 0; i < 3; i++) {
+        altitude_set_qnh(QNH[i]);
+        printf("altitude table vs exact, qnh %lu Pa: max error", (unsigned long)QNH[i]);
+
+        bool ok = true;
+        for (size_t b = 0; b < sizeof(BOUNDS) / sizeof(BOUNDS[0]); b++) {
+            double worst = worst_error_cm(QNH[i], BOUNDS[b].min_ratio);
+            printf("%s %.2f cm to %s", b > 0 ? "," : "", worst, BOUNDS[b].range);
+            ok &= worst <= BOUNDS[b].max_cm;
+        }
+        printf("\n");
+        bench_expect(ok, "altitude table within the bounds in altitude.h");
+    }
+    altitude_set_qnh(ALTITUDE_STANDARD_QNH_PA);
+}
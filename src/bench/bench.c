@@ -0,0 +1,73 @@
+#include "bench.h"
+#include <stdio.h>
+#include "pico/stdlib.h"
+
+#ifndef UAV_HOST_BUILD
+#include "hardware/clocks.h"
+#endif
+
+volatile int32_t bench_sink;
+
+static uint32_t failures = 0;
+
+
+/*
+ * Print the time per call, and the cycles per call on the Pico
+ */
+void bench_report(const char *name, uint32_t calls, uint64_t elapsed_us) {
+    double ns = elapsed_us * 1000.0 / calls;
+
+#ifndef UAV_HOST_BUILD
+    double cycles = ns * clock_get_hz(clk_sys) / 1e9;
+    printf("%-36s %10.1f ns %10.1f cycles\n", name, ns, cycles);
+#else
+    printf("%-36s %10.1f ns\n", name, ns);
+#endif
+}
+
+
+/*
+ * Time BENCH_ITERATIONS runs of a kernel that makes calls_per_kernel
+ * calls of what is being measured, and report the time per call
+ */
+void bench_run(const char *name, uint32_t calls_per_kernel, void (*kernel)()) {
+    uint64_t start = time_us_64();
+    for (int n = 0; n < BENCH_ITERATIONS; n++) kernel();
+    bench_report(name, BENCH_ITERATIONS * calls_per_kernel, time_us_64() - start);
+}
+
+
+/*
+ * Count a failed check, printing what it was. Returns ok.
+ */
+bool bench_expect(bool ok, const char *what) {
+    if (!ok) {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+    return ok;
+}
+
+
+int main() {
+    stdio_init_all();
+
+#ifndef UAV_HOST_BUILD
+    // Give the USB serial port time to enumerate
+    sleep_ms(3000);
+#endif
+
+    bench_conversion();
+    bench_ahrs();
+    bench_ring();
+    bench_telemetry();
+    bench_filter();
+    bench_altitude();
+    bench_calibration();
+    bench_blackbox();
+    bench_control();
+    bench_esc();
+
+    if (failures > 0) printf("%lu checks failed\n", (unsigned long)failures);
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,34 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Micro benchmarks for the hot path, built for both the Pico and the host
+ * Only the Pico numbers say anything about the M0+, the host run is for
+ * catching regressions quickly. The accuracy checks alongside them are
+ * made with bench_expect(), and bench exits with 1 if any failed.
+ */
+
+#define BENCH_ITERATIONS 2000
+
+// Written by every kernel so the compiler cannot drop the work
+extern volatile int32_t bench_sink;
+
+void bench_report(const char *name, uint32_t calls, uint64_t elapsed_us);
+void bench_run(const char *name, uint32_t calls_per_kernel, void (*kernel)());
+bool bench_expect(bool ok, const char *what);
+
+void bench_conversion();
+void bench_ahrs();
+void bench_ring();
+void bench_telemetry();
+void bench_filter();
+void bench_altitude();
+void bench_calibration();
+void bench_blackbox();
+void bench_control();
+void bench_esc();
+
+#endif
@@ -0,0 +1,55 @@
+#include "bench.h"
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "blackbox.h"
+
+/*
+ * Blackbox encoding, once per raw sample in the blackbox task
+ * Fills whole blocks with gyro samples moving and at rest and reports
+ * the cost per record and how many bytes each took.
+ */
+
+#define SAMPLES 64
+
+static blackbox_encoder_t encoder;
+static uint8_t block[BLACKBOX_BLOCK_SIZE];
+static sample_t samples[SAMPLES];
+static uint32_t records;
+
+
+static void encode_block() {
+    blackbox_begin_block(&encoder, block);
+    for (int i = 0; i < SAMPLES; i++) {
+        if (!blackbox_add_sample(&encoder, &samples[i])) break;
+    }
+    records = encoder.records;
+    blackbox_finish_block(&encoder);
+    bench_sink = encoder.length;
+}
+
+
+static void run(const char *name, int32_t step, int32_t noise) {
+    uint32_t seed = 1;
+    for (int i = 0; i < SAMPLES; i++) {
+        seed = seed * 1664525 + 1013904223;
+        int32_t n = (int32_t)(seed >> 24) % (2 * noise + 1) - noise;
+
+        samples[i].timestamp_us = 1000000 + (uint64_t)i * 1000000 / 760;
+        samples[i].type = SAMPLE_GYRO;
+        samples[i].data[0] = i * step + n;
+        samples[i].data[1] = -i * step / 2 + n;
+        samples[i].data[2] = 200 + n;
+    }
+    blackbox_encoder_init(&encoder, 1);
+
+    uint64_t start = time_us_64();
+    for (int n = 0; n < BENCH_ITERATIONS; n++) encode_block();
+    bench_report(name, BENCH_ITERATIONS * records, time_us_64() - start);
+    printf("  %.2f bytes per record\n", (double)bench_sink / records);
+}
+
+
+void bench_blackbox() {
+    run("blackbox gyro record, at rest", 0, 4);
+    run("blackbox gyro record, turning", 150, 12);
+}
@@ -0,0 +1,246 @@
+#include "bench.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "calib_fit.h"
+
+/*
+ * Calibration, applied to every accel, mag and gyro sample
+ * Times the affine correction, then runs each fit on a synthetic sensor
+ * with a known error and checks it comes back out: the mag ellipsoid
+ * against hard and soft iron, the six position accel against offset,
+ * scale and cross axis terms, and the gyro bias along with the stillness
+ * test that gates it.
+ */
+
+#define SAMPLES 64
+#define FIT_SAMPLES 1000
+#define FIELD 3000.0
+
+// Corrected mag field radius spread and offset error allowed, % and counts
+#define MAG_MAX_SPREAD_PCT 1.0
+#define MAG_MAX_OFFSET     10
+
+// Accel counts per g, and the corrected error allowed in counts
+#define ONE_G          8192
+#define ACC_MAX_ERROR  4
+
+// Gyro noise while still, and the standard deviation taken as still
+#define GYRO_NOISE     20
+#define GYRO_MAX_STD   30
+
+static int32_t raw[SAMPLES][3];
+static int32_t out[SAMPLES][3];
+static calib_affine_t transform;
+static calib_ellipsoid_t fit;
+
+// Distortion of the synthetic magnetometer, soft iron then hard iron
+static const double SOFT[3][3] = {
+    { 1.20,  0.08, -0.05},
+    { 0.08,  0.90,  0.03},
+    {-0.05,  0.03,  1.05}
+};
+static const double HARD[3] = {800, -450, 1200};
+
+// Distortion of the synthetic accelerometer, and its offset in counts
+static const double ACC_GAIN[3][3] = {
+    { 1.04,  0.02, -0.01},
+    {-0.015, 0.97,  0.03},
+    { 0.01, -0.02,  1.02}
+};
+static const double ACC_OFFSET[3] = {-120, 75, 210};
+
+static const int32_t GYRO_BIAS[3] = {37, -112, 9};
+
+static uint32_t seed = 1;
+
+
+static double uniform() {
+    seed = seed * 1664525 + 1013904223;
+    return (seed >> 8) / 16777216.0;
+}
+
+
+/*
+ * Reading for a random direction of the field, with noise in counts
+ */
+static void mag_reading(int32_t v[3], double noise) {
+    double z = 2 * uniform() - 1;
+    double phi = 2 * M_PI * uniform();
+    double r = sqrt(1 - z * z);
+    double field[3] = {FIELD * r * cos(phi), FIELD * r * sin(phi), FIELD * z};
+
+    for (int i = 0; i < 3; i++) {
+        double s = HARD[i] + noise * (2 * uniform() - 1);
+        for (int j = 0; j < 3; j++) s += SOFT[i][j] * field[j];
+        v[i] = (int32_t)lround(s);
+    }
+}
+
+
+static double noise(double amplitude) {
+    return amplitude * (2 * uniform() - 1);
+}
+
+
+/*
+ * Accel reading for a true acceleration in counts
+ */
+static void acc_reading(int32_t v[3], const double g[3], double amplitude) {
+    for (int i = 0; i < 3; i++) {
+        double s = ACC_OFFSET[i] + noise(amplitude);
+        for (int j = 0; j < 3; j++) s += ACC_GAIN[i][j] * g[j];
+        v[i] = (int32_t)lround(s);
+    }
+}
+
+
+/*
+ * Six still faces, square to the axes as on a jig, then every direction
+ * corrected back to within ACC_MAX_ERROR counts of the truth
+ * A face held off square reads as a cross axis term, which the fit has
+ * no way to tell apart, so it is not part of the check.
+ */
+static void check_six_position() {
+    calib_six_t six;
+    calib_six_reset(&six);
+
+    for (int face = 0; face < CALIB_FACES; face++) {
+        double g[3] = {0, 0, 0};
+        g[face / 2] = face & 1 ? -ONE_G : ONE_G;
+
+        calib_rest_t rest;
+        calib_rest_reset(&rest);
+        for (int n = 0; n < 200; n++) {
+            int32_t v[3];
+            acc_reading(v, g, 10);
+            calib_rest_add(&rest, v);
+        }
+        bench_expect(calib_rest_still(&rest, 20), "six position, a still face is still");
+
+        int32_t mean[3];
+        calib_rest_mean(&rest, mean);
+        bench_expect(calib_six_face(mean) == face, "six position, face detected");
+        bench_expect(calib_six_add(&six, mean), "six position, face added");
+        bench_expect(!calib_six_add(&six, mean), "six position, face not added twice");
+    }
+
+    int32_t between[3] = {ONE_G / 2, ONE_G / 2, ONE_G / 2};
+    bench_expect(calib_six_face(between) == -1, "six position, between faces is no face");
+
+    calib_affine_t t;
+    if (!bench_expect(calib_six_solve(&six, ONE_G, &t), "six position solve")) return;
+
+    double worst = 0;
+    for (int n = 0; n < FIT_SAMPLES; n++) {
+        double z = 2 * uniform() - 1, phi = 2 * M_PI * uniform(), r = sqrt(1 - z * z);
+        double g[3] = {ONE_G * r * cos(phi), ONE_G * r * sin(phi), ONE_G * z};
+        int32_t v[3];
+        acc_reading(v, g, 0);
+        calib_affine_apply(&t, v);
+        for (int i = 0; i < 3; i++) worst = fmax(worst, fabs(v[i] - g[i]));
+    }
+    printf("calibration six position, offset %ld %ld %ld (true %.0f %.0f %.0f), worst error %.1f counts\n",
+           (long)t.offset[0], (long)t.offset[1], (long)t.offset[2],
+           ACC_OFFSET[0], ACC_OFFSET[1], ACC_OFFSET[2], worst);
+    bench_expect(worst <= ACC_MAX_ERROR, "six position corrects every direction");
+
+    // A sensor reading a third of what it should is a bad calibration
+    calib_six_t weak = six;
+    for (int face = 0; face < CALIB_FACES; face++) {
+        for (int i = 0; i < 3; i++) weak.mean[face][i] /= 3;
+    }
+    bench_expect(!calib_six_solve(&weak, ONE_G, &t), "six position rejects a scale out of range");
+}
+
+
+/*
+ * Bias out of a still gyro, and no bias at all out of a moving one
+ */
+static void check_gyro_bias() {
+    calib_rest_t rest;
+    calib_rest_reset(&rest);
+    for (int n = 0; n < 2000; n++) {
+        int32_t v[3];
+        for (int i = 0; i < 3; i++) v[i] = GYRO_BIAS[i] + (int32_t)lround(noise(GYRO_NOISE));
+        calib_rest_add(&rest, v);
+    }
+
+    calib_affine_t t;
+    if (bench_expect(calib_gyro_bias(&rest, GYRO_MAX_STD, &t), "gyro bias while still")) {
+        bool ok = true;
+        for (int i = 0; i < 3; i++) {
+            ok &= abs(t.offset[i] - GYRO_BIAS[i]) <= 1;
+            for (int j = 0; j < 3; j++) ok &= t.matrix[i][j] == (i == j ? Q30_ONE : 0);
+        }
+        printf("calibration gyro bias %ld %ld %ld (true %ld %ld %ld)\n",
+               (long)t.offset[0], (long)t.offset[1], (long)t.offset[2],
+               (long)GYRO_BIAS[0], (long)GYRO_BIAS[1], (long)GYRO_BIAS[2]);
+        bench_expect(ok, "gyro bias matches, scale left nominal");
+    }
+
+    // Turning slowly on one axis, well above the noise
+    calib_rest_reset(&rest);
+    for (int n = 0; n < 2000; n++) {
+        int32_t v[3] = {GYRO_BIAS[0], GYRO_BIAS[1] + (int32_t)lround(200 * sin(n * 0.01)), GYRO_BIAS[2]};
+        calib_rest_add(&rest, v);
+    }
+    bench_expect(!calib_gyro_bias(&rest, GYRO_MAX_STD, &t), "gyro bias refused while moving");
+}
+
+
+static void apply() {
+    for (int i = 0; i < SAMPLES; i++) {
+        out[i][0] = raw[i][0];
+        out[i][1] = raw[i][1];
+        out[i][2] = raw[i][2];
+        calib_affine_apply(&transform, out[i]);
+    }
+    bench_sink = out[SAMPLES - 1][0];
+}
+
+
+void bench_calibration() {
+    calib_ellipsoid_reset(&fit);
+    for (int n = 0; n < FIT_SAMPLES; n++) {
+        int32_t v[3];
+        mag_reading(v, 5);
+        calib_ellipsoid_add(&fit, v);
+    }
+
+    uint64_t start = time_us_64();
+    bool solved = calib_ellipsoid_solve(&fit, &transform);
+    uint64_t solve_us = time_us_64() - start;
+
+    if (!bench_expect(solved, "calibration mag ellipsoid fit")) return;
+
+    for (int i = 0; i < SAMPLES; i++) mag_reading(raw[i], 0);
+    bench_run("calibration apply", SAMPLES, apply);
+
+    // Noise free readings should land on a sphere once corrected
+    double smallest = INFINITY, largest = 0;
+    for (int n = 0; n < FIT_SAMPLES; n++) {
+        int32_t v[3];
+        mag_reading(v, 0);
+        calib_affine_apply(&transform, v);
+        double r = sqrt((double)v[0] * v[0] + (double)v[1] * v[1] + (double)v[2] * v[2]);
+        if (r < smallest) smallest = r;
+        if (r > largest) largest = r;
+    }
+
+    printf("calibration mag fit in %llu us, offset %ld %ld %ld (true %.0f %.0f %.0f), "
+           "radius %.0f..%.0f, spread %.2f%%\n",
+           (unsigned long long)solve_us,
+           (long)transform.offset[0], (long)transform.offset[1], (long)transform.offset[2],
+           HARD[0], HARD[1], HARD[2],
+           smallest, largest, 100 * (largest - smallest) / largest);
+
+    bool offset_ok = true;
+    for (int i = 0; i < 3; i++) offset_ok &= fabs(transform.offset[i] - HARD[i]) <= MAG_MAX_OFFSET;
+    bench_expect(offset_ok && 100 * (largest - smallest) / largest <= MAG_MAX_SPREAD_PCT,
+                 "calibration mag fit removes hard and soft iron");
+
+    check_six_position();
+    check_gyro_bias();
+}
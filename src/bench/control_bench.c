@@ -0,0 +1,144 @@
+#include "bench.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "rate_pid.h"
+#include "mixer.h"
+
+/*
+ * Rate control, once per gyro sample
+ * Times the three PIDs and each frame's mixer, checks that a roll, pitch
+ * or yaw command leaves the total thrust alone and that a saturated mix
+ * stays in range, then flies a step in roll rate through the PID on a
+ * simple model of the airframe. Any of them outside its limits fails.
+ */
+
+#define SAMPLES 64
+
+static const uint32_t DT_US = 1316;  // 760 Hz
+
+// The model: full command gives this much angular acceleration, and the
+// props damp the rate with this time constant
+#define AUTHORITY_RAD_S2 500.0
+#define DAMPING_S        0.05
+
+// What the step response has to meet with the firmware's gains
+#define STEP_MAX_RISE_MS       80
+#define STEP_MAX_OVERSHOOT_PCT 10
+#define STEP_MAX_ERROR_RAD_S   0.03
+
+// The firmware's roll and pitch gains
+static const rate_pid_gains_t GAINS = {
+    .kp = 0.15f, .ki = 1.5f, .kd = 0.0005f, .i_limit = 0.2f, .limit = 0.5f
+};
+
+static rate_pid_t pids[3];
+static q16_t rates[SAMPLES][3];
+static mixer_input_t inputs[SAMPLES];
+static q16_t motors[MIXER_MAX_MOTORS];
+
+typedef bool (*mixer_t)(const mixer_input_t *in, q16_t *motors);
+
+
+static void pid() {
+    for (int i = 0; i < SAMPLES; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            bench_sink = rate_pid_update(&pids[axis], Q16_ONE, rates[i][axis], DT_US, false);
+        }
+    }
+}
+
+
+static mixer_t bench_mixer;
+
+static void mix() {
+    for (int i = 0; i < SAMPLES; i++) bench_sink = bench_mixer(&inputs[i], motors);
+}
+
+
+/*
+ * Worst change in total thrust from a roll, pitch or yaw command alone,
+ * in motor outputs, and whether a command far past the motors' range
+ * still comes out as outputs within it
+ */
+static void check_mixer(const char *name, mixer_t mixer, uint8_t count) {
+    int32_t worst = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        q16_t command[3] = {0, 0, 0};
+        command[axis] = Q16_FROM_FLOAT(0.2);
+        mixer_input_t in = {Q16_ONE / 2, command[0], command[1], command[2]};
+        mixer(&in, motors);
+
+        int32_t total = 0;
+        for (uint8_t i = 0; i < count; i++) total += motors[i] - Q16_ONE / 2;
+        if (abs(total) > worst) worst = abs(total);
+    }
+
+    // Rounding can leave a count per motor
+    bench_expect(worst <= count, "mixer leaves thrust alone");
+
+    mixer_input_t full = {Q16_ONE, 4 * Q16_ONE, -3 * Q16_ONE, 2 * Q16_ONE};
+    bool saturated = mixer(&full, motors);
+    bool in_range = true;
+    for (uint8_t i = 0; i < count; i++) in_range &= motors[i] >= 0 && motors[i] <= Q16_ONE;
+
+    printf("mixer %-6s thrust change %.5f, saturated %s, outputs %s\n", name,
+           q16_to_float(worst), saturated ? "yes" : "no", in_range ? "in range" : "OUT OF RANGE");
+    bench_expect(saturated && in_range, "mixer saturates within the motor range");
+}
+
+
+/*
+ * A 3 rad/s step in roll rate through the PID and the model
+ */
+static void step_response() {
+    rate_pid_t roll;
+    rate_pid_init(&roll, &GAINS);
+
+    const double target = 3.0, dt = DT_US * 1e-6;
+    double rate = 0, peak = 0, rise_ms = -1;
+    for (int n = 0; n < 760; n++) {
+        q16_t command = rate_pid_update(&roll, Q16_FROM_FLOAT(target), (q16_t)(rate * 65536), DT_US, false);
+        rate += (q16_to_float(command) * AUTHORITY_RAD_S2 - rate / DAMPING_S) * dt;
+
+        if (rate > peak) peak = rate;
+        if (rise_ms < 0 && rate >= 0.9 * target) rise_ms = n * dt * 1000;
+    }
+
+    double overshoot = 100 * (peak - target) / target;
+    printf("rate pid 3 rad/s step: 90%% in %.1f ms, overshoot %.1f%%, error after 1 s %.3f rad/s\n",
+           rise_ms, overshoot, target - rate);
+    bench_expect(rise_ms >= 0 && rise_ms <= STEP_MAX_RISE_MS, "rate pid step rise time");
+    bench_expect(overshoot <= STEP_MAX_OVERSHOOT_PCT, "rate pid step overshoot");
+    bench_expect(fabs(target - rate) <= STEP_MAX_ERROR_RAD_S, "rate pid step settles");
+}
+
+
+void bench_control() {
+    uint32_t seed = 1;
+    for (int i = 0; i < SAMPLES; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            seed = seed * 1664525 + 1013904223;
+            rates[i][axis] = (int32_t)(seed >> 12) - (1 << 19);
+        }
+        inputs[i].throttle = Q16_ONE / 2;
+        inputs[i].roll = rates[i][0] >> 3;
+        inputs[i].pitch = rates[i][1] >> 3;
+        inputs[i].yaw = rates[i][2] >> 4;
+    }
+    for (int axis = 0; axis < 3; axis++) rate_pid_init(&pids[axis], &GAINS);
+
+    bench_run("rate pid, three axes", SAMPLES, pid);
+    bench_mixer = mixer_quad_x;
+    bench_run("mixer, quad x", SAMPLES, mix);
+    bench_mixer = mixer_hex_x;
+    bench_run("mixer, hex x", SAMPLES, mix);
+    bench_mixer = mixer_octo_x;
+    bench_run("mixer, octo x", SAMPLES, mix);
+
+    check_mixer("quad x", mixer_quad_x, MIXER_QUAD_X_MOTORS);
+    check_mixer("hex x", mixer_hex_x, MIXER_HEX_X_MOTORS);
+    check_mixer("octo x", mixer_octo_x, MIXER_OCTO_X_MOTORS);
+    step_response();
+}
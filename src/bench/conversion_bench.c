@@ -0,0 +1,65 @@
+#include "bench.h"
+#include "pico/stdlib.h"
+#include "raw.h"
+#include "gy89/l3gd20.h"
+
+/*
+ * Scaling and averaging one FIFO's worth of gyro samples
+ * Compares the old per-sample double/float path with integer
+ * accumulation and a single Q16.16 scale at the end.
+ */
+
+static RawXYZ samples[L3GD20_FIFO_DEPTH];
+
+
+// As imu.c used to: convert each sample with a double constant, sum floats
+static void average_double_literal() {
+    float sums[3] = {0, 0, 0};
+    for (int i = 0; i < L3GD20_FIFO_DEPTH; i++) {
+        sums[0] += samples[i].x * 0.00875;
+        sums[1] += samples[i].y * 0.00875;
+        sums[2] += samples[i].z * 0.00875;
+    }
+    bench_sink = (int32_t)(sums[0] / L3GD20_FIFO_DEPTH + sums[1] / L3GD20_FIFO_DEPTH + sums[2] / L3GD20_FIFO_DEPTH);
+}
+
+
+// Same but single precision throughout
+static void average_float() {
+    float sums[3] = {0, 0, 0};
+    for (int i = 0; i < L3GD20_FIFO_DEPTH; i++) {
+        sums[0] += samples[i].x * 0.00875f;
+        sums[1] += samples[i].y * 0.00875f;
+        sums[2] += samples[i].z * 0.00875f;
+    }
+    bench_sink = (int32_t)(sums[0] / L3GD20_FIFO_DEPTH + sums[1] / L3GD20_FIFO_DEPTH + sums[2] / L3GD20_FIFO_DEPTH);
+}
+
+
+// Integer sums of raw counts, one fixed point scale per axis
+static void average_fixed() {
+    int32_t sums[3] = {0, 0, 0};
+    for (int i = 0; i < L3GD20_FIFO_DEPTH; i++) {
+        sums[0] += samples[i].x;
+        sums[1] += samples[i].y;
+        sums[2] += samples[i].z;
+    }
+    bench_sink = l3gd20_raw_to_q16(sums[0] / L3GD20_FIFO_DEPTH)
+               + l3gd20_raw_to_q16(sums[1] / L3GD20_FIFO_DEPTH)
+               + l3gd20_raw_to_q16(sums[2] / L3GD20_FIFO_DEPTH);
+}
+
+
+void bench_conversion() {
+    uint32_t seed = 1;
+    for (int i = 0; i < L3GD20_FIFO_DEPTH; i++) {
+        seed = seed * 1664525 + 1013904223;
+        samples[i].x = (int16_t)(seed >> 16);
+        samples[i].y = (int16_t)(seed >> 8);
+        samples[i].z = (int16_t)seed;
+    }
+
+    bench_run("gyro sample, double constant", L3GD20_FIFO_DEPTH, average_double_literal);
+    bench_run("gyro sample, float", L3GD20_FIFO_DEPTH, average_float);
+    bench_run("gyro sample, int sum + q16 scale", L3GD20_FIFO_DEPTH, average_fixed);
+}
@@ -0,0 +1,41 @@
+#include "bench.h"
+#include "pico/stdlib.h"
+#include "esc_encode.h"
+
+/*
+ * ESC frame encoding, once per control tick
+ * A whole frame for eight motors, DShot with its CRCs and the bit
+ * transpose, and the sorted pulse segments of OneShot125.
+ */
+
+#define SAMPLES 64
+#define MOTORS  8
+
+static q16_t outputs[SAMPLES][MOTORS];
+static uint32_t words[ESC_MAX_WORDS];
+
+
+static void dshot() {
+    for (int i = 0; i < SAMPLES; i++) bench_sink = esc_encode(ESC_DSHOT600, outputs[i], MOTORS, words);
+    bench_sink = words[0];
+}
+
+
+static void oneshot() {
+    for (int i = 0; i < SAMPLES; i++) bench_sink = esc_encode(ESC_ONESHOT125, outputs[i], MOTORS, words);
+    bench_sink = words[0];
+}
+
+
+void bench_esc() {
+    uint32_t seed = 1;
+    for (int i = 0; i < SAMPLES; i++) {
+        for (int m = 0; m < MOTORS; m++) {
+            seed = seed * 1664525 + 1013904223;
+            outputs[i][m] = (q16_t)(seed >> 16);
+        }
+    }
+
+    bench_run("esc frame, dshot600 x8", SAMPLES, dshot);
+    bench_run("esc frame, oneshot125 x8", SAMPLES, oneshot);
+}
@@ -0,0 +1,199 @@
+#include "bench.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "filter.h"
+
+/*
+ * Gyro filtering, one 3 axis sample through a chain per call
+ * Compares the Q2.30 biquad against the same section in single precision,
+ * then drives sine waves through each filter type and checks the gain
+ * that comes out against the response of the quantised coefficients,
+ * and that response against a few points every design has to meet.
+ */
+
+#define SAMPLES     64
+#define SAMPLE_HZ   760.0f
+#define AMPLITUDE   8000
+
+// Measured against quantised gain, above -40 dB where the output is
+// still more than a handful of counts
+#define MAX_ERROR_DB   0.1
+#define ERROR_FLOOR_DB -40
+
+// Where the quantised response of a design has to be
+typedef struct gain_bound {
+    float hz;
+    float min_db;
+    float max_db;
+} gain_bound_t;
+
+#define BOUNDS(bounds) bounds, sizeof(bounds) / sizeof((bounds)[0])
+
+static int32_t input[SAMPLES][3];
+static float   input_f[SAMPLES][3];
+
+static filter_chain_t chain;
+
+typedef struct biquad_f {
+    float b0, b1, b2, a1, a2;
+    float x1[3], x2[3], y1[3], y2[3];
+} biquad_f_t;
+
+static biquad_f_t lowpass_f;
+
+
+static void biquad_float(biquad_f_t *f, float *v) {
+    for (int axis = 0; axis < 3; axis++) {
+        float x = v[axis];
+        float y = f->b0 * x + f->b1 * f->x1[axis] + f->b2 * f->x2[axis]
+                - f->a1 * f->y1[axis] - f->a2 * f->y2[axis];
+        f->x2[axis] = f->x1[axis];
+        f->x1[axis] = x;
+        f->y2[axis] = f->y1[axis];
+        f->y1[axis] = y;
+        v[axis] = y;
+    }
+}
+
+
+static void lowpass_float() {
+    for (int i = 0; i < SAMPLES; i++) {
+        float v[3] = {input_f[i][0], input_f[i][1], input_f[i][2]};
+        biquad_float(&lowpass_f, v);
+        bench_sink = (int32_t)v[0];
+    }
+}
+
+
+static void chain_fixed() {
+    for (int i = 0; i < SAMPLES; i++) {
+        int32_t v[3] = {input[i][0], input[i][1], input[i][2]};
+        filter_chain_apply(&chain, v);
+        bench_sink = v[0];
+    }
+}
+
+
+static bool configure(const filter_config_t *configs, uint8_t count) {
+    return bench_expect(filter_chain_configure(&chain, configs, count, SAMPLE_HZ), "filter design");
+}
+
+
+/*
+ * Gain of the chain's quantised coefficients at hz, in dB
+ */
+static double design_gain_db(double hz) {
+    double w = 2 * 3.14159265358979 * hz / SAMPLE_HZ;
+    double gain = 1;
+
+    for (uint8_t i = 0; i < chain.count; i++) {
+        const biquad_coeffs_t *c = &chain.stages[i].c;
+        double b0 = c->b0 / 1073741824.0, b1 = c->b1 / 1073741824.0, b2 = c->b2 / 1073741824.0;
+        double a1 = c->a1 / 1073741824.0, a2 = c->a2 / 1073741824.0;
+
+        double num_re = b0 + b1 * cos(w) + b2 * cos(2 * w);
+        double num_im = -b1 * sin(w) - b2 * sin(2 * w);
+        double den_re = 1 + a1 * cos(w) + a2 * cos(2 * w);
+        double den_im = -a1 * sin(w) - a2 * sin(2 * w);
+        gain *= sqrt((num_re * num_re + num_im * num_im) / (den_re * den_re + den_im * den_im));
+    }
+    return 20 * log10(gain);
+}
+
+
+/*
+ * Peak output of a settled sine at hz, as gain in dB
+ */
+static double measured_gain_db(double hz) {
+    const int settle = 4000, measure = 2000;
+    int32_t peak = 0;
+
+    filter_chain_reset(&chain);
+    for (int n = 0; n < settle + measure; n++) {
+        int32_t x = (int32_t)lround(AMPLITUDE * sin(2 * 3.14159265358979 * hz * n / SAMPLE_HZ));
+        int32_t v[3] = {x, -x, x / 2};
+        filter_chain_apply(&chain, v);
+        if (n >= settle && abs(v[0]) > peak) peak = abs(v[0]);
+    }
+    return 20 * log10((peak + 0.5) / AMPLITUDE);
+}
+
+
+static void response(const char *name, const filter_config_t *configs, uint8_t count,
+                     const float *freqs, int n_freqs, const gain_bound_t *bounds, int n_bounds) {
+    if (!configure(configs, count)) return;
+
+    double worst = 0;
+    printf("%s\n", name);
+    for (int i = 0; i < n_freqs; i++) {
+        double design = design_gain_db(freqs[i]);
+        double measured = measured_gain_db(freqs[i]);
+        printf("  %6.1f Hz  design %7.2f dB  measured %7.2f dB\n", freqs[i], design, measured);
+
+        // Below the floor only the design matters
+        if (design > ERROR_FLOOR_DB && fabs(measured - design) > worst) worst = fabs(measured - design);
+    }
+    printf("  max |error| above %d dB %.3f dB\n", ERROR_FLOOR_DB, worst);
+    bench_expect(worst <= MAX_ERROR_DB, "filter measured gain against its coefficients");
+
+    for (int i = 0; i < n_bounds; i++) {
+        double design = design_gain_db(bounds[i].hz);
+        if (design < bounds[i].min_db || design > bounds[i].max_db) {
+            printf("  %6.1f Hz  design %7.2f dB, not within %.2f to %.2f dB\n",
+                   bounds[i].hz, design, bounds[i].min_db, bounds[i].max_db);
+            bench_expect(false, "filter design response");
+        }
+    }
+}
+
+
+void bench_filter() {
+    uint32_t seed = 1;
+    for (int i = 0; i < SAMPLES; i++) {
+        for (int j = 0; j < 3; j++) {
+            seed = seed * 1664525 + 1013904223;
+            input[i][j] = (int32_t)(seed >> 18) - 8192;
+            input_f[i][j] = input[i][j];
+        }
+    }
+
+    static const filter_config_t lowpass[] = {{FILTER_LOWPASS, 80, FILTER_BUTTERWORTH_Q}};
+    static const filter_config_t pt1[]     = {{FILTER_PT1, 80, 0}};
+    static const filter_config_t notch[]   = {{FILTER_NOTCH, 200, 3}};
+    static const filter_config_t gyro[]    = {
+        {FILTER_LOWPASS, 80, FILTER_BUTTERWORTH_Q},
+        {FILTER_NOTCH, 200, 3},
+        {FILTER_NOTCH, 250, 3}
+    };
+
+    configure(lowpass, 1);
+    const biquad_coeffs_t *c = &chain.stages[0].c;
+    lowpass_f.b0 = q30_to_float(c->b0);
+    lowpass_f.b1 = q30_to_float(c->b1);
+    lowpass_f.b2 = q30_to_float(c->b2);
+    lowpass_f.a1 = q30_to_float(c->a1);
+    lowpass_f.a2 = q30_to_float(c->a2);
+
+    bench_run("biquad low pass x3, float", SAMPLES, lowpass_float);
+    bench_run("biquad low pass x3, q30", SAMPLES, chain_fixed);
+    configure(pt1, 1);
+    bench_run("pt1 x3, q30", SAMPLES, chain_fixed);
+    configure(gyro, 3);
+    bench_run("low pass + 2 notches x3, q30", SAMPLES, chain_fixed);
+
+    static const float freqs[] = {10, 40, 80, 120, 200, 250, 300, 360};
+    const int n_freqs = sizeof(freqs) / sizeof(freqs[0]);
+
+    // Flat in the passband, -3 dB at a Butterworth cutoff, the notch deep
+    // at its centre and back to within 1 dB an octave below it and
+    // near Nyquist above
+    static const gain_bound_t lowpass_bounds[] = {{10, -0.05f, 0.05f}, {80, -3.11f, -2.91f}, {250, -80, -25}};
+    static const gain_bound_t pt1_bounds[]     = {{10, -0.2f, 0}, {80, -4.5f, -3}, {360, -15, -10}};
+    static const gain_bound_t notch_bounds[]   = {{10, -0.05f, 0.05f}, {100, -1, 0}, {200, -200, -40}, {360, -1, 0}};
+
+    response("low pass 80 Hz, q 0.707", lowpass, 1, freqs, n_freqs, BOUNDS(lowpass_bounds));
+    response("pt1 80 Hz", pt1, 1, freqs, n_freqs, BOUNDS(pt1_bounds));
+    response("notch 200 Hz, q 3", notch, 1, freqs, n_freqs, BOUNDS(notch_bounds));
+}
@@ -0,0 +1,38 @@
+#include "bench.h"
+#include "pico/stdlib.h"
+#include "sample_ring.h"
+
+/*
+ * Publishing through the sample ring
+ * One push and one pop per sample, in batches the size of a gyro FIFO
+ * drain, the same pattern as the IMU task and a consumer.
+ */
+
+#define BATCH 32
+
+static sample_ring_t ring;
+
+
+static void push_pop() {
+    sample_t sample = {.type = SAMPLE_GYRO};
+    for (int i = 0; i < BATCH; i++) {
+        sample.timestamp_us = i;
+        sample.data[0] = i;
+        sample_ring_push(&ring, &sample);
+    }
+
+    int32_t sum = 0;
+    while (sample_ring_pop(&ring, &sample)) {
+        sum += sample.data[0];
+    }
+    bench_sink = sum;
+}
+
+
+void bench_ring() {
+    sample_ring_init(&ring);
+
+    uint64_t start = time_us_64();
+    for (int n = 0; n < BENCH_ITERATIONS; n++) push_pop();
+    bench_report("sample ring push + pop", BENCH_ITERATIONS * BATCH, time_us_64() - start);
+}
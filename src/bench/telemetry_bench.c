@@ -0,0 +1,56 @@
+#include "bench.h"
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "telemetry.h"
+
+/*
+ * Formatting a display frame as text against binary telemetry
+ * The text case is one set of the logger's printf lines into a buffer,
+ * the binary case encodes a frame of raw samples including COBS and CRC.
+ */
+
+#define SAMPLES 16
+
+static telemetry_encoder_t encoder;
+static uint8_t encoded[TELEMETRY_MAX_ENCODED];
+static char text[512];
+static sample_t samples[SAMPLES];
+
+
+static void format_text() {
+    float x = bench_sink * 0.01f, y = 1.5f, z = -9.81f;
+    int n = 0;
+    n += snprintf(text + n, sizeof(text) - n, "Acc:  (x: %2.2f, y: %2.2f, z: %2.2f)\n", x, y, z);
+    n += snprintf(text + n, sizeof(text) - n, "Mag:  (x: %2.2f, y: %2.2f, z: %2.2f)\n", x, y, z);
+    n += snprintf(text + n, sizeof(text) - n, "Gyro: (x: %2.2f, y: %2.2f, z: %2.2f)\n", x, y, z);
+    n += snprintf(text + n, sizeof(text) - n, "Baro: (Temp: %2.2f, Pressure: %2.2f, Altitude: %2.2f)\n", x, y, z);
+    bench_sink = n;
+}
+
+
+static void encode_binary() {
+    for (int i = 0; i < SAMPLES; i++) {
+        telemetry_add_sample(&encoder, &samples[i]);
+    }
+    bench_sink = telemetry_finish_frame(&encoder, encoded);
+}
+
+
+void bench_telemetry() {
+    for (int i = 0; i < SAMPLES; i++) {
+        samples[i].timestamp_us = 1000000 + i * 1316;
+        samples[i].type = SAMPLE_GYRO;
+        samples[i].data[0] = i * 31 - 200;
+        samples[i].data[1] = i * 17;
+        samples[i].data[2] = -i * 5;
+    }
+    telemetry_encoder_init(&encoder);
+
+    uint64_t start = time_us_64();
+    for (int n = 0; n < BENCH_ITERATIONS; n++) format_text();
+    bench_report("text display frame, snprintf", BENCH_ITERATIONS, time_us_64() - start);
+
+    start = time_us_64();
+    for (int n = 0; n < BENCH_ITERATIONS; n++) encode_binary();
+    bench_report("binary frame, 16 samples", BENCH_ITERATIONS, time_us_64() - start);
+}
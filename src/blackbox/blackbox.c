@@ -0,0 +1,143 @@
+#include "blackbox.h"
+#include <string.h>
+#include "crc16.h"
+
+_Static_assert(SAMPLE_ACC == BLACKBOX_RECORD_ACC &&
+               SAMPLE_MAG == BLACKBOX_RECORD_MAG &&
+               SAMPLE_GYRO == BLACKBOX_RECORD_GYRO &&
+               SAMPLE_BARO == BLACKBOX_RECORD_BARO,
+               "sample_type_t and the blackbox record types must match");
+
+
+static void put_u16(uint8_t *p, uint16_t value) {
+    p[0] = value;
+    p[1] = value >> 8;
+}
+
+
+static void put_u64(uint8_t *p, uint64_t value) {
+    for (int i = 0; i < 8; i++) p[i] = value >> (8 * i);
+}
+
+
+static uint8_t *put_varint(uint8_t *p, uint64_t value) {
+    while (value >= 0x80) {
+        *p++ = (uint8_t)value | 0x80;
+        value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+    return p;
+}
+
+
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+
+void blackbox_encoder_init(blackbox_encoder_t *encoder, uint16_t session) {
+    encoder->block = NULL;
+    encoder->length = 0;
+    encoder->records = 0;
+    encoder->session = session;
+    encoder->sequence = 0;
+}
+
+
+/*
+ * Start filling a block. Every stream goes back to zero so the block
+ * decodes without the ones before it.
+ */
+void blackbox_begin_block(blackbox_encoder_t *encoder, uint8_t *block) {
+    encoder->block = block;
+    encoder->length = 0;
+    encoder->records = 0;
+    memset(encoder->streams, 0, sizeof(encoder->streams));
+}
+
+
+bool blackbox_block_empty(const blackbox_encoder_t *encoder) {
+    return encoder->records == 0;
+}
+
+
+/*
+ * Append a record, false if the block has no room for it
+ * The base time is taken from the first record in the block.
+ */
+bool blackbox_add(blackbox_encoder_t *encoder, uint8_t type, uint64_t timestamp_us,
+                  const int32_t *values, uint8_t count) {
+    if (type >= BLACKBOX_RECORD_TYPES || count > BLACKBOX_MAX_VALUES) return false;
+
+    if (encoder->records == 0) {
+        encoder->base_us = timestamp_us;
+        for (int i = 0; i < BLACKBOX_RECORD_TYPES; i++) encoder->streams[i].last_us = timestamp_us;
+    }
+
+    blackbox_stream_t *stream = &encoder->streams[type];
+    int64_t interval = (int64_t)(timestamp_us - stream->last_us);
+
+    // Built aside first, records never straddle blocks
+    uint8_t record[BLACKBOX_MAX_RECORD];
+    uint8_t *p = record;
+    // Sensors sample evenly, so the time change mostly fits in the tag
+    uint64_t time = zigzag(interval - stream->last_interval_us);
+    if (time < BLACKBOX_TAG_TIME_ESCAPE) {
+        *p++ = type | time << BLACKBOX_TAG_TYPE_BITS;
+    } else {
+        *p++ = type | BLACKBOX_TAG_TIME_ESCAPE << BLACKBOX_TAG_TYPE_BITS;
+        p = put_varint(p, time);
+    }
+
+    if (type == BLACKBOX_RECORD_RC) {
+        if (count != stream->count) memset(stream->last, 0, sizeof(stream->last));
+        p = put_varint(p, count);
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        int32_t change = (int32_t)((uint32_t)values[i] - (uint32_t)stream->last[i]);
+        p = put_varint(p, zigzag(change));
+    }
+
+    uint16_t size = p - record;
+    if (BLACKBOX_HEADER_SIZE + encoder->length + size > BLACKBOX_BLOCK_SIZE) return false;
+
+    memcpy(encoder->block + BLACKBOX_HEADER_SIZE + encoder->length, record, size);
+    encoder->length += size;
+    encoder->records++;
+
+    stream->last_us = timestamp_us;
+    stream->last_interval_us = interval;
+    stream->count = count;
+    memcpy(stream->last, values, count * sizeof(int32_t));
+    return true;
+}
+
+
+bool blackbox_add_sample(blackbox_encoder_t *encoder, const sample_t *sample) {
+    return blackbox_add(encoder, sample->type, sample->timestamp_us,
+                        sample->data, BLACKBOX_SAMPLE_VALUES);
+}
+
+
+/*
+ * Write the header and padding, leaving the whole block ready to program
+ * The next block continues the sequence.
+ */
+void blackbox_finish_block(blackbox_encoder_t *encoder) {
+    uint8_t *block = encoder->block;
+
+    put_u16(block, BLACKBOX_MAGIC);
+    put_u16(block + 4, encoder->session);
+    put_u16(block + 6, encoder->sequence);
+    put_u64(block + 8, encoder->base_us);
+    put_u16(block + 16, encoder->length);
+    block[18] = BLACKBOX_VERSION;
+    block[19] = 0;
+
+    memset(block + BLACKBOX_HEADER_SIZE + encoder->length, 0xFF,
+           BLACKBOX_BLOCK_SIZE - BLACKBOX_HEADER_SIZE - encoder->length);
+    put_u16(block + 2, crc16(block + BLACKBOX_CRC_START,
+                             BLACKBOX_HEADER_SIZE - BLACKBOX_CRC_START + encoder->length));
+
+    encoder->sequence++;
+}
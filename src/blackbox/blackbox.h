@@ -0,0 +1,48 @@
+#ifndef BLACKBOX_H
+#define BLACKBOX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sample_ring.h"
+#include "blackbox_format.h"
+
+/*
+ * Packs log records into flash sized blocks, see blackbox_format.h
+ * The encoder itself does no I/O so it runs the same on the host.
+ */
+typedef struct blackbox_stream {
+    uint64_t last_us;
+    int64_t last_interval_us;
+    uint8_t count;          // RC channels last time, a change is a keyframe
+    int32_t last[BLACKBOX_MAX_VALUES];
+} blackbox_stream_t;
+
+typedef struct blackbox_encoder {
+    uint8_t *block;         // BLACKBOX_BLOCK_SIZE bytes
+    uint16_t length;        // bytes of records so far
+    uint16_t records;
+    uint16_t session;
+    uint16_t sequence;      // of the block being built
+    uint64_t base_us;
+    blackbox_stream_t streams[BLACKBOX_RECORD_TYPES];
+} blackbox_encoder_t;
+
+void blackbox_encoder_init(blackbox_encoder_t *encoder, uint16_t session);
+void blackbox_begin_block(blackbox_encoder_t *encoder, uint8_t *block);
+bool blackbox_add(blackbox_encoder_t *encoder, uint8_t type, uint64_t timestamp_us,
+                  const int32_t *values, uint8_t count);
+bool blackbox_add_sample(blackbox_encoder_t *encoder, const sample_t *sample);
+void blackbox_finish_block(blackbox_encoder_t *encoder);
+bool blackbox_block_empty(const blackbox_encoder_t *encoder);
+
+// Flight log writer
+void blackbox_init();
+void blackbox_toggle();
+void blackbox_dump();
+void blackbox_erase();
+bool blackbox_logging();
+void blackbox_service(sample_ring_t *ring);
+void blackbox_stop();
+void blackbox_task(void *ring);
+
+#endif
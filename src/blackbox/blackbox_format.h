@@ -0,0 +1,78 @@
+#ifndef BLACKBOX_FORMAT_H
+#define BLACKBOX_FORMAT_H
+
+/*
+ * Blackbox flight log layout, shared by the firmware encoder and the
+ * host decoder in tools/blackbox
+ *
+ * The log is a run of blocks of one flash sector each, written in order
+ * from the start of the region after it was erased. An erased block
+ * reads all 0xFF, the first one ends the log. A block is:
+ *
+ *   header   magic        u16, BLACKBOX_MAGIC
+ *            crc          u16, CRC-16/CCITT-FALSE from the session to
+ *                         the end of the records
+ *            session      u16, +1 per boot since the region was erased
+ *            sequence     u16, +1 per block in a session, gaps are lost
+ *                         blocks
+ *            base time    u64, us
+ *            length       u16, bytes of records
+ *            version      u8, BLACKBOX_VERSION
+ *            reserved     u8
+ *   records
+ *   padding  0xFF to the end of the block
+ *
+ * All header fields are little endian. Every record is:
+ *
+ *   tag           u8, the record type in the low 3 bits and the time,
+ *                 zigzagged, in the high 5 if it is under 31
+ *   time          varint, zigzagged, only when the tag holds 31. The
+ *                 time is the change in the interval since the previous
+ *                 record of the same type, us.
+ *   count         varint, number of values, only for RC records. A
+ *                 change in the count restarts the values from 0.
+ *   values        varint each, the change from the previous record of
+ *                 the same type
+ *
+ * Varints are LEB128, signed ones zigzag encoded first. Values change
+ * with 32 bit wraparound so any int32 round trips exactly.
+ *
+ * Each block is a keyframe: the first record of each type in it counts
+ * from the base time with an interval of 0 and values of 0, so it
+ * carries absolute values and any block decodes on its own.
+ *
+ * Samples are the raw counts the drivers read, before calibration and
+ * filtering, in the units of sample_type_t. RC records are the PPM pulse
+ * widths in us. Lost records give the samples dropped before they could
+ * be logged since the previous one.
+ */
+
+#define BLACKBOX_MAGIC          0xB10C
+#define BLACKBOX_VERSION        1
+
+// One flash sector, so a block is erased on its own
+#define BLACKBOX_BLOCK_SIZE     4096
+#define BLACKBOX_HEADER_SIZE    20
+#define BLACKBOX_CRC_START      4
+
+// Record types, the samples share the values of sample_type_t
+#define BLACKBOX_RECORD_ACC     0
+#define BLACKBOX_RECORD_MAG     1
+#define BLACKBOX_RECORD_GYRO    2
+#define BLACKBOX_RECORD_BARO    3
+#define BLACKBOX_RECORD_RC      5
+#define BLACKBOX_RECORD_LOST    6
+#define BLACKBOX_RECORD_TYPES   7
+
+#define BLACKBOX_TAG_TYPE_BITS  3
+#define BLACKBOX_TAG_TIME_ESCAPE 31
+
+// Values per record, RC frames carry their own count up to the maximum
+#define BLACKBOX_SAMPLE_VALUES  3
+#define BLACKBOX_LOST_VALUES    1
+#define BLACKBOX_MAX_VALUES     16
+
+// Tag, a 64 bit time change and every value at their longest
+#define BLACKBOX_MAX_RECORD     (1 + 10 + 1 + BLACKBOX_MAX_VALUES * 5)
+
+#endif
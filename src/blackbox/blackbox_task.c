@@ -0,0 +1,369 @@
+#include "blackbox.h"
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "common.h"
+#include "storage.h"
+#include "console.h"
+#include "periodic.h"
+#include "ppm.h"
+#include "imu.h"
+
+#define BLACKBOX_PERIOD_MS 10
+
+// A page program stops interrupts on core0, and parks core1 when it runs
+// acquisition, for ~0.4 ms typical. It is only started when the sensors
+// leave this long before their next read, and one a period is 25 KB/s,
+// several times what the log produces.
+#define PAGE_PROGRAM_US  600
+#define PAGES_PER_PERIOD 1
+
+// How long to wait for that gap. Two gyro periods at 760 Hz, at the
+// slower rates most of the time between reads is a gap.
+#define FLASH_WAIT_US    3000
+
+#define BLOCKS (STORAGE_BLACKBOX_SIZE / BLACKBOX_BLOCK_SIZE)
+#define PAGES_PER_BLOCK (BLACKBOX_BLOCK_SIZE / FLASH_PAGE_SIZE)
+
+// Dump line length in bytes
+#define DUMP_LINE 32
+
+_Static_assert(BLACKBOX_BLOCK_SIZE == FLASH_SECTOR_SIZE, "a block must be one erasable sector");
+_Static_assert(PPM_MAX_CHANNELS <= BLACKBOX_MAX_VALUES, "an RC frame must fit one record");
+
+typedef enum {
+    BLACKBOX_STOPPED,
+    BLACKBOX_LOGGING,
+    BLACKBOX_FULL,
+    BLACKBOX_ERASING
+} blackbox_state_t;
+
+// Double buffered, one block fills from the ring while the other is
+// programmed a few pages each period
+static uint8_t blocks[2][BLACKBOX_BLOCK_SIZE];
+static uint8_t filling;
+static int8_t programming = -1;     // block being programmed, -1 for none
+static uint8_t pages_done;
+static uint32_t program_block;      // where in the region it goes
+
+static blackbox_encoder_t encoder;
+static blackbox_state_t state = BLACKBOX_STOPPED;
+static bool usable;
+
+static uint32_t next_block;         // first block of the region not yet used
+static uint32_t dirty_blocks;       // everything below needs erasing
+static uint32_t erase_block;
+
+static uint32_t rc_cycle;
+static uint32_t ring_dropped;       // the ring's drop count last period
+static uint32_t lost;               // samples dropped and not yet logged
+
+// Set by the console task, run by the blackbox task
+static _Atomic char command;
+
+
+static uint32_t block_offset(uint32_t block) {
+    return STORAGE_BLACKBOX_OFFSET + block * BLACKBOX_BLOCK_SIZE;
+}
+
+
+static uint16_t block_magic(uint32_t block) {
+    const uint8_t *p = storage_read(block_offset(block));
+    return p[0] | (p[1] << 8);
+}
+
+
+static bool block_erased(uint32_t block) {
+    const uint8_t *p = storage_read(block_offset(block));
+    for (int i = 0; i < BLACKBOX_BLOCK_SIZE; i++) {
+        if (p[i] != 0xFF) return false;
+    }
+    return true;
+}
+
+
+/*
+ * Wait for a gap between sensor reads long enough for a page program,
+ * which is right after a gyro read at the higher ODRs. False if none
+ * came within FLASH_WAIT_US.
+ * Being preempted between the check and the write is harmless, the
+ * tasks above this one only run on a sensor read, which opens a new gap.
+ */
+static bool flash_window() {
+    uint64_t give_up = time_us_64() + FLASH_WAIT_US;
+
+    while (imu_idle_us() < PAGE_PROGRAM_US) {
+        if (time_us_64() >= give_up) return false;
+        taskYIELD();
+    }
+    return true;
+}
+
+
+/*
+ * Program up to max pages of the block waiting for flash, each in a gap
+ * between sensor reads. With force a page goes even when no gap came,
+ * to get everything out when logging stops.
+ */
+static void program_pages(uint8_t max, bool force) {
+    if (programming < 0) return;
+
+    for (uint8_t n = 0; n < max && pages_done < PAGES_PER_BLOCK; n++, pages_done++) {
+        if (!flash_window() && !force) break;
+
+        uint32_t at = pages_done * FLASH_PAGE_SIZE;
+        storage_program(block_offset(program_block) + at, blocks[programming] + at, FLASH_PAGE_SIZE);
+    }
+    if (pages_done == PAGES_PER_BLOCK) programming = -1;
+}
+
+
+/*
+ * Hand the full block over to be programmed and start the other one
+ * False if it cannot be, the caller drops what did not fit.
+ */
+static bool next_buffer() {
+    if (programming >= 0) return false;
+
+    if (next_block >= BLOCKS || !block_erased(next_block)) {
+        state = BLACKBOX_FULL;
+        console_printf("blackbox full, erase it to log again\n");
+        return false;
+    }
+
+    blackbox_finish_block(&encoder);
+    programming = filling;
+    program_block = next_block++;
+    if (next_block > dirty_blocks) dirty_blocks = next_block;
+    pages_done = 0;
+
+    filling ^= 1;
+    blackbox_begin_block(&encoder, blocks[filling]);
+    return true;
+}
+
+
+static bool append(uint8_t type, uint64_t timestamp_us, const int32_t *values, uint8_t count) {
+    return blackbox_add(&encoder, type, timestamp_us, values, count)
+        || (next_buffer() && blackbox_add(&encoder, type, timestamp_us, values, count));
+}
+
+
+static void add(uint8_t type, uint64_t timestamp_us, const int32_t *values, uint8_t count) {
+    if (state != BLACKBOX_LOGGING) return;
+
+    if (lost > 0) {
+        int32_t count_lost = lost;
+        if (append(BLACKBOX_RECORD_LOST, timestamp_us, &count_lost, BLACKBOX_LOST_VALUES)) lost = 0;
+    }
+    if (!append(type, timestamp_us, values, count)) lost++;
+}
+
+
+static void start() {
+    if (!usable || state == BLACKBOX_LOGGING) return;
+
+    if (next_block >= BLOCKS) {
+        state = BLACKBOX_FULL;
+        console_printf("blackbox full, erase it to log again\n");
+        return;
+    }
+
+    blackbox_begin_block(&encoder, blocks[filling]);
+    lost = 0;
+    state = BLACKBOX_LOGGING;
+    console_printf("blackbox logging from block %lu of %lu\n", (unsigned long)next_block, (unsigned long)BLOCKS);
+}
+
+
+/*
+ * Stop logging and write out everything held in RAM, from the blackbox
+ * task only
+ */
+void blackbox_stop() {
+    if (state == BLACKBOX_LOGGING && !blackbox_block_empty(&encoder)) {
+        program_pages(PAGES_PER_BLOCK, true);
+        next_buffer();
+    }
+    program_pages(PAGES_PER_BLOCK, true);
+
+    if (state == BLACKBOX_LOGGING) state = BLACKBOX_STOPPED;
+}
+
+
+/*
+ * Print the log as hex lines for tools/blackbox to read back, all 0xFF
+ * lines are left out. The end line gives the count of lines so the reader
+ * can tell if any went missing. The port is held throughout, telemetry
+ * waits until the dump is done.
+ */
+static void print_dump() {
+    blackbox_stop();
+    console_claim_port();
+
+    uint32_t lines = 0;
+    for (uint32_t block = 0; block < next_block; block++) {
+        const uint8_t *p = storage_read(block_offset(block));
+
+        for (uint32_t at = 0; at < BLACKBOX_BLOCK_SIZE; at += DUMP_LINE) {
+            bool erased = true;
+            for (int i = 0; i < DUMP_LINE; i++) erased &= p[at + i] == 0xFF;
+            if (erased) continue;
+
+            char line[16 + 2 * DUMP_LINE];
+            int length = sprintf(line, "bb %06lx ", (unsigned long)(block * BLACKBOX_BLOCK_SIZE + at));
+            for (int i = 0; i < DUMP_LINE; i++) length += sprintf(line + length, "%02x", p[at + i]);
+            printf("%s\n", line);
+            lines++;
+        }
+    }
+    printf("bb end %lu blocks %lu lines\n", (unsigned long)next_block, (unsigned long)lines);
+
+    console_release_port();
+}
+
+
+/*
+ * One sector a period, so the interrupts come back on in between
+ */
+static void erase_step() {
+    if (erase_block < dirty_blocks) {
+        storage_erase(block_offset(erase_block++), FLASH_SECTOR_SIZE);
+        return;
+    }
+
+    console_printf("blackbox erased\n");
+    next_block = 0;
+    dirty_blocks = 0;
+    blackbox_encoder_init(&encoder, 1);
+    state = BLACKBOX_STOPPED;
+    start();
+}
+
+
+static void run_command(char c) {
+    switch (c) {
+        case 'l':
+            if (state == BLACKBOX_LOGGING) {
+                blackbox_stop();
+                console_printf("blackbox stopped at block %lu\n", (unsigned long)next_block);
+            } else {
+                start();
+            }
+            break;
+        case 'd':
+            print_dump();
+            break;
+        case 'e':
+            if (!usable) break;
+            if (motors_running()) {
+                console_printf("not erasing the blackbox with the motors running\n");
+                break;
+            }
+            blackbox_stop();
+            console_printf("blackbox erasing %lu blocks\n", (unsigned long)dirty_blocks);
+            erase_block = 0;
+            state = BLACKBOX_ERASING;
+            break;
+    }
+}
+
+
+/*
+ * Requests from other tasks, run by the next blackbox_service()
+ */
+void blackbox_toggle() { command = 'l'; }
+void blackbox_dump()   { command = 'd'; }
+void blackbox_erase()  { command = 'e'; }
+
+
+bool blackbox_logging() {
+    return state == BLACKBOX_LOGGING;
+}
+
+
+/*
+ * Find the end of the log and start a new session after it. Before the
+ * scheduler starts.
+ */
+void blackbox_init() {
+    uint16_t session = 0;
+    dirty_blocks = 0;
+
+    for (uint32_t block = 0; block < BLOCKS; block++) {
+        uint16_t magic = block_magic(block);
+        if (magic == BLACKBOX_MAGIC) {
+            const uint8_t *p = storage_read(block_offset(block));
+            uint16_t block_session = p[4] | (p[5] << 8);
+            if (block_session > session) session = block_session;
+        }
+        if (magic != 0xFFFF) dirty_blocks = block + 1;
+    }
+    next_block = dirty_blocks;
+    blackbox_encoder_init(&encoder, session + 1);
+
+    usable = true;
+#ifndef UAV_HOST_BUILD
+    // The firmware image must end below the region
+    extern char __flash_binary_end;
+    if ((uintptr_t)&__flash_binary_end - XIP_BASE > STORAGE_BLACKBOX_OFFSET) {
+        console_printf("blackbox disabled, the firmware overlaps its flash\n");
+        usable = false;
+    }
+#endif
+
+    console_register('l', "start or stop the blackbox", blackbox_toggle);
+    console_register('d', "dump the blackbox as hex", blackbox_dump);
+    console_register('e', "erase the blackbox", blackbox_erase);
+
+    start();
+}
+
+
+/*
+ * Log what arrived since last time and move the flash work along
+ * The ring is drained whatever the state so it never backs up.
+ */
+void blackbox_service(sample_ring_t *ring) {
+    char c = atomic_exchange(&command, 0);
+    if (c) run_command(c);
+
+    // Each sector stops the CPU for ~45 ms, so only on the ground
+    if (state == BLACKBOX_ERASING && !motors_running()) erase_step();
+
+    uint32_t dropped = sample_ring_dropped(ring);
+    if (state == BLACKBOX_LOGGING) lost += dropped - ring_dropped;
+    ring_dropped = dropped;
+
+    sample_t sample;
+    while (sample_ring_pop(ring, &sample)) {
+        add(sample.type, sample.timestamp_us, sample.data, BLACKBOX_SAMPLE_VALUES);
+    }
+
+    ppm_frame_t frame;
+    ppm_snapshot(&frame);
+    if (frame.cycle != rc_cycle && frame.count > 0) {
+        int32_t channels[PPM_MAX_CHANNELS];
+        for (uint8_t i = 0; i < frame.count; i++) channels[i] = frame.channels[i];
+        add(BLACKBOX_RECORD_RC, frame.timestamp_us, channels, frame.count);
+    }
+    rc_cycle = frame.cycle;
+
+    program_pages(PAGES_PER_PERIOD, false);
+}
+
+
+/*
+ * Flight log writer, a low priority consumer of the raw sample ring
+ */
+void blackbox_task(void *ring) {
+    static periodic_t loop;
+    periodic_init(&loop, "Blackbox", BLACKBOX_PERIOD_MS);
+
+    while (true) {
+        periodic_wait(&loop);
+        blackbox_service((sample_ring_t *)ring);
+    }
+}
@@ -0,0 +1,416 @@
+#include "calib_fit.h"
+#include <math.h>
+#include <string.h>
+
+// Ellipsoid samples are fitted in units of this many counts around the
+// first one, which keeps the fourth powers in the normal equations tame
+#define ELLIPSOID_SCALE 1024.0
+
+// A fit whose longest axis is this many times the shortest did not see
+// enough orientations, or something magnetic moved during it
+#define ELLIPSOID_MAX_ASPECT 3.0
+
+// Fewest samples to fit nine terms with any confidence
+#define ELLIPSOID_MIN_SAMPLES 50
+
+// Each axis has to have swept at least this fraction of the widest one
+#define ELLIPSOID_MIN_COVERAGE 0.5
+
+// A face counts when the vector is within ~37 degrees of its axis
+#define FACE_MIN_COS_SQ 0.64
+
+// Limits on the accel correction before it is taken as a bad calibration
+#define SIX_MIN_SCALE      0.5
+#define SIX_MAX_SCALE      1.5
+#define SIX_MAX_CROSS_AXIS 0.2
+
+
+void calib_affine_identity(calib_affine_t *t) {
+    memset(t, 0, sizeof(*t));
+    for (int i = 0; i < 3; i++) t->matrix[i][i] = Q30_ONE;
+}
+
+
+/*
+ * Round a fitted correction into the integer transform, false if the
+ * matrix does not fit in Q2.30
+ */
+bool calib_affine_from_double(calib_affine_t *t, const double offset[3], const double matrix[3][3]) {
+    for (int i = 0; i < 3; i++) {
+        if (!(fabs(offset[i]) < 1e9)) return false;
+
+        for (int j = 0; j < 3; j++) {
+            if (!(fabs(matrix[i][j]) < 1.999)) return false;
+        }
+    }
+
+    for (int i = 0; i < 3; i++) {
+        t->offset[i] = (int32_t)lround(offset[i]);
+        for (int j = 0; j < 3; j++) {
+            t->matrix[i][j] = (q30_t)llround(matrix[i][j] * Q30_ONE);
+        }
+    }
+    return true;
+}
+
+
+void calib_rest_reset(calib_rest_t *rest) {
+    memset(rest, 0, sizeof(*rest));
+}
+
+
+void calib_rest_add(calib_rest_t *rest, const int32_t v[3]) {
+    for (int i = 0; i < 3; i++) {
+        rest->sum[i] += v[i];
+        rest->sum_sq[i] += (int64_t)v[i] * v[i];
+    }
+    rest->count++;
+}
+
+
+/*
+ * Mean of every sample added, rounded to the nearest count
+ */
+void calib_rest_mean(const calib_rest_t *rest, int32_t mean[3]) {
+    for (int i = 0; i < 3; i++) {
+        if (rest->count == 0) {
+            mean[i] = 0;
+            continue;
+        }
+        int64_t half = rest->count / 2;
+        mean[i] = (int32_t)((rest->sum[i] + (rest->sum[i] >= 0 ? half : -half)) / rest->count);
+    }
+}
+
+
+/*
+ * True when no axis has a standard deviation above max_std counts
+ * n * sum(x^2) - sum(x)^2 is n^2 times the variance, no divide needed.
+ */
+bool calib_rest_still(const calib_rest_t *rest, int32_t max_std) {
+    if (rest->count < 2) return false;
+
+    int64_t n = rest->count;
+    for (int i = 0; i < 3; i++) {
+        int64_t spread = n * rest->sum_sq[i] - rest->sum[i] * rest->sum[i];
+        if (spread > (int64_t)max_std * max_std * n * n) return false;
+    }
+    return true;
+}
+
+
+/*
+ * Gyro bias is the mean rate while still, the scale is left nominal
+ */
+bool calib_gyro_bias(const calib_rest_t *rest, int32_t max_std, calib_affine_t *out) {
+    if (!calib_rest_still(rest, max_std)) return false;
+
+    calib_affine_identity(out);
+    calib_rest_mean(rest, out->offset);
+    return true;
+}
+
+
+void calib_six_reset(calib_six_t *six) {
+    memset(six, 0, sizeof(*six));
+}
+
+
+/*
+ * Which face is down for a still reading, 0 to 5 as +X -X +Y -Y +Z -Z
+ * with the named axis pointing up, or -1 when it is between faces
+ */
+int calib_six_face(const int32_t v[3]) {
+    double sq[3] = {(double)v[0] * v[0], (double)v[1] * v[1], (double)v[2] * v[2]};
+    double norm_sq = sq[0] + sq[1] + sq[2];
+
+    for (int i = 0; i < 3; i++) {
+        if (sq[i] > FACE_MIN_COS_SQ * norm_sq) return 2 * i + (v[i] < 0);
+    }
+    return -1;
+}
+
+
+/*
+ * Record a still mean against the face it was taken on, true if that
+ * face had not been done yet
+ */
+bool calib_six_add(calib_six_t *six, const int32_t mean[3]) {
+    int face = calib_six_face(mean);
+    if (face < 0 || (six->done & (1 << face))) return false;
+
+    for (int i = 0; i < 3; i++) six->mean[face][i] = mean[i];
+    six->done |= 1 << face;
+    return true;
+}
+
+
+bool calib_six_complete(const calib_six_t *six) {
+    return six->done == (1 << CALIB_FACES) - 1;
+}
+
+
+/*
+ * 3x3 inverse through the adjugate, false if singular
+ */
+static bool invert3(const double m[3][3], double inv[3][3]) {
+    double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+               - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+               + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    if (fabs(det) < 1e-300) return false;
+
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            // Cofactor of m[j][i], the adjugate is the transpose
+            int r0 = (j + 1) % 3, r1 = (j + 2) % 3;
+            int c0 = (i + 1) % 3, c1 = (i + 2) % 3;
+            inv[i][j] = (m[r0][c0] * m[r1][c1] - m[r0][c1] * m[r1][c0]) / det;
+        }
+    }
+    return true;
+}
+
+
+/*
+ * Solve for the transform taking each face's reading to exactly one_g
+ * along its axis
+ *
+ * With true = W (raw - o), the six true vectors sum to zero so o is the
+ * mean of the six readings, and half the difference between opposite
+ * faces is one column of g W^-1.
+ */
+bool calib_six_solve(const calib_six_t *six, int32_t one_g, calib_affine_t *out) {
+    if (!calib_six_complete(six) || one_g <= 0) return false;
+
+    double offset[3];
+    double half_span[3][3];
+    for (int i = 0; i < 3; i++) {
+        offset[i] = 0;
+        for (int face = 0; face < CALIB_FACES; face++) offset[i] += six->mean[face][i];
+        offset[i] /= CALIB_FACES;
+
+        // Column per axis
+        for (int axis = 0; axis < 3; axis++) {
+            half_span[i][axis] = (six->mean[2 * axis][i] - six->mean[2 * axis + 1][i]) / 2.0;
+        }
+    }
+
+    double inv[3][3], matrix[3][3];
+    if (!invert3(half_span, inv)) return false;
+
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            matrix[i][j] = one_g * inv[i][j];
+            double limit = i == j ? SIX_MAX_SCALE : SIX_MAX_CROSS_AXIS;
+            if (fabs(matrix[i][j]) > limit) return false;
+        }
+        if (matrix[i][i] < SIX_MIN_SCALE) return false;
+    }
+    return calib_affine_from_double(out, offset, matrix);
+}
+
+
+void calib_ellipsoid_reset(calib_ellipsoid_t *fit) {
+    memset(fit, 0, sizeof(*fit));
+}
+
+
+/*
+ * Fold one sample into the normal equations of
+ * x^2 + a y^2 + b z^2 + c xy + d xz + e yz + f x + g y + h z + k = 0
+ * The x^2 term of an ellipsoid is never zero, so fixing it at 1 rather
+ * than the constant term still fits one that passes through the origin.
+ */
+void calib_ellipsoid_add(calib_ellipsoid_t *fit, const int32_t v[3]) {
+    if (fit->count == 0) {
+        for (int i = 0; i < 3; i++) {
+            fit->origin[i] = v[i];
+            fit->min[i] = v[i];
+            fit->max[i] = v[i];
+        }
+    }
+
+    for (int i = 0; i < 3; i++) {
+        if (v[i] < fit->min[i]) fit->min[i] = v[i];
+        if (v[i] > fit->max[i]) fit->max[i] = v[i];
+    }
+
+    double x = (v[0] - fit->origin[0]) / ELLIPSOID_SCALE;
+    double y = (v[1] - fit->origin[1]) / ELLIPSOID_SCALE;
+    double z = (v[2] - fit->origin[2]) / ELLIPSOID_SCALE;
+    double row[CALIB_ELLIPSOID_TERMS] = {y * y, z * z, x * y, x * z, y * z, x, y, z, 1};
+
+    for (int i = 0; i < CALIB_ELLIPSOID_TERMS; i++) {
+        for (int j = i; j < CALIB_ELLIPSOID_TERMS; j++) {
+            fit->ata[i][j] += row[i] * row[j];
+        }
+        fit->atb[i] -= row[i] * x * x;
+    }
+    fit->count++;
+}
+
+
+/*
+ * Gaussian elimination with partial pivoting, a is n x (n + 1) augmented
+ */
+static bool solve_linear(double a[CALIB_ELLIPSOID_TERMS][CALIB_ELLIPSOID_TERMS + 1], double x[CALIB_ELLIPSOID_TERMS]) {
+    const int n = CALIB_ELLIPSOID_TERMS;
+
+    for (int col = 0; col < n; col++) {
+        int pivot = col;
+        for (int row = col + 1; row < n; row++) {
+            if (fabs(a[row][col]) > fabs(a[pivot][col])) pivot = row;
+        }
+        if (fabs(a[pivot][col]) < 1e-12) return false;
+
+        if (pivot != col) {
+            for (int k = 0; k <= n; k++) {
+                double t = a[col][k];
+                a[col][k] = a[pivot][k];
+                a[pivot][k] = t;
+            }
+        }
+
+        for (int row = col + 1; row < n; row++) {
+            double f = a[row][col] / a[col][col];
+            for (int k = col; k <= n; k++) a[row][k] -= f * a[col][k];
+        }
+    }
+
+    for (int row = n - 1; row >= 0; row--) {
+        double sum = a[row][n];
+        for (int k = row + 1; k < n; k++) sum -= a[row][k] * x[k];
+        x[row] = sum / a[row][row];
+    }
+    return true;
+}
+
+
+/*
+ * Eigen decomposition of a symmetric 3x3 by Jacobi rotations
+ * m is destroyed, its diagonal ends up as the eigenvalues and the columns
+ * of v as the eigenvectors.
+ */
+static void jacobi3(double m[3][3], double v[3][3]) {
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) v[i][j] = i == j;
+    }
+
+    for (int sweep = 0; sweep < 50; sweep++) {
+        double off = m[0][1] * m[0][1] + m[0][2] * m[0][2] + m[1][2] * m[1][2];
+        if (off < 1e-30) return;
+
+        for (int p = 0; p < 2; p++) {
+            for (int q = p + 1; q < 3; q++) {
+                if (m[p][q] == 0) continue;
+
+                double theta = (m[q][q] - m[p][p]) / (2 * m[p][q]);
+                double t = (theta >= 0 ? 1 : -1) / (fabs(theta) + sqrt(theta * theta + 1));
+                double c = 1 / sqrt(t * t + 1), s = t * c;
+
+                for (int k = 0; k < 3; k++) {
+                    double mkp = m[k][p], mkq = m[k][q];
+                    m[k][p] = c * mkp - s * mkq;
+                    m[k][q] = s * mkp + c * mkq;
+                }
+                for (int k = 0; k < 3; k++) {
+                    double mpk = m[p][k], mqk = m[q][k];
+                    m[p][k] = c * mpk - s * mqk;
+                    m[q][k] = s * mpk + c * mqk;
+                }
+                for (int k = 0; k < 3; k++) {
+                    double vkp = v[k][p], vkq = v[k][q];
+                    v[k][p] = c * vkp - s * vkq;
+                    v[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+}
+
+
+/*
+ * Fit the ellipsoid and turn it into the transform mapping it onto a
+ * sphere of the same mean radius
+ *
+ * With the ellipsoid as (x - c)' M (x - c) = 1, the centre c is the hard
+ * iron offset and the symmetric square root of M the soft iron correction.
+ * The symmetric root is used rather than any other factor of M so the
+ * corrected field is not rotated out of the sensor frame.
+ */
+bool calib_ellipsoid_solve(const calib_ellipsoid_t *fit, calib_affine_t *out) {
+    if (fit->count < ELLIPSOID_MIN_SAMPLES) return false;
+
+    int32_t widest = 0;
+    for (int i = 0; i < 3; i++) {
+        if (fit->max[i] - fit->min[i] > widest) widest = fit->max[i] - fit->min[i];
+    }
+    for (int i = 0; i < 3; i++) {
+        if (fit->max[i] - fit->min[i] < ELLIPSOID_MIN_COVERAGE * widest) return false;
+    }
+
+    double a[CALIB_ELLIPSOID_TERMS][CALIB_ELLIPSOID_TERMS + 1];
+    for (int i = 0; i < CALIB_ELLIPSOID_TERMS; i++) {
+        for (int j = 0; j < CALIB_ELLIPSOID_TERMS; j++) {
+            a[i][j] = i <= j ? fit->ata[i][j] : fit->ata[j][i];
+        }
+        a[i][CALIB_ELLIPSOID_TERMS] = fit->atb[i];
+    }
+
+    double p[CALIB_ELLIPSOID_TERMS];
+    if (!solve_linear(a, p)) return false;
+
+    // x' M x + 2 u' x + p8 = 0
+    double m[3][3] = {
+        {1,        p[2] / 2, p[3] / 2},
+        {p[2] / 2, p[0],     p[4] / 2},
+        {p[3] / 2, p[4] / 2, p[1]    }
+    };
+    double u[3] = {p[5] / 2, p[6] / 2, p[7] / 2};
+
+    double inv[3][3];
+    if (!invert3(m, inv)) return false;
+
+    // Centred, (x - c)' M (x - c) = c' M c - p8
+    double centre[3], k = -p[8];
+    for (int i = 0; i < 3; i++) {
+        centre[i] = -(inv[i][0] * u[0] + inv[i][1] * u[1] + inv[i][2] * u[2]);
+    }
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) k += centre[i] * m[i][j] * centre[j];
+    }
+    if (k <= 0) return false;
+
+    double shape[3][3], vectors[3][3];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) shape[i][j] = m[i][j] / k;
+    }
+    jacobi3(shape, vectors);
+
+    double lambda[3] = {shape[0][0], shape[1][1], shape[2][2]};
+    double smallest = lambda[0], largest = lambda[0];
+    for (int i = 0; i < 3; i++) {
+        if (lambda[i] <= 0) return false;
+        if (lambda[i] < smallest) smallest = lambda[i];
+        if (lambda[i] > largest) largest = lambda[i];
+    }
+
+    // Radii go as 1 / sqrt(lambda)
+    if (largest / smallest > ELLIPSOID_MAX_ASPECT * ELLIPSOID_MAX_ASPECT) return false;
+
+    // Scale the unit sphere back up to the geometric mean radius
+    double radius = pow(lambda[0] * lambda[1] * lambda[2], -1.0 / 6);
+
+    double matrix[3][3], offset[3];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            matrix[i][j] = 0;
+            for (int e = 0; e < 3; e++) {
+                matrix[i][j] += vectors[i][e] * sqrt(lambda[e]) * vectors[j][e];
+            }
+            matrix[i][j] *= radius;
+        }
+        offset[i] = fit->origin[i] + centre[i] * ELLIPSOID_SCALE;
+    }
+    return calib_affine_from_double(out, offset, matrix);
+}
@@ -0,0 +1,98 @@
+#ifndef CALIB_FIT_H
+#define CALIB_FIT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "fixed.h"
+
+/*
+ * Sensor calibration maths
+ *
+ * Every correction ends up as one affine transform on raw counts,
+ * out = matrix * (raw - offset), so the sample path pays the same for a
+ * gyro bias as for a full soft iron correction and the output stays in
+ * the sensor's nominal counts. The estimators only see the numbers they
+ * are given, no bus, clock or flash, so they run the same on the host.
+ * Fitting is double precision and runs once per calibration.
+ */
+
+typedef struct calib_affine {
+    int32_t offset[3];      // subtracted first, counts
+    q30_t matrix[3][3];     // then applied, Q2.30
+} calib_affine_t;
+
+void calib_affine_identity(calib_affine_t *t);
+bool calib_affine_from_double(calib_affine_t *t, const double offset[3], const double matrix[3][3]);
+
+/*
+ * Correct one sample in place, 9 multiplies in 64 bits
+ */
+static inline void calib_affine_apply(const calib_affine_t *t, int32_t v[3]) {
+    int32_t d[3] = {v[0] - t->offset[0], v[1] - t->offset[1], v[2] - t->offset[2]};
+
+    for (int i = 0; i < 3; i++) {
+        int64_t sum = (int64_t)t->matrix[i][0] * d[0]
+                    + (int64_t)t->matrix[i][1] * d[1]
+                    + (int64_t)t->matrix[i][2] * d[2];
+        v[i] = (int32_t)((sum + Q30_HALF) >> 30);
+    }
+}
+
+
+/*
+ * Mean and spread of a sensor held still, for the gyro bias and for each
+ * accel position
+ */
+typedef struct calib_rest {
+    int64_t sum[3];
+    int64_t sum_sq[3];
+    uint32_t count;
+} calib_rest_t;
+
+void calib_rest_reset(calib_rest_t *rest);
+void calib_rest_add(calib_rest_t *rest, const int32_t v[3]);
+void calib_rest_mean(const calib_rest_t *rest, int32_t mean[3]);
+bool calib_rest_still(const calib_rest_t *rest, int32_t max_std);
+bool calib_gyro_bias(const calib_rest_t *rest, int32_t max_std, calib_affine_t *out);
+
+
+/*
+ * Six position accelerometer calibration
+ * The still mean with each axis pointing up and down. Offset, scale and
+ * cross axis terms all come out of inverting the six readings.
+ */
+#define CALIB_FACES 6
+
+typedef struct calib_six {
+    int32_t mean[CALIB_FACES][3];
+    uint8_t done;           // bit per face, +X -X +Y -Y +Z -Z
+} calib_six_t;
+
+void calib_six_reset(calib_six_t *six);
+int calib_six_face(const int32_t v[3]);
+bool calib_six_add(calib_six_t *six, const int32_t mean[3]);
+bool calib_six_complete(const calib_six_t *six);
+bool calib_six_solve(const calib_six_t *six, int32_t one_g, calib_affine_t *out);
+
+
+/*
+ * Magnetometer hard and soft iron, least squares ellipsoid fit
+ * Samples are folded into the normal equations as they arrive, so any
+ * number of them costs the same memory.
+ */
+#define CALIB_ELLIPSOID_TERMS 9
+
+typedef struct calib_ellipsoid {
+    double ata[CALIB_ELLIPSOID_TERMS][CALIB_ELLIPSOID_TERMS];   // upper triangle
+    double atb[CALIB_ELLIPSOID_TERMS];
+    int32_t origin[3];      // first sample, the fit is done around it
+    int32_t min[3];
+    int32_t max[3];
+    uint32_t count;
+} calib_ellipsoid_t;
+
+void calib_ellipsoid_reset(calib_ellipsoid_t *fit);
+void calib_ellipsoid_add(calib_ellipsoid_t *fit, const int32_t v[3]);
+bool calib_ellipsoid_solve(const calib_ellipsoid_t *fit, calib_affine_t *out);
+
+#endif
@@ -1,5 +1,9 @@
 #include "common.h"
 #include <FreeRTOS.h>
+#include <task.h>
+
+static motors_check_t volatile motors_check = NULL;
+
 
 static int ms_to_ticks(int ms) {
     return (ms * configTICK_RATE_HZ) / 1000;
@@ -7,4 +11,64 @@ static int ms_to_ticks(int ms) {
 
 void task_delay_ms(int ms) {
     vTaskDelay(ms_to_ticks(ms));
-}
\ No newline at end of file
+}
+
+
+void set_motors_check(motors_check_t check) {
+    motors_check = check;
+}
+
+
+bool motors_running() {
+    motors_check_t check = motors_check;
+    return check != NULL && check();
+}
+
+#ifndef UAV_STATIC_ALLOCATION
+TaskHandle_t task_create(
+    TaskFunction_t function,
+    const char *label,
+    uint32_t words,
+    void *arg,
+    UBaseType_t priority
+) {
+    TaskHandle_t handle;
+    if (xTaskCreate(function, label, words, arg, priority, &handle) != pdPASS) {
+        return NULL;
+    }
+    return handle;
+}
+#endif
+
+
+#ifdef UAV_STATIC_ALLOCATION
+/*
+ * The kernel's own tasks, which it asks for once the scheduler starts
+ */
+void vApplicationGetIdleTaskMemory(
+    StaticTask_t **tcb,
+    StackType_t **stack,
+    uint32_t *words
+) {
+    static StaticTask_t idle_tcb;
+    static StackType_t idle_stack[TASK_STACK_DEPTH(configMINIMAL_STACK_SIZE)];
+
+    *tcb = &idle_tcb;
+    *stack = idle_stack;
+    *words = sizeof(idle_stack) / sizeof(StackType_t);
+}
+
+
+void vApplicationGetTimerTaskMemory(
+    StaticTask_t **tcb,
+    StackType_t **stack,
+    uint32_t *words
+) {
+    static StaticTask_t timer_tcb;
+    static StackType_t timer_stack[TASK_STACK_DEPTH(configTIMER_TASK_STACK_DEPTH)];
+
+    *tcb = &timer_tcb;
+    *stack = timer_stack;
+    *words = sizeof(timer_stack) / sizeof(StackType_t);
+}
+#endif
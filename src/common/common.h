@@ -1,6 +1,63 @@
 #ifndef COMMON_H
 #define COMMON_H
 
+#include <stdbool.h>
+#include <FreeRTOS.h>
+#include <task.h>
+
+/*
+ * Task stack depth in words. The POSIX port runs each task on its own
+ * pthread, which needs far more room than the M0+, so pad it on the host.
+ */
+#ifdef UAV_HOST_BUILD
+#define TASK_STACK_DEPTH(words) ((words) + 4096)
+#else
+#define TASK_STACK_DEPTH(words) (words)
+#endif
+
+/*
+ * Task memory. With UAV_STATIC_ALLOCATION each task's stack and control
+ * block are static arrays, so they are fixed at link time and show up in
+ * the RAM report. Otherwise they come from the FreeRTOS heap.
+ *
+ *   TASK_MEMORY(led, 128);
+ *   TASK_CREATE(led, led_task, "LED Task", NULL, 1);
+ *
+ * TASK_CREATE() gives the task handle, NULL if it could not be created.
+ */
+#ifdef UAV_STATIC_ALLOCATION
+#define TASK_MEMORY(name, words) \
+    static StackType_t name##_stack[TASK_STACK_DEPTH(words)]; \
+    static StaticTask_t name##_tcb
+#define TASK_CREATE(name, function, label, arg, priority) \
+    xTaskCreateStatic(function, label, sizeof(name##_stack) / sizeof(StackType_t), \
+                      arg, priority, name##_stack, &name##_tcb)
+#else
+#define TASK_MEMORY(name, words) \
+    static const uint32_t name##_stack_words = TASK_STACK_DEPTH(words)
+#define TASK_CREATE(name, function, label, arg, priority) \
+    task_create(function, label, name##_stack_words, arg, priority)
+
+TaskHandle_t task_create(
+    TaskFunction_t function,
+    const char *label,
+    uint32_t words,
+    void *arg,
+    UBaseType_t priority
+);
+#endif
+
 void task_delay_ms(int ms);
 
+/*
+ * Whether the motors are running, for work that must only be done on the
+ * ground: flash erases, which stop the CPU for ~45 ms each, and sensor
+ * calibration, which swaps the live transforms. main() points it at the
+ * rate controller, until then the motors count as stopped.
+ */
+typedef bool (*motors_check_t)();
+
+void set_motors_check(motors_check_t check);
+bool motors_running();
+
 #endif
\ No newline at end of file
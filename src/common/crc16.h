@@ -0,0 +1,10 @@
+#ifndef CRC16_H
+#define CRC16_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-16/CCITT-FALSE, as on every telemetry frame and stored record
+uint16_t crc16(const uint8_t *data, size_t length);
+
+#endif
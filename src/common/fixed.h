@@ -0,0 +1,50 @@
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <stdint.h>
+
+/*
+ * Q16.16 fixed point
+ * The M0+ has no FPU, so the hot path stays in integers and only
+ * converts to float where a person has to read the number.
+ */
+typedef int32_t q16_t;
+typedef int32_t q30_t;  // for values within +-1, unit vectors and quaternions
+
+#define Q16_ONE     ((q16_t)1 << 16)
+#define Q30_ONE     ((q30_t)1 << 30)
+#define Q30_HALF    ((q30_t)1 << 29)
+
+// Compile time only, the double maths folds into a constant
+#define Q16_FROM_FLOAT(f)   ((q16_t)((f) * 65536.0 + ((f) >= 0 ? 0.5 : -0.5)))
+#define Q30_FROM_FLOAT(f)   ((q30_t)((f) * 1073741824.0 + ((f) >= 0 ? 0.5 : -0.5)))
+
+/*
+ * Raw sensor count to Q16.16 is (raw * scale) >> shift. The shift is
+ * picked per sensor so the scale fits in 16 bits and the product of an
+ * int16 count and the scale never leaves 32 bits.
+ */
+#define Q16_SCALE(units_per_lsb, shift) \
+    ((int32_t)((units_per_lsb) * (double)((int64_t)1 << (16 + (shift))) + 0.5))
+
+static inline q16_t q16_from_raw(int32_t raw, int32_t scale, int shift) {
+    return (raw * scale) >> shift;
+}
+
+static inline q16_t q16_mul(q16_t a, q16_t b) {
+    return (q16_t)(((int64_t)a * b) >> 16);
+}
+
+static inline q30_t q30_mul(q30_t a, q30_t b) {
+    return (q30_t)(((int64_t)a * b) >> 30);
+}
+
+static inline float q16_to_float(q16_t a) {
+    return a * (1.0f / 65536);
+}
+
+static inline float q30_to_float(q30_t a) {
+    return a * (1.0f / 1073741824);
+}
+
+#endif
@@ -0,0 +1,47 @@
+#include "storage.h"
+#include "hardware/sync.h"
+#include "pico/multicore.h"
+
+/*
+ * Nothing may run from flash while it is being written. Interrupts are
+ * off for the duration, and core1 is parked if it is running the
+ * acquisition loop. A page program (~0.4 ms) fits in flight between two
+ * sensor reads, see imu_idle_us(). A sector erase (~50 ms) stalls the
+ * scheduler tick, so it only belongs on the ground.
+ */
+static uint32_t begin_write() {
+#ifdef UAV_CORE1_ACQUISITION
+    multicore_lockout_start_blocking();
+#endif
+    return save_and_disable_interrupts();
+}
+
+
+static void end_write(uint32_t interrupts) {
+    restore_interrupts(interrupts);
+#ifdef UAV_CORE1_ACQUISITION
+    multicore_lockout_end_blocking();
+#endif
+}
+
+
+/*
+ * Memory mapped view of the flash at offset
+ */
+const uint8_t *storage_read(uint32_t offset) {
+    return (const uint8_t *)(XIP_BASE + offset);
+}
+
+
+void storage_erase(uint32_t offset, size_t count) {
+    uint32_t interrupts = begin_write();
+    flash_range_erase(offset, count);
+    end_write(interrupts);
+}
+
+
+void storage_program(uint32_t offset, const uint8_t *data, size_t count) {
+    uint32_t interrupts = begin_write();
+    flash_range_program(offset, data, count);
+    end_write(interrupts);
+}
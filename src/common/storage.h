@@ -0,0 +1,30 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "pico.h"
+#include "hardware/flash.h"
+
+/*
+ * Persistent data in the top of the program flash
+ *
+ * Regions are laid out downwards from the end of the part, the firmware
+ * image grows up from the start and has to stay below the lowest one.
+ * Offsets are from the start of flash. Erase works in whole sectors and
+ * programming in whole pages.
+ */
+
+// Sensor calibration, one sector
+#define STORAGE_CALIBRATION_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+
+// Blackbox flight log, everything from 512 KB up to the calibration, so
+// the firmware image has the first 512 KB
+#define STORAGE_BLACKBOX_OFFSET    (512 * 1024)
+#define STORAGE_BLACKBOX_SIZE      (STORAGE_CALIBRATION_OFFSET - STORAGE_BLACKBOX_OFFSET)
+
+const uint8_t *storage_read(uint32_t offset);
+void storage_erase(uint32_t offset, size_t count);
+void storage_program(uint32_t offset, const uint8_t *data, size_t count);
+
+#endif
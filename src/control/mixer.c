@@ -0,0 +1,101 @@
+#include "mixer.h"
+
+// Share of the roll, pitch and yaw commands each motor takes
+typedef struct mixer_factors {
+    q16_t roll;
+    q16_t pitch;
+    q16_t yaw;
+} mixer_factors_t;
+
+#define FACTORS(roll, pitch, yaw) {Q16_FROM_FLOAT(roll), Q16_FROM_FLOAT(pitch), Q16_FROM_FLOAT(yaw)}
+
+// Roll is minus the motor's distance to the right, pitch its distance
+// forward, both over the largest. Yaw is +1 for counter clockwise props.
+static const mixer_factors_t QUAD_X[MIXER_QUAD_X_MOTORS] = {
+    FACTORS(-1.0, -1.0, -1.0),              // 1 rear right
+    FACTORS(-1.0,  1.0,  1.0),              // 2 front right
+    FACTORS( 1.0, -1.0,  1.0),              // 3 rear left
+    FACTORS( 1.0,  1.0, -1.0),              // 4 front left
+};
+
+static const mixer_factors_t HEX_X[MIXER_HEX_X_MOTORS] = {
+    FACTORS(-0.5, -0.866025,  1.0),         // 1 rear right
+    FACTORS(-0.5,  0.866025,  1.0),         // 2 front right
+    FACTORS( 0.5, -0.866025, -1.0),         // 3 rear left
+    FACTORS( 0.5,  0.866025, -1.0),         // 4 front left
+    FACTORS(-1.0,  0.0,      -1.0),         // 5 right
+    FACTORS( 1.0,  0.0,       1.0),         // 6 left
+};
+
+static const mixer_factors_t OCTO_X[MIXER_OCTO_X_MOTORS] = {
+    FACTORS( 1.0,       0.414214,  1.0),    // 1 mid front left
+    FACTORS(-0.414214,  1.0,       1.0),    // 2 front right
+    FACTORS(-1.0,      -0.414214,  1.0),    // 3 mid rear right
+    FACTORS( 0.414214, -1.0,       1.0),    // 4 rear left
+    FACTORS( 0.414214,  1.0,      -1.0),    // 5 front left
+    FACTORS(-1.0,       0.414214, -1.0),    // 6 mid front right
+    FACTORS(-0.414214, -1.0,      -1.0),    // 7 rear right
+    FACTORS( 1.0,      -0.414214, -1.0),    // 8 mid rear left
+};
+
+
+/*
+ * Only ever inlined with a table and count that are constants, which is
+ * what lets the loops unroll
+ */
+static inline __attribute__((always_inline)) bool mix(
+    const mixer_factors_t *table,
+    uint8_t count,
+    const mixer_input_t *in,
+    q16_t *motors
+) {
+    q16_t spread[MIXER_MAX_MOTORS];
+    q16_t low = 0, high = 0;
+
+#pragma GCC unroll 8
+    for (uint8_t i = 0; i < count; i++) {
+        spread[i] = q16_mul(table[i].roll, in->roll)
+                  + q16_mul(table[i].pitch, in->pitch)
+                  + q16_mul(table[i].yaw, in->yaw);
+        if (spread[i] < low)  low = spread[i];
+        if (spread[i] > high) high = spread[i];
+    }
+
+    // More difference than the motors have, scale it down to fit. Only
+    // when saturated, so the divide is off the usual path.
+    bool saturated = high - low > Q16_ONE;
+    if (saturated) {
+        q16_t scale = (q16_t)(UINT32_MAX / (uint32_t)(high - low));
+#pragma GCC unroll 8
+        for (uint8_t i = 0; i < count; i++) spread[i] = q16_mul(spread[i], scale);
+        low = q16_mul(low, scale);
+        high = q16_mul(high, scale);
+    }
+
+    q16_t throttle = in->throttle;
+    if (throttle > Q16_ONE) throttle = Q16_ONE;
+    if (throttle + high > Q16_ONE) throttle = Q16_ONE - high;
+    if (throttle + low < 0) throttle = -low;
+
+#pragma GCC unroll 8
+    for (uint8_t i = 0; i < count; i++) {
+        q16_t out = throttle + spread[i];
+        motors[i] = out < 0 ? 0 : out > Q16_ONE ? Q16_ONE : out;
+    }
+    return saturated;
+}
+
+
+bool mixer_quad_x(const mixer_input_t *in, q16_t *motors) {
+    return mix(QUAD_X, MIXER_QUAD_X_MOTORS, in, motors);
+}
+
+
+bool mixer_hex_x(const mixer_input_t *in, q16_t *motors) {
+    return mix(HEX_X, MIXER_HEX_X_MOTORS, in, motors);
+}
+
+
+bool mixer_octo_x(const mixer_input_t *in, q16_t *motors) {
+    return mix(OCTO_X, MIXER_OCTO_X_MOTORS, in, motors);
+}
@@ -0,0 +1,66 @@
+#ifndef MIXER_H
+#define MIXER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "fixed.h"
+
+/*
+ * Motor mixers, one per frame
+ *
+ * Each frame's geometry is a static const table in mixer.c, and its mixer
+ * an inlined copy of one mixing routine with that table and motor count
+ * as constants, so the mix unrolls into multiplies by immediates with no
+ * loop over the geometry. Every mixer is built, for the bench, and the
+ * frame flown is picked at compile time like the board in board.h.
+ *
+ * Body axes are x forward, y right and z down, as the gyro is mounted:
+ * positive roll is right side down, pitch nose up and yaw nose right.
+ * Motors are numbered as in Betaflight, so its wiring diagrams apply,
+ * props in: motor 1 spins clockwise on the quad and counter clockwise on
+ * the hex and octo. The sign of each motor's yaw factor in mixer.c gives
+ * its direction.
+ *
+ * Commands and outputs are Q16.16, a motor from 0 (stopped) to 1.0 (full).
+ * When the roll, pitch and yaw commands need a wider spread than the
+ * motors have, all three are scaled down together and the mixer returns
+ * true. The throttle is moved as far as it takes to fit the rest, so
+ * there is full authority at zero and full throttle.
+ */
+
+#define MIXER_QUAD_X_MOTORS 4
+#define MIXER_HEX_X_MOTORS  6
+#define MIXER_OCTO_X_MOTORS 8
+#define MIXER_MAX_MOTORS    8
+
+typedef struct mixer_input {
+    q16_t throttle;
+    q16_t roll;
+    q16_t pitch;
+    q16_t yaw;
+} mixer_input_t;
+
+bool mixer_quad_x(const mixer_input_t *in, q16_t *motors);
+bool mixer_hex_x(const mixer_input_t *in, q16_t *motors);
+bool mixer_octo_x(const mixer_input_t *in, q16_t *motors);
+
+// The frame flown, UAV_FRAME in CMake
+#if !defined(UAV_FRAME_QUAD_X) && !defined(UAV_FRAME_HEX_X) && !defined(UAV_FRAME_OCTO_X)
+#define UAV_FRAME_QUAD_X
+#endif
+
+#if defined(UAV_FRAME_QUAD_X)
+#define FRAME_NAME   "quad x"
+#define FRAME_MOTORS MIXER_QUAD_X_MOTORS
+#define FRAME_MIXER  mixer_quad_x
+#elif defined(UAV_FRAME_HEX_X)
+#define FRAME_NAME   "hex x"
+#define FRAME_MOTORS MIXER_HEX_X_MOTORS
+#define FRAME_MIXER  mixer_hex_x
+#elif defined(UAV_FRAME_OCTO_X)
+#define FRAME_NAME   "octo x"
+#define FRAME_MOTORS MIXER_OCTO_X_MOTORS
+#define FRAME_MIXER  mixer_octo_x
+#endif
+
+#endif
@@ -0,0 +1,267 @@
+#include "rate_control.h"
+#include <FreeRTOS.h>
+#include <task.h>
+#include "pico/stdlib.h"
+#include "board.h"
+#include "imu.h"
+#include "ppm.h"
+#include "histogram.h"
+#include "console.h"
+#include "rate_pid.h"
+#include "esc.h"
+
+// Stick travel either side of centre, and the throttle's range
+#define RC_STICK_US          500
+#define RC_THROTTLE_MIN_US   1000
+#define RC_THROTTLE_RANGE_US 1000
+
+// Arm switch on, and the most throttle it arms at
+#define RC_ARM_ON_US         1700
+#define RC_ARM_THROTTLE_US   1050
+
+// An RC frame or gyro sample older than this stops the motors
+#define RC_TIMEOUT_US        100000
+#define GYRO_TIMEOUT_US      20000
+
+// Gaps between gyro samples longer than this are a restart, not a dt
+#define MAX_DT_US            20000
+
+// Body rate per us of stick from centre, rad/s
+#define RATE_PER_US Q16_FROM_FLOAT(RATE_CONTROL_MAX_RATE_DPS * 0.0174532925 / RC_STICK_US)
+
+// A starting point, to be tuned on the frame
+static const rate_pid_gains_t ROLL_PITCH_GAINS = {
+    .kp = 0.15f, .ki = 1.5f, .kd = 0.0005f, .i_limit = 0.2f, .limit = 0.5f
+};
+
+static const rate_pid_gains_t YAW_GAINS = {
+    .kp = 0.2f, .ki = 1.5f, .kd = 0.0f, .i_limit = 0.2f, .limit = 0.3f
+};
+
+static const char *const STAGE_NAMES[CONTROL_STAGES] = {
+    [CONTROL_STAGE_SENSOR] = "sensor",
+    [CONTROL_STAGE_PID]    = "pid",
+    [CONTROL_STAGE_MIX]    = "mix",
+    [CONTROL_STAGE_OUTPUT] = "output",
+    [CONTROL_STAGE_TOTAL]  = "total"
+};
+
+typedef struct setpoint {
+    q16_t throttle;
+    q16_t rate[3];
+} setpoint_t;
+
+// Filtered gyro samples from the IMU
+static sample_ring_t *gyro_ring;
+
+// Roll, pitch and yaw
+static rate_pid_t pids[3];
+static q16_t commands[3];
+
+// The previous mix was scaled down, so the I terms hold
+static bool saturated = false;
+
+static bool armed = false;
+static bool arm_ready = false;      // the switch has been seen off
+static uint64_t last_gyro_us = 0;
+
+// Newest outputs, for display
+static volatile q16_t motors[FRAME_MOTORS];
+static volatile bool motors_on = false;
+
+// Frames the ESCs were still busy with the last one for
+static uint32_t esc_busy = 0;
+
+// Per stage latency, and how many batches ran over the budget
+static histogram_t stages[CONTROL_STAGES];
+static uint32_t batches = 0;
+static uint32_t over_budget = 0;
+
+static TaskHandle_t control_task_handle = NULL;
+
+
+static int32_t clamp(int32_t value, int32_t low, int32_t high) {
+    return value < low ? low : value > high ? high : value;
+}
+
+
+static q16_t stick_rate(int16_t us) {
+    return clamp(us - PPM_CENTRE_US, -RC_STICK_US, RC_STICK_US) * RATE_PER_US;
+}
+
+
+/*
+ * Setpoint from the newest RC frame, which also arms and disarms
+ * Arming takes the switch going on with the throttle low. A stale frame
+ * disarms, and so does the switch, but only the switch re-arms.
+ */
+static void read_sticks(setpoint_t *setpoint, uint64_t now) {
+    ppm_frame_t frame;
+    ppm_snapshot(&frame);
+
+    bool fresh = frame.count > RC_ARM && now < frame.timestamp_us + RC_TIMEOUT_US;
+    if (!fresh) {
+        armed = false;
+    } else if (frame.channels[RC_ARM] < RC_ARM_ON_US) {
+        armed = false;
+        arm_ready = true;
+    } else if (arm_ready) {
+        armed = frame.channels[RC_THROTTLE] < RC_ARM_THROTTLE_US;
+        arm_ready = false;
+    }
+
+    if (!fresh) {
+        setpoint->throttle = 0;
+        setpoint->rate[0] = setpoint->rate[1] = setpoint->rate[2] = 0;
+        return;
+    }
+
+    int32_t throttle = clamp(frame.channels[RC_THROTTLE] - RC_THROTTLE_MIN_US, 0, RC_THROTTLE_RANGE_US);
+    setpoint->throttle = throttle * Q16_ONE / RC_THROTTLE_RANGE_US;
+
+    // Stick forward is nose down
+    setpoint->rate[0] = stick_rate(frame.channels[RC_ROLL]);
+    setpoint->rate[1] = -stick_rate(frame.channels[RC_PITCH]);
+    setpoint->rate[2] = stick_rate(frame.channels[RC_YAW]);
+}
+
+
+/*
+ * Hand the outputs to the motors, or stop them
+ */
+static void output(const q16_t *out, bool on) {
+    if (!write_all_motors(on ? out : NULL)) esc_busy++;
+
+    for (uint8_t i = 0; i < FRAME_MOTORS; i++) motors[i] = on ? out[i] : 0;
+    motors_on = on;
+}
+
+
+static void record(control_stage_t stage, uint64_t from, uint64_t to) {
+    histogram_add(&stages[stage], (uint32_t)(to - from));
+}
+
+
+/*
+ * Run the controller on whatever gyro samples have arrived
+ * No FreeRTOS calls, so it runs the same from the task or on core1.
+ */
+void rate_control_update() {
+    uint64_t start = time_us_64();
+    setpoint_t setpoint;
+    read_sticks(&setpoint, start);
+
+    if (!armed) {
+        for (int axis = 0; axis < 3; axis++) rate_pid_reset(&pids[axis]);
+    }
+
+    // Every sample steps the PIDs, at its own dt
+    uint64_t read_us = 0;
+    sample_t sample;
+    while (sample_ring_pop(gyro_ring, &sample)) {
+        if (sample.type != SAMPLE_GYRO) continue;
+
+        uint64_t dt_us = sample.timestamp_us - last_gyro_us;
+        if (last_gyro_us == 0 || sample.timestamp_us <= last_gyro_us || dt_us > MAX_DT_US) dt_us = 0;
+        last_gyro_us = sample.timestamp_us;
+        read_us = sample.timestamp_us;
+
+        for (int axis = 0; axis < 3; axis++) {
+            q16_t rate = SENSOR_CALL(BOARD_GYRO, to_q16)(sample.data[axis]);
+            commands[axis] = rate_pid_update(&pids[axis], setpoint.rate[axis], rate,
+                                             (uint32_t)dt_us, saturated || !armed);
+        }
+    }
+
+    if (read_us == 0) {
+        // Nothing new, which is only a problem once the gyro has gone quiet
+        if (start > last_gyro_us + GYRO_TIMEOUT_US) {
+            armed = false;
+            arm_ready = false;
+            output(NULL, false);
+        }
+        return;
+    }
+    uint64_t pid_done = time_us_64();
+
+    q16_t out[FRAME_MOTORS];
+    mixer_input_t in = {setpoint.throttle, commands[0], commands[1], commands[2]};
+    saturated = FRAME_MIXER(&in, out);
+    uint64_t mix_done = time_us_64();
+
+    output(out, armed);
+    uint64_t done = time_us_64();
+
+    record(CONTROL_STAGE_SENSOR, read_us, start);
+    record(CONTROL_STAGE_PID, start, pid_done);
+    record(CONTROL_STAGE_MIX, pid_done, mix_done);
+    record(CONTROL_STAGE_OUTPUT, mix_done, done);
+    record(CONTROL_STAGE_TOTAL, read_us, done);
+    batches++;
+    if (done - read_us > RATE_CONTROL_BUDGET_US) over_budget++;
+}
+
+
+/*
+ * Newest motor outputs, and whether they are driving the motors
+ */
+bool rate_control_motors(q16_t *out) {
+    for (uint8_t i = 0; i < FRAME_MOTORS; i++) out[i] = motors[i];
+    return motors_on;
+}
+
+
+static void print_latency() {
+    console_printf("rate control, %s, %s, %lu batches, %lu over the %u us budget, %lu with the ESCs busy\n",
+           FRAME_NAME, motors_on ? "armed" : "disarmed", (unsigned long)batches,
+           (unsigned long)over_budget, RATE_CONTROL_BUDGET_US, (unsigned long)esc_busy);
+    console_printf("%-8s %8s %8s %8s\n", "Stage", "p50 us", "p99 us", "max us");
+    for (int stage = 0; stage < CONTROL_STAGES; stage++) {
+        console_printf("%-8s %8lu %8lu %8lu\n", STAGE_NAMES[stage],
+               (unsigned long)histogram_percentile(&stages[stage], 50),
+               (unsigned long)histogram_percentile(&stages[stage], 99),
+               (unsigned long)stages[stage].max);
+    }
+
+    console_printf("motors  ");
+    for (uint8_t i = 0; i < FRAME_MOTORS; i++) console_printf(" %5.1f%%", q16_to_float(motors[i]) * 100);
+    console_printf("\n");
+}
+
+
+/*
+ * Set up the PIDs, with the IMU consumer ring the gyro arrives in, and
+ * register the console command. Before acquisition starts.
+ */
+void rate_control_init(sample_ring_t *ring) {
+    gyro_ring = ring;
+
+    rate_pid_init(&pids[0], &ROLL_PITCH_GAINS);
+    rate_pid_init(&pids[1], &ROLL_PITCH_GAINS);
+    rate_pid_init(&pids[2], &YAW_GAINS);
+
+    for (int stage = 0; stage < CONTROL_STAGES; stage++) histogram_reset(&stages[stage]);
+    output(NULL, false);
+
+    console_register('c', "print rate control latency and motors", print_latency);
+}
+
+
+static void wake_task() {
+    xTaskNotifyGiveIndexed(control_task_handle, RATE_CONTROL_NOTIFY_INDEX);
+}
+
+
+/*
+ * The controller as a task, above the IMU task's priority so the
+ * gyro callback switches straight to it
+ */
+void rate_control_task(void *unused) {
+    control_task_handle = xTaskGetCurrentTaskHandle();
+    imu_set_gyro_callback(wake_task);
+
+    while (true) {
+        ulTaskNotifyTakeIndexed(RATE_CONTROL_NOTIFY_INDEX, pdTRUE, pdMS_TO_TICKS(RATE_CONTROL_TIMEOUT_MS));
+        rate_control_update();
+    }
+}
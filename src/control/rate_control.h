@@ -0,0 +1,67 @@
+#ifndef RATE_CONTROL_H
+#define RATE_CONTROL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "fixed.h"
+#include "sample_ring.h"
+#include "mixer.h"
+
+/*
+ * Rate mode flight control, run on every gyro batch
+ *
+ * The IMU calls back as soon as it has published a gyro batch, and the
+ * controller drains its ring right then: the sticks give a body rate,
+ * a PID per axis drives the filtered gyro towards it, once per sample at
+ * the true time between samples, and the frame's mixer turns the newest
+ * commands and the throttle into one set of motor outputs per batch.
+ *
+ * As a task it is woken by that callback and preempts acquisition. With
+ * UAV_CORE1_ACQUISITION, which has no scheduler to wake a task from, the
+ * callback is rate_control_update() itself on core1. Either way nothing
+ * but the ring sits between the gyro read and the mixer. The IMU also
+ * calls back on each gyro release that found nothing, which is what
+ * disarms on core1 when the gyro goes quiet. The task also wakes every
+ * RATE_CONTROL_TIMEOUT_MS.
+ *
+ * Each stage is timed from the start of the bus read of the newest gyro
+ * sample, see control_stage_t, and a batch whose motor command is later
+ * than RATE_CONTROL_BUDGET_US after it counts as over budget. The console
+ * prints them with 'c'.
+ *
+ * The motors only run armed: the arm switch flipped on with the throttle
+ * low, and a fresh RC frame. Losing either stops them.
+ */
+
+#define RATE_CONTROL_BUDGET_US     500
+
+#define RATE_CONTROL_NOTIFY_INDEX  3
+
+// Wakes anyway this often, to stop the motors if the gyro goes quiet
+#define RATE_CONTROL_TIMEOUT_MS    20
+
+// Stick channels, AETR, and the arm switch
+#define RC_ROLL     0
+#define RC_PITCH    1
+#define RC_THROTTLE 2
+#define RC_YAW      3
+#define RC_ARM      4
+
+// Full stick deflection, deg/s
+#define RATE_CONTROL_MAX_RATE_DPS  400
+
+typedef enum control_stage {
+    CONTROL_STAGE_SENSOR,   // bus read, filters and attitude, to the controller starting
+    CONTROL_STAGE_PID,      // every sample of the batch through the PIDs
+    CONTROL_STAGE_MIX,
+    CONTROL_STAGE_OUTPUT,   // motor commands out
+    CONTROL_STAGE_TOTAL,    // bus read to motor command
+    CONTROL_STAGES
+} control_stage_t;
+
+void rate_control_init(sample_ring_t *ring);
+void rate_control_update();
+void rate_control_task(void *unused);
+bool rate_control_motors(q16_t *motors);
+
+#endif
@@ -0,0 +1,63 @@
+#include "rate_pid.h"
+
+// 2^50 / 1e6, a period in us times this and shifted down by 20 is the
+// period in seconds as Q2.30
+#define DT_Q30_SCALE 1125899907ull
+
+// Sample rate as Q24.8 Hz is this over the period in us, 32 bit divide
+#define RATE_Q8_SCALE (1000000u << 8)
+
+
+static q16_t clamp(int64_t value, q16_t limit) {
+    if (value > limit)  return limit;
+    if (value < -limit) return -limit;
+    return (q16_t)value;
+}
+
+
+void rate_pid_init(rate_pid_t *pid, const rate_pid_gains_t *gains) {
+    pid->kp = (q16_t)(gains->kp * 65536);
+    pid->ki = (q16_t)(gains->ki * 65536);
+    pid->kd = (q16_t)(gains->kd * 65536);
+    pid->i_limit = (q16_t)(gains->i_limit * 65536);
+    pid->limit = (q16_t)(gains->limit * 65536);
+    rate_pid_reset(pid);
+}
+
+
+void rate_pid_reset(rate_pid_t *pid) {
+    pid->integral = 0;
+    pid->last_rate = 0;
+    pid->primed = false;
+}
+
+
+/*
+ * One gyro sample, dt_us after the previous one
+ *
+ * hold_integral stops the I term growing while the mixer could not give
+ * the last command in full, so it does not wind up against the motor
+ * limits. A zero dt_us runs the P term only.
+ */
+q16_t rate_pid_update(rate_pid_t *pid, q16_t setpoint, q16_t rate, uint32_t dt_us, bool hold_integral) {
+    q16_t error = setpoint - rate;
+    q16_t out = q16_mul(pid->kp, error);
+
+    if (dt_us > 0) {
+        if (!hold_integral && pid->ki != 0) {
+            q30_t dt = (q30_t)(((uint64_t)dt_us * DT_Q30_SCALE) >> 20);
+            int64_t step = ((int64_t)q16_mul(pid->ki, error) * dt) >> 30;
+            pid->integral = clamp(pid->integral + step, pid->i_limit);
+        }
+
+        if (pid->primed && pid->kd != 0) {
+            uint32_t rate_q8 = RATE_Q8_SCALE / dt_us;
+            int64_t d = ((int64_t)q16_mul(pid->kd, rate - pid->last_rate) * rate_q8) >> 8;
+            out -= clamp(d, pid->limit);
+        }
+    }
+
+    pid->last_rate = rate;
+    pid->primed = true;
+    return clamp((int64_t)out + pid->integral, pid->limit);
+}
@@ -0,0 +1,39 @@
+#ifndef RATE_PID_H
+#define RATE_PID_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "fixed.h"
+
+/*
+ * PID on one body rate, fixed point throughout
+ * The setpoint and the measured rate are Q16.16 rad/s and the output a
+ * Q16.16 command for the mixer, where 1.0 is the full difference between
+ * the motors. The D term works on the measured rate only, so a step in
+ * the setpoint gives no kick, and sees the gyro after its filters.
+ */
+typedef struct rate_pid_gains {
+    float kp;           // command per rad/s of error
+    float ki;           // command per rad of error
+    float kd;           // command per rad/s^2 of the measured rate
+    float i_limit;      // largest command the I term may hold
+    float limit;        // largest command out
+} rate_pid_gains_t;
+
+typedef struct rate_pid {
+    q16_t kp;
+    q16_t ki;
+    q16_t kd;
+    q16_t i_limit;
+    q16_t limit;
+
+    q16_t integral;     // I term, in output units
+    q16_t last_rate;
+    bool primed;        // last_rate is valid
+} rate_pid_t;
+
+void rate_pid_init(rate_pid_t *pid, const rate_pid_gains_t *gains);
+void rate_pid_reset(rate_pid_t *pid);
+q16_t rate_pid_update(rate_pid_t *pid, q16_t setpoint, q16_t rate, uint32_t dt_us, bool hold_integral);
+
+#endif
@@ -0,0 +1,99 @@
+#include "esc.h"
+#include "hardware/dma.h"
+#include "hardware/pio.h"
+#include "esc.pio.h"
+
+/*
+ * PIO + DMA backend
+ * Frames are encoded into whichever of two buffers DMA is not reading,
+ * so the next one can be built while the last is still going out.
+ */
+
+static const PIO esc_pio = pio1;
+
+static const pio_program_t *program = NULL;
+static uint sm;
+static uint program_offset;
+static int dma_channel = -1;
+static dma_channel_config dma_config;
+
+static esc_protocol_t protocol;
+static uint8_t motor_count;
+static uint32_t pin_mask;
+
+static uint32_t buffers[2][ESC_MAX_WORDS];
+static uint8_t next = 0;
+
+
+/*
+ * Drive count motors from pin_base onwards, stopped until the first
+ * write_all_motors(). False if there is no PIO or DMA left for it.
+ */
+bool esc_init(esc_protocol_t esc_protocol, uint pin_base, uint8_t count) {
+    if (count == 0 || count > ESC_MAX_MOTORS || dma_channel >= 0) return false;
+
+    protocol = esc_protocol;
+    motor_count = count;
+    pin_mask = ((1u << count) - 1) << pin_base;
+    program = esc_is_dshot(protocol) ? &esc_dshot_program : &esc_pulse_program;
+
+    if (!pio_can_add_program(esc_pio, program)) return false;
+    int claimed = pio_claim_unused_sm(esc_pio, false);
+    if (claimed < 0) return false;
+    sm = (uint)claimed;
+    dma_channel = dma_claim_unused_channel(false);
+    if (dma_channel < 0) {
+        pio_sm_unclaim(esc_pio, sm);
+        return false;
+    }
+
+    program_offset = pio_add_program(esc_pio, program);
+    if (esc_is_dshot(protocol)) {
+        esc_dshot_program_init(esc_pio, sm, program_offset, pin_base, count, esc_cycle_hz(protocol));
+    } else {
+        esc_pulse_program_init(esc_pio, sm, program_offset, pin_base, count, esc_cycle_hz(protocol));
+    }
+
+    dma_config = dma_channel_get_default_config(dma_channel);
+    channel_config_set_transfer_data_size(&dma_config, DMA_SIZE_32);
+    channel_config_set_read_increment(&dma_config, true);
+    channel_config_set_write_increment(&dma_config, false);
+    channel_config_set_dreq(&dma_config, pio_get_dreq(esc_pio, sm, true));
+
+    pio_sm_set_enabled(esc_pio, sm, true);
+    return true;
+}
+
+
+/*
+ * One frame to every motor, outputs from 0 to 1.0, or NULL to stop them
+ * False if the previous frame has not finished going out.
+ */
+bool write_all_motors(const q16_t *outputs) {
+    // Once DMA is done the frame is only over when the state machine has
+    // pulled the last word from the FIFO too, which for pulses is the low
+    // hold after the longest ends. A frame queued during that hold waits
+    // in the FIFO until it is over, so the pins always get their gap.
+    if (dma_channel < 0 || dma_channel_is_busy(dma_channel)) return false;
+    if (!pio_sm_is_tx_fifo_empty(esc_pio, sm)) return false;
+
+    uint32_t *words = buffers[next];
+    uint8_t count = esc_encode(protocol, outputs, motor_count, words);
+    dma_channel_configure(dma_channel, &dma_config, &esc_pio->txf[sm], words, count, true);
+    next ^= 1;
+    return true;
+}
+
+
+void esc_stop() {
+    if (dma_channel < 0) return;
+
+    dma_channel_abort(dma_channel);
+    dma_channel_unclaim(dma_channel);
+    dma_channel = -1;
+
+    pio_sm_set_enabled(esc_pio, sm, false);
+    pio_sm_set_pins_with_mask(esc_pio, sm, 0, pin_mask);
+    pio_sm_unclaim(esc_pio, sm);
+    pio_remove_program(esc_pio, program, program_offset);
+}
@@ -0,0 +1,35 @@
+#ifndef ESC_H
+#define ESC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico.h"
+#include "fixed.h"
+#include "esc_encode.h"
+
+/*
+ * ESC output
+ *
+ * The motors are consecutive GPIOs from ESC_PIN_BASE, driven by one state
+ * machine on PIO1 that DMA feeds a frame at a time, so a frame costs the
+ * CPU its encoding and one DMA start. write_all_motors() is called once
+ * per control tick. The ESCs need frames to keep coming, DShot ones
+ * disarm without them.
+ *
+ * A pulse frame lasts as long as its longest pulse, which for PWM is
+ * longer than a gyro period: a call while the previous frame is still
+ * going out sends nothing and returns false, so PWM runs as fast as the
+ * pulses allow.
+ */
+
+#define ESC_PIN_BASE 6
+
+#ifndef ESC_PROTOCOL
+#define ESC_PROTOCOL ESC_DSHOT600
+#endif
+
+bool esc_init(esc_protocol_t protocol, uint pin_base, uint8_t count);
+bool write_all_motors(const q16_t *outputs);
+void esc_stop();
+
+#endif
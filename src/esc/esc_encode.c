@@ -0,0 +1,148 @@
+#include "esc_encode.h"
+
+#define DSHOT_THROTTLE_STEPS (ESC_DSHOT_THROTTLE_MAX - ESC_DSHOT_THROTTLE_MIN)
+
+// Shortest pulse and its range, in cycles at ESC_PULSE_CYCLE_HZ
+#define ONESHOT125_MIN_CYCLES 1000
+#define PWM_MIN_CYCLES        8000
+
+
+uint32_t esc_cycle_hz(esc_protocol_t protocol) {
+    switch (protocol) {
+        case ESC_DSHOT150: return 150000 * ESC_DSHOT_BIT_CYCLES;
+        case ESC_DSHOT300: return 300000 * ESC_DSHOT_BIT_CYCLES;
+        case ESC_DSHOT600: return 600000 * ESC_DSHOT_BIT_CYCLES;
+        default:           return ESC_PULSE_CYCLE_HZ;
+    }
+}
+
+
+bool esc_is_dshot(esc_protocol_t protocol) {
+    return protocol == ESC_DSHOT150 || protocol == ESC_DSHOT300 || protocol == ESC_DSHOT600;
+}
+
+
+static q16_t clamp_output(q16_t output) {
+    return output < 0 ? 0 : output > Q16_ONE ? Q16_ONE : output;
+}
+
+
+/*
+ * DShot throttle for an output from 0 to 1.0, the lowest throttle at 0
+ * as the motor is armed. ESC_DSHOT_STOP is for a disarmed motor.
+ */
+uint16_t dshot_value(q16_t output) {
+    return ESC_DSHOT_THROTTLE_MIN + (uint16_t)((clamp_output(output) * DSHOT_THROTTLE_STEPS) >> 16);
+}
+
+
+/*
+ * The 16 bits sent, MSB first: value, telemetry request, then the CRC,
+ * the XOR of the three nibbles above it
+ */
+uint16_t dshot_frame(uint16_t value, bool telemetry) {
+    uint16_t packet = (uint16_t)((value << 1) | (telemetry ? 1 : 0));
+    uint16_t crc = (packet ^ (packet >> 4) ^ (packet >> 8)) & 0x0F;
+    return (uint16_t)((packet << 4) | crc);
+}
+
+
+// A nibble of a frame spread to bit 0 of each byte, first bit lowest
+static const uint32_t SPREAD[16] = {
+    0x00000000, 0x01000000, 0x00010000, 0x01010000,
+    0x00000100, 0x01000100, 0x00010100, 0x01010100,
+    0x00000001, 0x01000001, 0x00010001, 0x01010001,
+    0x00000101, 0x01000101, 0x00010101, 0x01010101
+};
+
+
+/*
+ * Transpose count frames into ESC_DSHOT_WORDS words, a byte per bit
+ * across the motors, first bit in the low byte of the first word.
+ * Four bits of a motor at a time, shifted to its bit of each byte.
+ */
+void dshot_pack(const uint16_t *frames, uint8_t count, uint32_t *words) {
+    for (uint8_t w = 0; w < ESC_DSHOT_WORDS; w++) {
+        uint8_t shift = ESC_DSHOT_BITS - 4 * (w + 1);
+        uint32_t word = 0;
+        for (uint8_t m = 0; m < count; m++) word |= SPREAD[(frames[m] >> shift) & 0xF] << m;
+        words[w] = word;
+    }
+}
+
+
+/*
+ * Pulse width in state machine cycles for an output from 0 to 1.0
+ */
+uint32_t esc_pulse_cycles(esc_protocol_t protocol, q16_t output) {
+    uint32_t min = protocol == ESC_ONESHOT125 ? ONESHOT125_MIN_CYCLES : PWM_MIN_CYCLES;
+    return min + (uint32_t)(((uint64_t)clamp_output(output) * min) >> 16);
+}
+
+
+/*
+ * Shortest pulse frame in state machine cycles, from the start of the
+ * pulses to the start of the next
+ */
+uint32_t esc_period_cycles(esc_protocol_t protocol) {
+    uint32_t period_us = protocol == ESC_ONESHOT125 ? ESC_ONESHOT125_PERIOD_US : ESC_PWM_PERIOD_US;
+    return period_us * (ESC_PULSE_CYCLE_HZ / 1000000);
+}
+
+
+/*
+ * Segments that start every pulse together and end each at its width
+ * A motor ending within ESC_PULSE_OVERHEAD_CYCLES of the one before it
+ * ends with that one, at most 2 cycles short. Returns the word count,
+ * the last one driving every pin low until period cycles from the start,
+ * which has to be at least the longest pulse plus the overhead.
+ */
+uint8_t pulse_pack(const uint32_t *cycles, uint8_t count, uint32_t period, uint32_t *words) {
+    // Motors by width, insertion sort of at most eight
+    uint8_t order[ESC_MAX_MOTORS];
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t j = i;
+        while (j > 0 && cycles[order[j - 1]] > cycles[i]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    uint32_t levels = (1u << count) - 1;
+    uint32_t start = 0;
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t motor = order[i];
+        if (cycles[motor] >= start + ESC_PULSE_OVERHEAD_CYCLES) {
+            words[n++] = levels | ((cycles[motor] - start - ESC_PULSE_OVERHEAD_CYCLES) << 8);
+            start = cycles[motor];
+        }
+        levels &= ~(1u << motor);
+    }
+    // The state machine only takes the next frame once this hold is over
+    words[n++] = (period - start - ESC_PULSE_OVERHEAD_CYCLES) << 8;
+    return n;
+}
+
+
+/*
+ * Words for one frame to every motor, outputs from 0 to 1.0, or NULL to
+ * stop them all. Returns how many.
+ */
+uint8_t esc_encode(esc_protocol_t protocol, const q16_t *outputs, uint8_t count, uint32_t *words) {
+    if (esc_is_dshot(protocol)) {
+        uint16_t frames[ESC_MAX_MOTORS];
+        for (uint8_t m = 0; m < count; m++) {
+            frames[m] = dshot_frame(outputs ? dshot_value(outputs[m]) : ESC_DSHOT_STOP, false);
+        }
+        dshot_pack(frames, count, words);
+        return ESC_DSHOT_WORDS;
+    }
+
+    uint32_t cycles[ESC_MAX_MOTORS];
+    for (uint8_t m = 0; m < count; m++) {
+        cycles[m] = esc_pulse_cycles(protocol, outputs ? outputs[m] : 0);
+    }
+    return pulse_pack(cycles, count, esc_period_cycles(protocol), words);
+}
@@ -0,0 +1,79 @@
+#ifndef ESC_ENCODE_H
+#define ESC_ENCODE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "fixed.h"
+
+/*
+ * ESC frame encoding, pure functions of the motor outputs
+ *
+ * One PIO state machine drives every motor pin at once (esc.pio), so the
+ * encoder turns the outputs into the words it shifts out:
+ *
+ *   DShot   a byte per frame bit, bit m of it the bit of motor m, MSB
+ *           first, four bytes a word. Each bit takes ESC_DSHOT_BIT_CYCLES
+ *           state machine cycles, high for the first 3 and for the next 3
+ *           only if it is a 1, so 37.5% or 75% duty.
+ *   Pulse   OneShot125 and PWM, the pulses all start together and the
+ *           word sequence drops each motor at its width: a word is the
+ *           pin levels in the low byte and a hold of that many cycles
+ *           less ESC_PULSE_OVERHEAD_CYCLES above it. The last word
+ *           holds every pin low until the protocol's minimum period is
+ *           up, so the next frame cannot follow the longest pulse
+ *           straight away.
+ *
+ * The cycle counts here and the delays in esc.pio must agree, the host
+ * bit timing model (src/host/esc_timing.c) runs these words through the
+ * same program and checks the waveforms against the protocols.
+ */
+
+#define ESC_MAX_MOTORS 8
+
+typedef enum esc_protocol {
+    ESC_PWM,            // 1000 to 2000 us
+    ESC_ONESHOT125,     // 125 to 250 us
+    ESC_DSHOT150,
+    ESC_DSHOT300,
+    ESC_DSHOT600
+} esc_protocol_t;
+
+// DShot, 11 bit value, telemetry request and a 4 bit CRC
+#define ESC_DSHOT_BITS        16
+#define ESC_DSHOT_WORDS       (ESC_DSHOT_BITS / 4)
+#define ESC_DSHOT_BIT_CYCLES  8
+#define ESC_DSHOT_HIGH_CYCLES 3     // every bit
+#define ESC_DSHOT_DATA_CYCLES 3     // then only a 1
+
+// 0 stops the motor, 1 to 47 are commands, then the throttle
+#define ESC_DSHOT_STOP         0
+#define ESC_DSHOT_THROTTLE_MIN 48
+#define ESC_DSHOT_THROTTLE_MAX 2047
+
+// Pulse protocols run the state machine at 8 MHz
+#define ESC_PULSE_CYCLE_HZ        8000000
+#define ESC_PULSE_OVERHEAD_CYCLES 3
+#define ESC_PULSE_MAX_WORDS       (ESC_MAX_MOTORS + 1)
+
+// Shortest frame, pulse and low time, which leaves at least 250 us and
+// 500 us low after the longest pulses
+#define ESC_ONESHOT125_PERIOD_US 500
+#define ESC_PWM_PERIOD_US        2500
+
+// Enough for any protocol
+#define ESC_MAX_WORDS ESC_PULSE_MAX_WORDS
+
+uint32_t esc_cycle_hz(esc_protocol_t protocol);
+bool esc_is_dshot(esc_protocol_t protocol);
+
+uint16_t dshot_value(q16_t output);
+uint16_t dshot_frame(uint16_t value, bool telemetry);
+void dshot_pack(const uint16_t *frames, uint8_t count, uint32_t *words);
+
+uint32_t esc_pulse_cycles(esc_protocol_t protocol, q16_t output);
+uint32_t esc_period_cycles(esc_protocol_t protocol);
+uint8_t pulse_pack(const uint32_t *cycles, uint8_t count, uint32_t period, uint32_t *words);
+
+uint8_t esc_encode(esc_protocol_t protocol, const q16_t *outputs, uint8_t count, uint32_t *words);
+
+#endif
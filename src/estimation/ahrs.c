@@ -0,0 +1,210 @@
+#include "ahrs.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <math.h>
+
+// 2^44 / 2e6, turns a period in us into half of it in seconds as Q2.30
+// once shifted down by 14
+#define HALF_DT_SCALE 8796093
+
+
+/*
+ * Integer square root, rounded down
+ */
+static uint32_t isqrt32(uint32_t x) {
+    uint32_t root = 0;
+    uint32_t bit = 1u << 30;
+
+    while (bit > x) bit >>= 2;
+    while (bit) {
+        if (x >= root + bit) {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+
+static int32_t abs32(int32_t x) {
+    return x < 0 ? -x : x;
+}
+
+
+/*
+ * Scale a vector of counts to a Q2.30 unit vector
+ * One 64 bit divide per vector, the components are then multiplies.
+ * Returns false for a zero vector, which carries no direction.
+ */
+static bool normalise(const int32_t *v, q30_t *out) {
+    int32_t x = v[0], y = v[1], z = v[2];
+
+    // Keep the sum of squares inside 32 bits
+    int32_t largest = abs32(x);
+    if (abs32(y) > largest) largest = abs32(y);
+    if (abs32(z) > largest) largest = abs32(z);
+    while (largest > 32767) {
+        x >>= 1;
+        y >>= 1;
+        z >>= 1;
+        largest >>= 1;
+    }
+
+    uint32_t norm = isqrt32((uint32_t)(x * x) + (uint32_t)(y * y) + (uint32_t)(z * z));
+    if (norm == 0) return false;
+
+    int64_t inv = ((int64_t)1 << 44) / norm;
+    out[0] = (q30_t)((x * inv) >> 14);
+    out[1] = (q30_t)((y * inv) >> 14);
+    out[2] = (q30_t)((z * inv) >> 14);
+    return true;
+}
+
+
+void ahrs_init(ahrs_t *ahrs, float kp, float ki) {
+    ahrs->q[0] = Q30_ONE;
+    ahrs->q[1] = 0;
+    ahrs->q[2] = 0;
+    ahrs->q[3] = 0;
+    ahrs->integral[0] = 0;
+    ahrs->integral[1] = 0;
+    ahrs->integral[2] = 0;
+    ahrs->two_kp = (q16_t)(2 * kp * 65536);
+    ahrs->two_ki = (q16_t)(2 * ki * 65536);
+}
+
+
+/*
+ * Advance the attitude by one gyro sample
+ *
+ * gyro is the body rate in Q16.16 rad/s. acc and mag correct the drift
+ * when given, either may be NULL, so the magnetometer can be passed only
+ * on the gyro samples where it produced a new reading. dt_us is the time
+ * since the previous gyro sample.
+ */
+void ahrs_update(
+    ahrs_t *ahrs,
+    const q16_t gyro[3],
+    const int32_t *acc,
+    const int32_t *mag,
+    uint32_t dt_us
+) {
+    q30_t *q = ahrs->q;
+    q16_t g[3] = {gyro[0], gyro[1], gyro[2]};
+    q30_t a[3], m[3];
+
+    // Half the error, kept in 64 bits as the accel and mag terms can
+    // together pass the Q2.30 range
+    int64_t half_e[3] = {0, 0, 0};
+
+    q30_t half_dt = (q30_t)(((uint64_t)dt_us * HALF_DT_SCALE) >> 14);
+
+    if (acc != NULL && normalise(acc, a)) {
+        q30_t q0q0 = q30_mul(q[0], q[0]);
+        q30_t q0q1 = q30_mul(q[0], q[1]);
+        q30_t q0q2 = q30_mul(q[0], q[2]);
+        q30_t q0q3 = q30_mul(q[0], q[3]);
+        q30_t q1q1 = q30_mul(q[1], q[1]);
+        q30_t q1q2 = q30_mul(q[1], q[2]);
+        q30_t q1q3 = q30_mul(q[1], q[3]);
+        q30_t q2q2 = q30_mul(q[2], q[2]);
+        q30_t q2q3 = q30_mul(q[2], q[3]);
+        q30_t q3q3 = q30_mul(q[3], q[3]);
+
+        // Estimated direction of gravity, halved
+        q30_t half_v[3] = {
+            q1q3 - q0q2,
+            q0q1 + q2q3,
+            q0q0 - Q30_HALF + q3q3
+        };
+
+        // Error is the cross product of measured and estimated gravity
+        half_e[0] = q30_mul(a[1], half_v[2]) - q30_mul(a[2], half_v[1]);
+        half_e[1] = q30_mul(a[2], half_v[0]) - q30_mul(a[0], half_v[2]);
+        half_e[2] = q30_mul(a[0], half_v[1]) - q30_mul(a[1], half_v[0]);
+
+        if (mag != NULL && normalise(mag, m)) {
+            // Measured field rotated into the earth frame
+            q30_t hx = 2 * (q30_mul(m[0], Q30_HALF - q2q2 - q3q3)
+                          + q30_mul(m[1], q1q2 - q0q3)
+                          + q30_mul(m[2], q1q3 + q0q2));
+            q30_t hy = 2 * (q30_mul(m[0], q1q2 + q0q3)
+                          + q30_mul(m[1], Q30_HALF - q1q1 - q3q3)
+                          + q30_mul(m[2], q2q3 - q0q1));
+            q30_t bz = 2 * (q30_mul(m[0], q1q3 - q0q2)
+                          + q30_mul(m[1], q2q3 + q0q1)
+                          + q30_mul(m[2], Q30_HALF - q1q1 - q2q2));
+
+            // Horizontal part points north, only 15 bits but plenty here
+            q30_t bx = (q30_t)(isqrt32((uint32_t)(q30_mul(hx, hx) + q30_mul(hy, hy))) << 15);
+
+            // Estimated direction of the field, halved
+            q30_t half_w[3] = {
+                q30_mul(bx, Q30_HALF - q2q2 - q3q3) + q30_mul(bz, q1q3 - q0q2),
+                q30_mul(bx, q1q2 - q0q3) + q30_mul(bz, q0q1 + q2q3),
+                q30_mul(bx, q0q2 + q1q3) + q30_mul(bz, Q30_HALF - q1q1 - q2q2)
+            };
+
+            half_e[0] += q30_mul(m[1], half_w[2]) - q30_mul(m[2], half_w[1]);
+            half_e[1] += q30_mul(m[2], half_w[0]) - q30_mul(m[0], half_w[2]);
+            half_e[2] += q30_mul(m[0], half_w[1]) - q30_mul(m[1], half_w[0]);
+        }
+
+        for (int i = 0; i < 3; i++) {
+            if (ahrs->two_ki > 0) {
+                // Ki * e * dt, with dt as twice half_dt. Summed at Q2.30
+                // so the small steps near convergence do not round away.
+                int64_t rate = (ahrs->two_ki * half_e[i]) >> 16;
+                ahrs->integral[i] += (q30_t)((rate * half_dt) >> 29);
+                g[i] += ahrs->integral[i] >> 14;
+            }
+            g[i] += (q16_t)((ahrs->two_kp * half_e[i]) >> 30);
+        }
+    }
+
+    // Rotation over this sample, halved, as Q2.30 radians
+    q30_t gx = (q30_t)(((int64_t)g[0] * half_dt) >> 16);
+    q30_t gy = (q30_t)(((int64_t)g[1] * half_dt) >> 16);
+    q30_t gz = (q30_t)(((int64_t)g[2] * half_dt) >> 16);
+
+    q30_t qa = q[0], qb = q[1], qc = q[2], qd = q[3];
+    q[0] += -q30_mul(qb, gx) - q30_mul(qc, gy) - q30_mul(qd, gz);
+    q[1] +=  q30_mul(qa, gx) + q30_mul(qc, gz) - q30_mul(qd, gy);
+    q[2] +=  q30_mul(qa, gy) - q30_mul(qb, gz) + q30_mul(qd, gx);
+    q[3] +=  q30_mul(qa, gz) + q30_mul(qb, gy) - q30_mul(qc, gx);
+
+    // Renormalise. One sample only moves the norm a tiny amount from 1,
+    // where 1/sqrt(n) ~= (3 - n) / 2 is exact to second order.
+    int64_t n = ((int64_t)q[0] * q[0] + (int64_t)q[1] * q[1]
+               + (int64_t)q[2] * q[2] + (int64_t)q[3] * q[3]) >> 30;
+    q30_t inv_norm = (q30_t)((3 * (int64_t)Q30_ONE - n) >> 1);
+    for (int i = 0; i < 4; i++) {
+        q[i] = q30_mul(q[i], inv_norm);
+    }
+}
+
+
+/*
+ * Euler angles in degrees, float is fine here as it is only for output
+ */
+Attitude ahrs_attitude(const ahrs_t *ahrs) {
+    float w = q30_to_float(ahrs->q[0]);
+    float x = q30_to_float(ahrs->q[1]);
+    float y = q30_to_float(ahrs->q[2]);
+    float z = q30_to_float(ahrs->q[3]);
+    const float to_deg = 57.2957795f;
+
+    float sin_pitch = 2 * (w * y - z * x);
+    if (sin_pitch > 1)  sin_pitch = 1;
+    if (sin_pitch < -1) sin_pitch = -1;
+
+    Attitude att = {
+        atan2f(2 * (w * x + y * z), 1 - 2 * (x * x + y * y)) * to_deg,
+        asinf(sin_pitch) * to_deg,
+        atan2f(2 * (w * z + x * y), 1 - 2 * (y * y + z * z)) * to_deg
+    };
+    return att;
+}
@@ -0,0 +1,41 @@
+#ifndef AHRS_H
+#define AHRS_H
+
+#include <stdint.h>
+#include "fixed.h"
+
+/*
+ * Mahony complementary filter, fixed point throughout
+ * The quaternion and unit vectors are Q2.30 and the body rates Q16.16
+ * rad/s, so the update runs on the M0+ without touching the soft float
+ * library. Accel and mag only contribute a direction, so they go in as
+ * raw (or calibrated) counts in any units.
+ */
+typedef struct ahrs {
+    q30_t q[4];         // w, x, y, z, rotates body frame to earth frame
+    q30_t integral[3];  // integral feedback, rad/s
+    q16_t two_kp;
+    q16_t two_ki;
+} ahrs_t;
+
+// Attitude in degrees, for display only
+typedef struct attitude {
+    float roll;
+    float pitch;
+    float yaw;
+} Attitude;
+
+#define AHRS_DEFAULT_KP 0.5f
+#define AHRS_DEFAULT_KI 0.0f
+
+void ahrs_init(ahrs_t *ahrs, float kp, float ki);
+void ahrs_update(
+    ahrs_t *ahrs,
+    const q16_t gyro[3],
+    const int32_t *acc,
+    const int32_t *mag,
+    uint32_t dt_us
+);
+Attitude ahrs_attitude(const ahrs_t *ahrs);
+
+#endif
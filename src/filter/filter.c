@@ -0,0 +1,160 @@
+#include "filter.h"
+#include <math.h>
+
+#define PI 3.14159265358979323846
+
+// A PT2 made of two PT1s at the cutoff is -6 dB there, each of them is
+// moved up by 1 / sqrt(2^(1/2) - 1) so the pair is -3 dB instead
+#define PT2_CUTOFF_CORRECTION 1.55377397
+
+
+/*
+ * Double to Q2.30, saturating at the ends of the range
+ */
+static q30_t to_q30(double x) {
+    double scaled = x * Q30_ONE;
+    if (scaled >= 2147483647.0)  return INT32_MAX;
+    if (scaled <= -2147483648.0) return INT32_MIN;
+    return (q30_t)lround(scaled);
+}
+
+
+static void set_coeffs(biquad_coeffs_t *c, double b0, double b1, double b2,
+                       double a0, double a1, double a2) {
+    c->b0 = to_q30(b0 / a0);
+    c->b1 = to_q30(b1 / a0);
+    c->b2 = to_q30(b2 / a0);
+    c->a1 = to_q30(a1 / a0);
+    c->a2 = to_q30(a2 / a0);
+}
+
+
+/*
+ * One section of the given type, from the RBJ audio EQ cookbook for the
+ * second order ones. PT2 designs one of its two PT1 sections.
+ * Returns false for a cutoff outside (0, sample_hz / 2).
+ */
+bool biquad_design(biquad_coeffs_t *c, filter_type_t type, float cutoff_hz, float q, float sample_hz) {
+    double fc = cutoff_hz;
+    if (type == FILTER_PT2) fc *= PT2_CUTOFF_CORRECTION;
+    if (fc <= 0 || fc >= sample_hz / 2.0) return false;
+
+    double w0 = 2 * PI * fc / sample_hz;
+    double cos_w0 = cos(w0);
+    double alpha = sin(w0) / (2 * q);
+
+    switch (type) {
+        case FILTER_PT1:
+        case FILTER_PT2: {
+            // y += k (x - y), as a biquad with only b0 and a1
+            double rc = 1 / (2 * PI * fc);
+            double dt = 1 / (double)sample_hz;
+            double k = dt / (rc + dt);
+            set_coeffs(c, k, 0, 0, 1, -(1 - k), 0);
+            return true;
+        }
+
+        case FILTER_LOWPASS:
+            if (q <= 0) return false;
+            set_coeffs(c, (1 - cos_w0) / 2, 1 - cos_w0, (1 - cos_w0) / 2,
+                       1 + alpha, -2 * cos_w0, 1 - alpha);
+            return true;
+
+        case FILTER_NOTCH:
+            if (q <= 0) return false;
+            set_coeffs(c, 1, -2 * cos_w0, 1, 1 + alpha, -2 * cos_w0, 1 - alpha);
+            return true;
+    }
+    return false;
+}
+
+
+void filter_chain_init(filter_chain_t *chain) {
+    chain->count = 0;
+}
+
+
+/*
+ * Clear the history of every stage, the coefficients are kept
+ */
+void filter_chain_reset(filter_chain_t *chain) {
+    for (uint8_t i = 0; i < chain->count; i++) {
+        biquad_t *stage = &chain->stages[i];
+        for (int axis = 0; axis < 3; axis++) {
+            stage->x1[axis] = stage->x2[axis] = 0;
+            stage->y1[axis] = stage->y2[axis] = 0;
+            stage->error[axis] = 0;
+        }
+    }
+}
+
+
+/*
+ * Append a filter to the chain, false if it does not fit or the design
+ * failed. The chain is left as it was on failure.
+ */
+bool filter_chain_add(filter_chain_t *chain, const filter_config_t *config, float sample_hz) {
+    uint8_t stages = config->type == FILTER_PT2 ? 2 : 1;
+    if (chain->count + stages > FILTER_MAX_STAGES) return false;
+
+    biquad_coeffs_t c;
+    if (!biquad_design(&c, config->type, config->cutoff_hz, config->q, sample_hz)) return false;
+
+    for (uint8_t i = 0; i < stages; i++) {
+        biquad_t *stage = &chain->stages[chain->count++];
+        stage->c = c;
+    }
+    filter_chain_reset(chain);
+    return true;
+}
+
+
+/*
+ * Replace the chain with the given filters, in order
+ */
+bool filter_chain_configure(filter_chain_t *chain, const filter_config_t *configs, uint8_t count, float sample_hz) {
+    filter_chain_init(chain);
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (!filter_chain_add(chain, &configs[i], sample_hz)) return false;
+    }
+    return true;
+}
+
+
+/*
+ * One sample through one section, in place on all three axes
+ * The 64 bit sum has room for any int16 count times five Q2.30 terms.
+ */
+void biquad_apply(biquad_t *stage, int32_t v[3]) {
+    const biquad_coeffs_t *c = &stage->c;
+
+    for (int axis = 0; axis < 3; axis++) {
+        int32_t x = v[axis];
+        int64_t acc = (int64_t)c->b0 * x
+                    + (int64_t)c->b1 * stage->x1[axis]
+                    + (int64_t)c->b2 * stage->x2[axis]
+                    - (int64_t)c->a1 * stage->y1[axis]
+                    - (int64_t)c->a2 * stage->y2[axis]
+                    + stage->error[axis];
+
+        int32_t y = (int32_t)(acc >> 30);
+        stage->error[axis] = (int32_t)(acc - ((int64_t)y << 30));
+
+        stage->x2[axis] = stage->x1[axis];
+        stage->x1[axis] = x;
+        stage->y2[axis] = stage->y1[axis];
+        stage->y1[axis] = y;
+        v[axis] = y;
+    }
+}
+
+
+/*
+ * One 3 axis sample through every stage, in place
+ */
+void filter_chain_apply(filter_chain_t *chain, int32_t v[3]) {
+    for (uint8_t i = 0; i < chain->count; i++) {
+        biquad_apply(&chain->stages[i], v);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "fixed.h"
+
+/*
+ * Streaming filters for 3 axis sensor samples
+ *
+ * Every stage is one biquad section in direct form I, including the first
+ * order PT1, so a whole chain runs through the same kernel. Coefficients
+ * are Q2.30 and the samples stay in raw counts, so nothing on the sample
+ * path touches the soft float library. The rounding error of each output
+ * is carried into the next one, which keeps a low cutoff from settling a
+ * count away from the input. The state is laid out per term with the
+ * three axes side by side.
+ *
+ * Filters are designed at runtime from a cutoff and the sample rate, the
+ * design itself is double precision and only runs when a chain is set up.
+ */
+
+#define FILTER_MAX_STAGES 4
+
+// Q for a maximally flat second order low pass
+#define FILTER_BUTTERWORTH_Q 0.70710678f
+
+typedef enum {
+    FILTER_PT1,         // first order low pass
+    FILTER_PT2,         // two PT1s, cutoff corrected so the pair is -3 dB there, two stages
+    FILTER_LOWPASS,     // second order low pass, q sets the peaking
+    FILTER_NOTCH        // band stop at the cutoff, q is centre over bandwidth
+} filter_type_t;
+
+typedef struct filter_config {
+    filter_type_t type;
+    float cutoff_hz;
+    float q;            // unused by PT1 and PT2
+} filter_config_t;
+
+// y = b0 x + b1 x1 + b2 x2 - a1 y1 - a2 y2
+typedef struct biquad_coeffs {
+    q30_t b0, b1, b2;
+    q30_t a1, a2;
+} biquad_coeffs_t;
+
+typedef struct biquad {
+    biquad_coeffs_t c;
+    int32_t x1[3], x2[3];
+    int32_t y1[3], y2[3];
+    int32_t error[3];   // fraction below the output count, Q2.30
+} biquad_t;
+
+typedef struct filter_chain {
+    uint8_t count;
+    biquad_t stages[FILTER_MAX_STAGES];
+} filter_chain_t;
+
+void filter_chain_init(filter_chain_t *chain);
+bool filter_chain_add(filter_chain_t *chain, const filter_config_t *config, float sample_hz);
+bool filter_chain_configure(filter_chain_t *chain, const filter_config_t *configs, uint8_t count, float sample_hz);
+void filter_chain_reset(filter_chain_t *chain);
+void filter_chain_apply(filter_chain_t *chain, int32_t v[3]);
+
+bool biquad_design(biquad_coeffs_t *c, filter_type_t type, float cutoff_hz, float q, float sample_hz);
+void biquad_apply(biquad_t *stage, int32_t v[3]);
+
+#endif
@@ -0,0 +1,202 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "storage.h"
+#include "blackbox.h"
+#include "ppm.h"
+
+/*
+ * Blackbox throughput and wear on the simulated flash
+ *
+ *   blackbox_sim [--csv file] [seconds [gyro Hz [flights]]]
+ *
+ * Feeds the real blackbox a synthetic flight through its raw ring, in
+ * virtual time and so as fast as it runs: the gyro at full ODR, accel,
+ * mag, baro and RC at their board rates, serviced every 10 ms like the
+ * task. Then reports the log rate, how long a flight the region holds
+ * and the flash work. More than one flight erases the log in between,
+ * as from the console.
+ *
+ * --csv writes every sample the way blackbox_decode prints it, to check
+ * the round trip through a flash image:
+ *
+ *   UAV_FLASH_IMAGE=flight.bin ./blackbox_sim --csv sent.csv 60
+ *   ./blackbox_decode flight.bin | diff - sent.csv
+ */
+
+/*
+ * #Defines
+ */
+#define SERVICE_US   10000
+#define ACC_HZ       50
+#define MAG_HZ       50
+#define BARO_HZ      100
+#define RC_HZ        50
+#define RC_CHANNELS  8
+
+static sample_ring_t ring;
+static FILE *csv;
+static uint32_t seed = 1;
+
+// Samples of each type so far, for even timestamps at any rate
+static uint64_t emitted[4];
+
+
+static int32_t noise(int32_t amplitude) {
+    seed = seed * 1664525 + 1013904223;
+    return (int32_t)((seed >> 16) % (2 * amplitude + 1)) - amplitude;
+}
+
+
+static const char *type_name(uint8_t type) {
+    static const char *const NAMES[] = {"acc", "mag", "gyro", "baro"};
+    return NAMES[type];
+}
+
+
+/*
+ * Every sample of a type due before end_us, as the drivers would read
+ * them on a manoeuvring airframe
+ */
+static void emit(uint8_t type, uint32_t hz, uint64_t end_us) {
+    while (true) {
+        uint64_t t = emitted[type] * 1000000 / hz;
+        if (t >= end_us) return;
+        emitted[type]++;
+
+        double s = t * 1e-6;
+        sample_t sample = {.timestamp_us = t, .type = type};
+        switch (type) {
+            case SAMPLE_GYRO:
+                sample.data[0] = (int32_t)(4000 * sin(2.1 * s)) + noise(12);
+                sample.data[1] = (int32_t)(3000 * sin(1.3 * s + 1)) + noise(12);
+                sample.data[2] = (int32_t)(1500 * sin(0.4 * s)) + noise(12);
+                break;
+            case SAMPLE_ACC:
+                sample.data[0] = (int32_t)(2000 * sin(0.9 * s)) + noise(60);
+                sample.data[1] = (int32_t)(2000 * cos(0.7 * s)) + noise(60);
+                sample.data[2] = 16384 + noise(60);
+                break;
+            case SAMPLE_MAG:
+                sample.data[0] = (int32_t)(2000 * cos(0.3 * s)) + noise(8);
+                sample.data[1] = (int32_t)(2000 * sin(0.3 * s)) + noise(8);
+                sample.data[2] = -3000 + noise(8);
+                break;
+            case SAMPLE_BARO:
+                sample.data[0] = 100000 - (int32_t)(120 * s) % 1200 + noise(3);
+                sample.data[1] = 215 + noise(1);
+                sample.data[2] = (int32_t)(120 * 8.3 * s) % 10000;
+                break;
+        }
+
+        sample_ring_push(&ring, &sample);
+        if (csv) {
+            fprintf(csv, "%s,%llu,%ld,%ld,%ld\n", type_name(type), (unsigned long long)t,
+                   (long)sample.data[0], (long)sample.data[1], (long)sample.data[2]);
+        }
+    }
+}
+
+
+static void emit_rc(uint64_t t) {
+    uint32_t widths[RC_CHANNELS];
+    double s = t * 1e-6;
+
+    for (int i = 0; i < RC_CHANNELS; i++) {
+        widths[i] = i < 4 ? 1500 + (int32_t)(300 * sin(0.5 * s + i)) : (i & 1 ? 1000 : 2000);
+    }
+    ppm_publish_frame(widths, RC_CHANNELS, t);
+
+    if (csv) {
+        fprintf(csv, "rc,%llu", (unsigned long long)t);
+        for (int i = 0; i < RC_CHANNELS; i++) fprintf(csv, ",%lu", (unsigned long)widths[i]);
+        fprintf(csv, "\n");
+    }
+}
+
+
+/*
+ * One flight, returns how much of it was logged before the region filled
+ */
+static uint64_t fly(uint64_t duration_us, uint32_t gyro_hz) {
+    uint64_t next_rc = 0;
+    uint64_t now;
+    memset(emitted, 0, sizeof(emitted));
+
+    for (now = SERVICE_US; now <= duration_us && blackbox_logging(); now += SERVICE_US) {
+        emit(SAMPLE_GYRO, gyro_hz, now);
+        emit(SAMPLE_ACC, ACC_HZ, now);
+        emit(SAMPLE_MAG, MAG_HZ, now);
+        emit(SAMPLE_BARO, BARO_HZ, now);
+
+        // At most one frame a service, logged after the samples
+        if (next_rc < now) {
+            emit_rc(next_rc);
+            next_rc += 1000000 / RC_HZ;
+        }
+
+        blackbox_service(&ring);
+    }
+    blackbox_stop();
+    return now - SERVICE_US;
+}
+
+
+int main(int argc, char **argv) {
+    double seconds = 60;
+    uint32_t gyro_hz = 760;
+    int flights = 1;
+
+    int arg = 1;
+    if (arg + 1 < argc && strcmp(argv[arg], "--csv") == 0) {
+        csv = fopen(argv[arg + 1], "w");
+        if (csv == NULL) {
+            perror(argv[arg + 1]);
+            return 1;
+        }
+        arg += 2;
+    }
+    if (arg < argc) seconds = atof(argv[arg++]);
+    if (arg < argc) gyro_hz = atoi(argv[arg++]);
+    if (arg < argc) flights = atoi(argv[arg++]);
+
+    sample_ring_init(&ring);
+
+    uint64_t duration_us = (uint64_t)(seconds * 1e6);
+    uint64_t logged_us = 0;
+    uint64_t start = time_us_64();
+
+    for (int flight = 0; flight < flights; flight++) {
+        if (flight > 0) {
+            blackbox_erase();
+            do blackbox_service(&ring); while (!blackbox_logging());
+        } else {
+            blackbox_init();
+        }
+        logged_us += fly(duration_us, gyro_hz);
+    }
+    uint64_t wall_us = time_us_64() - start;
+
+    host_flash_stats_t stats;
+    host_flash_stats(&stats);
+
+    double bytes_per_s = (double)stats.page_programs * FLASH_PAGE_SIZE / (logged_us * 1e-6);
+    double samples_per_s = gyro_hz + ACC_HZ + MAG_HZ + BARO_HZ + RC_HZ;
+
+    printf("%d x %.0f s of flight, gyro at %lu Hz, %.0f s logged in %.2f s\n",
+           flights, seconds, (unsigned long)gyro_hz, logged_us * 1e-6, wall_us * 1e-6);
+    printf("log      %.0f bytes/s, %.2f bytes/record, region holds %.1f min\n",
+           bytes_per_s, bytes_per_s / samples_per_s, STORAGE_BLACKBOX_SIZE / bytes_per_s / 60);
+    printf("flash    %lu pages programmed, %lu sectors erased, worst sector %lu erases\n",
+           (unsigned long)stats.page_programs, (unsigned long)stats.sector_erases,
+           (unsigned long)stats.max_erases);
+    printf("busy     %.2f%% of flight programming, %.1f s erasing\n",
+           100.0 * stats.page_programs * HOST_FLASH_PAGE_PROGRAM_US / logged_us,
+           stats.sector_erases * HOST_FLASH_SECTOR_ERASE_US * 1e-6);
+
+    if (csv) fclose(csv);
+    return 0;
+}
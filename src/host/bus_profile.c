@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "sim/i2c_sim.h"
+#include "board.h"
+#include "gy89/lsm303d.h"
+#include "gy89/l3gd20.h"
+#include "gy89/bmp180.h"
+
+/*
+ * Bus cost of each GY-89 driver call, measured on the simulated bus
+ *
+ * Runs the real drivers without the scheduler and prints the average
+ * transactions, bytes and wire time per call at the firmware's baudrate.
+ */
+
+/*
+ * #Defines
+ */
+#define CALLS    20
+
+static const sensor_bus_t bus = BOARD_BUS;
+
+static bmp180_t bmp180;
+
+typedef struct profiled_call {
+    const char *name;
+    void (*call)(void);
+} profiled_call_t;
+
+static void call_read_acceleration(void) { read_acceleration(); }
+static void call_read_magnetometer(void) { read_magnetometer(); }
+static void call_read_gyroscope(void)    { read_gyroscope(); }
+static void call_read_barometer(void)    { read_barometer(&bmp180); }
+
+static RawXYZ acc_fifo[LSM303D_FIFO_DEPTH];
+static RawXYZ gyro_fifo[L3GD20_FIFO_DEPTH];
+
+static uint8_t drain_acceleration_fifo(void) { return read_acceleration_fifo(acc_fifo, LSM303D_FIFO_DEPTH); }
+static uint8_t drain_gyroscope_fifo(void)    { return read_gyroscope_fifo(gyro_fifo, L3GD20_FIFO_DEPTH); }
+
+typedef struct profiled_drain {
+    const char *name;
+    uint32_t fill_ms;       // time for the FIFO to collect a batch
+    uint8_t (*drain)(void);
+} profiled_drain_t;
+
+static const profiled_drain_t DRAINS_TO_PROFILE[] = {
+    {"acc fifo @ 50Hz",   400, drain_acceleration_fifo},
+    {"gyro fifo @ 760Hz", 30,  drain_gyroscope_fifo},
+};
+
+static const profiled_call_t CALLS_TO_PROFILE[] = {
+    {"read_acceleration", call_read_acceleration},
+    {"read_magnetometer", call_read_magnetometer},
+    {"read_gyroscope",    call_read_gyroscope},
+    {"read_barometer",    call_read_barometer},
+};
+
+
+int main() {
+    stdio_init_all();
+    sensor_bus_init(&bus);
+
+    if (!init_lsm303d(bus.i2c) || !init_l3gd20(bus.i2c) || !bmp180_init(&bmp180, bus.i2c)) {
+        printf("GY-89 init failed\n");
+        return 1;
+    }
+
+    printf("%-20s %8s %8s %12s %12s\n", "call", "xfers", "bytes", "bus us", "wall us");
+    for (size_t i = 0; i < sizeof(CALLS_TO_PROFILE) / sizeof(CALLS_TO_PROFILE[0]); i++) {
+        const profiled_call_t *profiled = &CALLS_TO_PROFILE[i];
+
+        i2c_sim_reset_stats(bus.i2c);
+        uint64_t start = time_us_64();
+        for (int n = 0; n < CALLS; n++) profiled->call();
+        uint64_t wall = time_us_64() - start;
+
+        i2c_sim_stats_t stats = i2c_sim_get_stats(bus.i2c);
+        printf("%-20s %8.1f %8.1f %12.1f %12.1f\n",
+            profiled->name,
+            (double)stats.transactions / CALLS,
+            (double)stats.bytes / CALLS,
+            stats.bus_time_ns / 1000.0 / CALLS,
+            (double)wall / CALLS
+        );
+    }
+
+    // Burst reads amortise the addressing over every sample in the FIFO
+    l3gd20_set_odr(L3GD20_ODR_760HZ);
+    lsm303d_enable_fifo(0);
+    l3gd20_enable_fifo(0);
+
+    printf("\n%-20s %8s %8s %12s %12s\n", "fifo drain", "samples", "xfers", "bytes/samp", "bus us/samp");
+    for (size_t i = 0; i < sizeof(DRAINS_TO_PROFILE) / sizeof(DRAINS_TO_PROFILE[0]); i++) {
+        const profiled_drain_t *profiled = &DRAINS_TO_PROFILE[i];
+
+        profiled->drain();
+        sleep_ms(profiled->fill_ms);
+        i2c_sim_reset_stats(bus.i2c);
+        uint8_t samples = profiled->drain();
+
+        i2c_sim_stats_t stats = i2c_sim_get_stats(bus.i2c);
+        printf("%-20s %8u %8lu %12.1f %12.1f\n",
+            profiled->name,
+            samples,
+            (unsigned long)stats.transactions,
+            samples ? (double)stats.bytes / samples : 0.0,
+            samples ? stats.bus_time_ns / 1000.0 / samples : 0.0
+        );
+    }
+    return 0;
+}
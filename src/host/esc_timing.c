@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "esc_encode.h"
+
+/*
+ * Bit timing model of the ESC output
+ *
+ *   esc_timing [frames]
+ *
+ * Runs encoded frames through a cycle model of the state machine
+ * programs in src/esc/esc.pio, instruction for instruction, and decodes
+ * the waveform on each motor pin the way an ESC would: DShot bits from
+ * the high time in each bit period, pulse widths from the edges. Every
+ * protocol is swept over random outputs, the extremes, equal and nearly
+ * equal widths and the stop frame, on 4, 6 and 8 motors. Pulse frames
+ * also have to last the protocol's minimum period, with the pins low
+ * for at least its period less the longest pulse before the next frame
+ * can start. Prints the timing each protocol came out with and exits
+ * with 1 if any frame decoded to something other than what was encoded
+ * or came short of its gap.
+ */
+
+/*
+ * #Defines
+ */
+#define DEFAULT_FRAMES 2000
+
+// Pulses the decoder holds per pin, a DShot frame has 16
+#define MAX_PULSES 32
+
+// The instructions the programs use
+typedef enum op {
+    OP_OUT_PINS,
+    OP_OUT_X,
+    OP_MOV_PINS_NOT_NULL,
+    OP_MOV_PINS_X,
+    OP_MOV_PINS_NULL,
+    OP_JMP_X_DEC
+} op_t;
+
+typedef struct instruction {
+    op_t op;
+    uint8_t bits;       // OUT bit count
+    uint8_t delay;
+    uint8_t target;     // JMP
+} instruction_t;
+
+// esc.pio, wrapping from the last instruction back to the first
+static const instruction_t DSHOT_PROGRAM[] = {
+    {OP_OUT_X, 8, 0, 0},                // out x, 8
+    {OP_MOV_PINS_NOT_NULL, 0, 2, 0},    // mov pins, ~null [2]
+    {OP_MOV_PINS_X, 0, 2, 0},           // mov pins, x     [2]
+    {OP_MOV_PINS_NULL, 0, 0, 0},        // mov pins, null
+};
+
+static const instruction_t PULSE_PROGRAM[] = {
+    {OP_OUT_PINS, 8, 0, 0},             // out pins, 8
+    {OP_OUT_X, 24, 0, 0},               // out x, 24
+    {OP_JMP_X_DEC, 0, 0, 2},            // hold: jmp x-- hold
+};
+
+typedef struct pulse {
+    uint32_t rise;
+    uint32_t fall;
+} pulse_t;
+
+// What each pin did over one frame, in cycles from the first instruction
+typedef struct waveform {
+    pulse_t pulses[ESC_MAX_MOTORS][MAX_PULSES];
+    uint8_t count[ESC_MAX_MOTORS];
+    bool overflow;
+    uint32_t cycles;    // until the program stalled for the next frame
+} waveform_t;
+
+typedef struct protocol_info {
+    esc_protocol_t protocol;
+    const char *name;
+} protocol_info_t;
+
+static const protocol_info_t PROTOCOLS[] = {
+    {ESC_DSHOT150,   "DShot150"},
+    {ESC_DSHOT300,   "DShot300"},
+    {ESC_DSHOT600,   "DShot600"},
+    {ESC_ONESHOT125, "OneShot125"},
+    {ESC_PWM,        "PWM"},
+};
+
+static const uint8_t MOTOR_COUNTS[] = {4, 6, 8};
+
+static uint32_t seed = 1;
+
+
+static uint32_t random32() {
+    seed = seed * 1664525 + 1013904223;
+    return seed;
+}
+
+
+static void set_pins(waveform_t *wave, uint32_t *pins, uint32_t levels, uint8_t count, uint32_t cycle) {
+    levels &= (1u << count) - 1;
+
+    for (uint8_t m = 0; m < count; m++) {
+        uint32_t bit = 1u << m;
+        if ((levels & bit) == (*pins & bit)) continue;
+
+        if (levels & bit) {
+            if (wave->count[m] == MAX_PULSES) {
+                wave->overflow = true;
+                continue;
+            }
+            wave->pulses[m][wave->count[m]].rise = cycle;
+        } else if (wave->count[m] < MAX_PULSES) {
+            wave->pulses[m][wave->count[m]++].fall = cycle;
+        }
+    }
+    *pins = levels;
+}
+
+
+/*
+ * One frame through a program, with autopull at 32 bits shifting right
+ * and the out pins the motor pins. Returns when it stalls on the pull.
+ */
+static void run(const instruction_t *program, uint8_t length, const uint32_t *words, uint8_t word_count,
+                uint8_t motors, waveform_t *wave) {
+    uint32_t osr = 0, shifted = 32, x = 0, pins = 0, cycle = 0;
+    uint8_t pc = 0, next_word = 0;
+
+    for (uint8_t m = 0; m < ESC_MAX_MOTORS; m++) wave->count[m] = 0;
+    wave->overflow = false;
+
+    while (true) {
+        const instruction_t *in = &program[pc];
+        uint8_t next = (pc + 1) % length;
+
+        switch (in->op) {
+            case OP_OUT_PINS:
+            case OP_OUT_X: {
+                if (shifted >= 32) {
+                    if (next_word == word_count) {
+                        wave->cycles = cycle;
+                        return;
+                    }
+                    osr = words[next_word++];
+                    shifted = 0;
+                }
+                uint32_t value = in->bits == 32 ? osr : osr & ((1u << in->bits) - 1);
+                osr = in->bits == 32 ? 0 : osr >> in->bits;
+                shifted += in->bits;
+
+                if (in->op == OP_OUT_PINS) set_pins(wave, &pins, value, motors, cycle);
+                else x = value;
+                break;
+            }
+            case OP_MOV_PINS_NOT_NULL: set_pins(wave, &pins, UINT32_MAX, motors, cycle); break;
+            case OP_MOV_PINS_X:        set_pins(wave, &pins, x, motors, cycle); break;
+            case OP_MOV_PINS_NULL:     set_pins(wave, &pins, 0, motors, cycle); break;
+            case OP_JMP_X_DEC:
+                if (x != 0) next = in->target;
+                x--;
+                break;
+        }
+
+        cycle += 1 + in->delay;
+        pc = next;
+    }
+}
+
+
+/*
+ * DShot as the ESC sees it: a bit every ESC_DSHOT_BIT_CYCLES, a 1 when
+ * high for more than half of it. False if the timing is off at all.
+ */
+static bool decode_dshot(const waveform_t *wave, uint8_t motor, uint16_t *frame) {
+    if (wave->count[motor] != ESC_DSHOT_BITS) return false;
+
+    const pulse_t *p = wave->pulses[motor];
+    *frame = 0;
+    for (uint8_t b = 0; b < ESC_DSHOT_BITS; b++) {
+        uint32_t high = p[b].fall - p[b].rise;
+        if (b > 0 && p[b].rise - p[b - 1].rise != ESC_DSHOT_BIT_CYCLES) return false;
+        if (high != ESC_DSHOT_HIGH_CYCLES && high != ESC_DSHOT_HIGH_CYCLES + ESC_DSHOT_DATA_CYCLES) return false;
+
+        *frame = (uint16_t)((*frame << 1) | (high * 2 > ESC_DSHOT_BIT_CYCLES));
+    }
+    return true;
+}
+
+
+static void outputs_for(uint32_t n, q16_t *outputs, uint8_t count) {
+    for (uint8_t m = 0; m < count; m++) {
+        switch (n % 5) {
+            case 0:  outputs[m] = random32() % (Q16_ONE + 1); break;
+            case 1:  outputs[m] = m & 1 ? Q16_ONE : 0; break;
+            case 2:  outputs[m] = Q16_ONE / 3; break;
+            case 3:  outputs[m] = Q16_ONE / 2 + (random32() % 5) * 16; break;  // within a cycle or two
+            default: outputs[m] = random32() % (Q16_ONE / 8) + (m < 2 ? Q16_ONE : 0); break;
+        }
+    }
+}
+
+
+/*
+ * Sweep one protocol, false if any frame failed
+ */
+static bool check(const protocol_info_t *info, uint32_t frames) {
+    static waveform_t wave;
+    const instruction_t *program = esc_is_dshot(info->protocol) ? DSHOT_PROGRAM : PULSE_PROGRAM;
+    uint8_t length = esc_is_dshot(info->protocol)
+                   ? sizeof(DSHOT_PROGRAM) / sizeof(DSHOT_PROGRAM[0])
+                   : sizeof(PULSE_PROGRAM) / sizeof(PULSE_PROGRAM[0]);
+    double ns_per_cycle = 1e9 / esc_cycle_hz(info->protocol);
+
+    uint32_t failed = 0, longest = 0, worst_error = 0, shortest_gap = UINT32_MAX;
+    for (uint32_t n = 0; n < frames; n++) {
+        uint8_t motors = MOTOR_COUNTS[n % sizeof(MOTOR_COUNTS)];
+        q16_t outputs[ESC_MAX_MOTORS];
+        outputs_for(n / sizeof(MOTOR_COUNTS), outputs, motors);
+        bool stop = n % 97 == 0;
+
+        uint32_t words[ESC_MAX_WORDS];
+        uint8_t count = esc_encode(info->protocol, stop ? NULL : outputs, motors, words);
+        run(program, length, words, count, motors, &wave);
+        if (wave.cycles > longest) longest = wave.cycles;
+
+        bool ok = !wave.overflow;
+        for (uint8_t m = 0; m < motors && ok; m++) {
+            if (esc_is_dshot(info->protocol)) {
+                uint16_t frame;
+                uint16_t value = stop ? ESC_DSHOT_STOP : dshot_value(outputs[m]);
+                ok = decode_dshot(&wave, m, &frame) && frame == dshot_frame(value, false);
+            } else {
+                // One pulse, every motor starting together
+                uint32_t expected = esc_pulse_cycles(info->protocol, stop ? 0 : outputs[m]);
+                const pulse_t *p = &wave.pulses[m][0];
+                ok = wave.count[m] == 1 && p->rise == wave.pulses[0][0].rise;
+                if (ok) {
+                    uint32_t width = p->fall - p->rise;
+                    uint32_t error = width > expected ? width - expected : expected - width;
+                    if (error > worst_error) worst_error = error;
+                    ok = error < ESC_PULSE_OVERHEAD_CYCLES;
+                }
+            }
+        }
+
+        // Low from the last pulse ending until the next frame can start
+        if (ok && !esc_is_dshot(info->protocol)) {
+            uint32_t last_fall = 0;
+            for (uint8_t m = 0; m < motors; m++) {
+                if (wave.pulses[m][0].fall > last_fall) last_fall = wave.pulses[m][0].fall;
+            }
+            uint32_t gap = wave.cycles - last_fall;
+            if (gap < shortest_gap) shortest_gap = gap;
+
+            uint32_t period = esc_period_cycles(info->protocol);
+            ok = wave.cycles >= period && gap >= period - esc_pulse_cycles(info->protocol, Q16_ONE);
+        }
+
+        if (!ok && failed++ == 0) {
+            printf("%s frame %lu on %u motors decoded wrong, words", info->name, (unsigned long)n, motors);
+            for (uint8_t i = 0; i < count; i++) printf(" %08lx", (unsigned long)words[i]);
+            printf("\n");
+        }
+    }
+
+    if (esc_is_dshot(info->protocol)) {
+        printf("%-10s %6lu frames %5lu failed, bit %6.1f ns, 0 high %6.1f ns, 1 high %6.1f ns, frame %5.1f us\n",
+               info->name, (unsigned long)frames, (unsigned long)failed,
+               ESC_DSHOT_BIT_CYCLES * ns_per_cycle, ESC_DSHOT_HIGH_CYCLES * ns_per_cycle,
+               (ESC_DSHOT_HIGH_CYCLES + ESC_DSHOT_DATA_CYCLES) * ns_per_cycle,
+               longest * ns_per_cycle / 1000);
+    } else {
+        printf("%-10s %6lu frames %5lu failed, pulses %6.1f to %6.1f us, worst width error %5.1f ns, frame %6.1f us,"
+               " gap from %6.1f us\n",
+               info->name, (unsigned long)frames, (unsigned long)failed,
+               esc_pulse_cycles(info->protocol, 0) * ns_per_cycle / 1000,
+               esc_pulse_cycles(info->protocol, Q16_ONE) * ns_per_cycle / 1000,
+               worst_error * ns_per_cycle, longest * ns_per_cycle / 1000, shortest_gap * ns_per_cycle / 1000);
+    }
+    return failed == 0;
+}
+
+
+int main(int argc, char **argv) {
+    uint32_t frames = argc > 1 ? (uint32_t)atol(argv[1]) : DEFAULT_FRAMES;
+    if (frames == 0) {
+        fprintf(stderr, "usage: %s [frames]\n", argv[0]);
+        return 2;
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(PROTOCOLS) / sizeof(PROTOCOLS[0]); i++) {
+        ok &= check(&PROTOCOLS[i], frames);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,294 @@
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/timer.h"
+#include "pico/multicore.h"
+#include "hardware/flash.h"
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * #Defines
+ */
+#define NUM_GPIOS 30
+
+/*
+ * Pin state, kept so gpio_get() reads back what was last put
+ */
+static bool gpio_out[NUM_GPIOS];
+static bool gpio_level[NUM_GPIOS];
+static enum gpio_function gpio_func[NUM_GPIOS];
+static uint32_t gpio_irq_mask[NUM_GPIOS];
+static gpio_irq_callback_t gpio_irq_callback;
+
+// Flash contents, and the file they are kept in if UAV_FLASH_IMAGE is set
+uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+static FILE *flash_image;
+
+// Wear and modelled busy time since the start of the run
+static uint32_t sector_erases[PICO_FLASH_SIZE_BYTES / FLASH_SECTOR_SIZE];
+static host_flash_stats_t flash_stats;
+
+
+// Virtual time, for replaying recordings faster than real time
+static bool clock_virtual;
+static uint64_t virtual_us;
+
+
+/*
+ * Microseconds since the first call, standing in for the RP2040 timer
+ */
+uint64_t time_us_64(void) {
+    if (clock_virtual) return virtual_us;
+
+    static uint64_t boot_ns;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    uint64_t now_ns = (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+    if (boot_ns == 0) boot_ns = now_ns;
+    return (now_ns - boot_ns) / 1000;
+}
+
+
+uint32_t time_us_32(void) {
+    return (uint32_t)time_us_64();
+}
+
+
+void host_clock_set_us(uint64_t us) {
+    virtual_us = us;
+    clock_virtual = true;
+}
+
+
+bool stdio_init_all(void) {
+    // Line buffer so output interleaves sensibly between task threads
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    return true;
+}
+
+
+/*
+ * Next character typed, without waiting longer than timeout_us for it
+ */
+int getchar_timeout_us(uint32_t timeout_us) {
+    struct pollfd fd = {.fd = STDIN_FILENO, .events = POLLIN};
+    if (poll(&fd, 1, (int)((timeout_us + 999) / 1000)) <= 0) return PICO_ERROR_TIMEOUT;
+
+    unsigned char c;
+    if (read(STDIN_FILENO, &c, 1) != 1) return PICO_ERROR_TIMEOUT;
+    return c;
+}
+
+
+/*
+ * Start from an erased part, or from the image file when there is one
+ */
+__attribute__((constructor))
+static void flash_load() {
+    memset(host_flash, 0xFF, sizeof(host_flash));
+
+    const char *path = getenv("UAV_FLASH_IMAGE");
+    if (path == NULL) return;
+
+    flash_image = fopen(path, "r+b");
+    if (flash_image == NULL) flash_image = fopen(path, "w+b");
+    if (flash_image == NULL) {
+        fprintf(stderr, "flash image %s: %s\n", path, strerror(errno));
+        return;
+    }
+
+    size_t loaded = fread(host_flash, 1, sizeof(host_flash), flash_image);
+    if (loaded < sizeof(host_flash)) {
+        // New or short file, fill it out as erased
+        fseek(flash_image, 0, SEEK_SET);
+        fwrite(host_flash, 1, sizeof(host_flash), flash_image);
+        fflush(flash_image);
+    }
+}
+
+
+static void flash_write_through(uint32_t offset, size_t count) {
+    if (flash_image == NULL) return;
+
+    fseek(flash_image, offset, SEEK_SET);
+    fwrite(host_flash + offset, 1, count, flash_image);
+    fflush(flash_image);
+}
+
+
+/*
+ * Same alignment rules as the real part, which would otherwise silently
+ * erase or program something else
+ */
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+    if (flash_offs % FLASH_SECTOR_SIZE || count % FLASH_SECTOR_SIZE ||
+        flash_offs + count > PICO_FLASH_SIZE_BYTES) {
+        fprintf(stderr, "flash erase %#x+%zu not sector aligned\n", flash_offs, count);
+        abort();
+    }
+    memset(host_flash + flash_offs, 0xFF, count);
+    flash_write_through(flash_offs, count);
+
+    for (uint32_t sector = flash_offs / FLASH_SECTOR_SIZE; sector < (flash_offs + count) / FLASH_SECTOR_SIZE; sector++) {
+        if (++sector_erases[sector] > flash_stats.max_erases) flash_stats.max_erases = sector_erases[sector];
+        flash_stats.sector_erases++;
+        flash_stats.busy_us += HOST_FLASH_SECTOR_ERASE_US;
+    }
+}
+
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count) {
+    if (flash_offs % FLASH_PAGE_SIZE || count % FLASH_PAGE_SIZE ||
+        flash_offs + count > PICO_FLASH_SIZE_BYTES) {
+        fprintf(stderr, "flash program %#x+%zu not page aligned\n", flash_offs, count);
+        abort();
+    }
+    for (size_t i = 0; i < count; i++) host_flash[flash_offs + i] &= data[i];
+    flash_write_through(flash_offs, count);
+
+    flash_stats.page_programs += count / FLASH_PAGE_SIZE;
+    flash_stats.busy_us += (uint64_t)(count / FLASH_PAGE_SIZE) * HOST_FLASH_PAGE_PROGRAM_US;
+}
+
+
+void host_flash_stats(host_flash_stats_t *stats) {
+    *stats = flash_stats;
+}
+
+
+/*
+ * Binary output has no newlines to flush the line buffer on, so flush
+ * after each frame delimiter instead
+ */
+int putchar_raw(int c) {
+    putchar(c);
+    if (c == 0) fflush(stdout);
+    return c;
+}
+
+
+/*
+ * Sleep the calling thread. Like the SDK version this does not yield to
+ * FreeRTOS, the POSIX port's tick signal simply interrupts and we resume.
+ */
+void sleep_us(uint64_t us) {
+    if (clock_virtual) {
+        virtual_us += us;
+        return;
+    }
+
+    struct timespec req = {
+        .tv_sec  = us / 1000000,
+        .tv_nsec = (us % 1000000) * 1000,
+    };
+    while (nanosleep(&req, &req) != 0 && errno == EINTR) {}
+}
+
+
+void sleep_ms(uint32_t ms) {
+    sleep_us((uint64_t)ms * 1000);
+}
+
+
+void gpio_init(unsigned int gpio) {
+    if (gpio >= NUM_GPIOS) return;
+    gpio_out[gpio]   = false;
+    gpio_level[gpio] = false;
+    gpio_func[gpio]  = GPIO_FUNC_SIO;
+}
+
+
+void gpio_set_dir(unsigned int gpio, bool out) {
+    if (gpio >= NUM_GPIOS) return;
+    gpio_out[gpio] = out;
+}
+
+
+void gpio_put(unsigned int gpio, bool value) {
+    if (gpio >= NUM_GPIOS) return;
+    gpio_level[gpio] = value;
+}
+
+
+bool gpio_get(unsigned int gpio) {
+    if (gpio >= NUM_GPIOS) return false;
+    return gpio_level[gpio];
+}
+
+
+void gpio_set_function(unsigned int gpio, enum gpio_function fn) {
+    if (gpio >= NUM_GPIOS) return;
+    gpio_func[gpio] = fn;
+}
+
+
+void gpio_pull_up(unsigned int gpio) {
+    if (gpio >= NUM_GPIOS) return;
+    if (!gpio_out[gpio]) gpio_level[gpio] = true;
+}
+
+
+void gpio_pull_down(unsigned int gpio) {
+    if (gpio >= NUM_GPIOS) return;
+    if (!gpio_out[gpio]) gpio_level[gpio] = false;
+}
+
+
+/*
+ * Recorded only, the POSIX port has no safe way to run a callback in
+ * interrupt context, so firmware relying on it has to poll on the host
+ */
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled, gpio_irq_callback_t callback) {
+    if (gpio >= NUM_GPIOS) return;
+    gpio_irq_mask[gpio] = enabled ? event_mask : 0;
+    gpio_irq_callback = callback;
+}
+
+
+absolute_time_t make_timeout_time_ms(uint32_t ms) {
+    return time_us_64() + (uint64_t)ms * 1000;
+}
+
+
+/*
+ * Nothing sends events on the host, so wake early now and then like a
+ * spurious event would and report whether the timeout has passed
+ */
+bool best_effort_wfe_or_timeout(absolute_time_t timeout) {
+    uint64_t now = time_us_64();
+    if (now >= timeout) return true;
+
+    uint64_t wait = timeout - now;
+    sleep_us(wait < 500 ? wait : 500);
+    return time_us_64() >= timeout;
+}
+
+
+static void *core1_thread(void *entry) {
+    ((void (*)(void))entry)();
+    return NULL;
+}
+
+
+/*
+ * Run core1 on its own thread. Signals are blocked first so the POSIX
+ * port's tick and yield signals only ever land on FreeRTOS threads.
+ */
+void multicore_launch_core1(void (*entry)(void)) {
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, core1_thread, (void *)entry);
+
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
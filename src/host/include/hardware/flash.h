@@ -0,0 +1,39 @@
+#ifndef HOST_HARDWARE_FLASH_H
+#define HOST_HARDWARE_FLASH_H
+
+#include "pico.h"
+
+/*
+ * Host stand-in for the Pico SDK's hardware/flash.h
+ * The flash is an array that behaves like NOR: erase sets a sector to
+ * 0xFF and programming can only clear bits. XIP_BASE points at it so
+ * reads through the memory map work unchanged. Set UAV_FLASH_IMAGE to a
+ * file to keep its contents from one run to the next.
+ *
+ * Every erase and program is counted, with the time a W25Q16JV would
+ * typically be busy for, so the host can check log throughput and wear.
+ */
+
+#define FLASH_PAGE_SIZE        (1u << 8)
+#define FLASH_SECTOR_SIZE      (1u << 12)
+#define PICO_FLASH_SIZE_BYTES  (2 * 1024 * 1024)
+
+extern uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+#define XIP_BASE ((uintptr_t)host_flash)
+
+// Typical W25Q16JV timing, the worst case is several times longer
+#define HOST_FLASH_PAGE_PROGRAM_US  400
+#define HOST_FLASH_SECTOR_ERASE_US  45000
+
+typedef struct host_flash_stats {
+    uint32_t sector_erases;
+    uint32_t page_programs;
+    uint32_t max_erases;        // of the most worn sector
+    uint64_t busy_us;           // modelled, erase and program together
+} host_flash_stats_t;
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+void host_flash_stats(host_flash_stats_t *stats);
+
+#endif
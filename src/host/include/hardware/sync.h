@@ -0,0 +1,22 @@
+#ifndef HOST_HARDWARE_SYNC_H
+#define HOST_HARDWARE_SYNC_H
+
+#include "pico.h"
+
+/*
+ * Host stand-in for the Pico SDK's hardware/sync.h
+ * GPIO interrupts never fire on the host, so there is nothing to mask
+ * and no event to wait for.
+ */
+static inline void __sev(void) {}
+static inline void __wfe(void) {}
+
+static inline uint32_t save_and_disable_interrupts(void) {
+    return 0;
+}
+
+static inline void restore_interrupts(uint32_t status) {
+    (void)status;
+}
+
+#endif
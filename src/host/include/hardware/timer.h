@@ -0,0 +1,13 @@
+#ifndef HOST_HARDWARE_TIMER_H
+#define HOST_HARDWARE_TIMER_H
+
+#include "pico.h"
+
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+
+// Host only. Once set the time stands still at us, sleeps move it on,
+// and only another host_clock_set_us() brings it forward otherwise.
+void host_clock_set_us(uint64_t us);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef HOST_PICO_H
+#define HOST_PICO_H
+
+/*
+ * Host stand-in for the Pico SDK's base pico.h
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+#define _u(x) x ## u
+
+#define PICO_OK              0
+#define PICO_ERROR_GENERIC  -1
+#define PICO_ERROR_TIMEOUT  -2
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef HOST_PICO_MULTICORE_H
+#define HOST_PICO_MULTICORE_H
+
+#include "pico.h"
+
+/*
+ * Host stand-in for the Pico SDK's pico/multicore.h
+ * Core1 is a plain pthread outside FreeRTOS, like the real core1 is
+ * outside the single core scheduler.
+ */
+void multicore_launch_core1(void (*entry)(void));
+
+// Flash writes on the host never stop the other core's execution
+static inline void multicore_lockout_victim_init(void) {}
+static inline void multicore_lockout_start_blocking(void) {}
+static inline void multicore_lockout_end_blocking(void) {}
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+/*
+ * Host stand-in for the Pico SDK's pico/stdlib.h
+ * Only the parts of the SDK the firmware actually uses are provided
+ */
+
+#include "pico.h"
+#include "pico/time.h"
+#include "hardware/gpio.h"
+
+bool stdio_init_all(void);
+int putchar_raw(int c);
+int getchar_timeout_us(uint32_t timeout_us);
+
+#endif
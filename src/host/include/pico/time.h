@@ -0,0 +1,18 @@
+#ifndef HOST_PICO_TIME_H
+#define HOST_PICO_TIME_H
+
+#include "pico.h"
+#include "hardware/timer.h"
+
+typedef uint64_t absolute_time_t;
+
+static inline absolute_time_t from_us_since_boot(uint64_t us) {
+    return us;
+}
+
+void sleep_ms(uint32_t ms);
+void sleep_us(uint64_t us);
+absolute_time_t make_timeout_time_ms(uint32_t ms);
+bool best_effort_wfe_or_timeout(absolute_time_t timeout);
+
+#endif
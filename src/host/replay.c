@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pico/stdlib.h"
+#include "imu.h"
+#include "calibration.h"
+#include "replay/replay.h"
+
+/*
+ * Replay a recording through the sensor pipeline faster than real time
+ *
+ *   replay <recording.csv> [--out file] [--golden file]
+ *
+ * The recording is the CSV blackbox_decode prints, raw samples as read
+ * from the GY-89 (blackbox_sim --csv writes one as well). They replace
+ * the driver reads, and the acquisition, calibration, filtering and
+ * attitude code run unchanged on a virtual clock, stepped from one
+ * scheduled release to the next.
+ *
+ * Reports the throughput in input samples per second of host time.
+ * --out writes everything the pipeline published, in the same CSV form
+ * with the attitude added. --golden compares it against a previous
+ * --out and exits with 1 if anything differs, so a run before a change
+ * to src/sensors is the golden for after it.
+ *
+ * The calibration comes from UAV_FLASH_IMAGE if it is set, otherwise
+ * every sensor is replayed uncalibrated.
+ */
+
+/*
+ * #Defines
+ */
+#define LINE_MAX_CHARS 256
+
+// Nothing left to read by this long after the last sample
+#define DRAIN_US 1000000
+
+typedef struct sample_list {
+    sample_t *samples;
+    uint32_t count;
+    uint32_t capacity;
+} sample_list_t;
+
+static const char *const TYPE_NAMES[] = {
+    [SAMPLE_ACC] = "acc",
+    [SAMPLE_MAG] = "mag",
+    [SAMPLE_GYRO] = "gyro",
+    [SAMPLE_BARO] = "baro",
+    [SAMPLE_ATTITUDE] = "attitude"
+};
+
+#define TYPES (sizeof(TYPE_NAMES) / sizeof(TYPE_NAMES[0]))
+
+static sample_ring_t ring;
+
+
+static uint64_t wall_us() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+
+static uint8_t value_count(uint8_t type) {
+    return type == SAMPLE_ATTITUDE ? 4 : 3;
+}
+
+
+static void append(sample_list_t *list, const sample_t *sample) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? 2 * list->capacity : 4096;
+        list->samples = realloc(list->samples, list->capacity * sizeof(sample_t));
+        if (list->samples == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(2);
+        }
+    }
+    list->samples[list->count++] = *sample;
+}
+
+
+/*
+ * One CSV line, false for anything but a sample, RC and lost records
+ * included
+ */
+static bool parse_line(const char *line, sample_t *sample) {
+    char name[16];
+    unsigned long long timestamp;
+    long v[4] = {0, 0, 0, 0};
+
+    int fields = sscanf(line, "%15[a-z],%llu,%ld,%ld,%ld,%ld", name, &timestamp, &v[0], &v[1], &v[2], &v[3]);
+    if (fields < 5) return false;
+
+    for (uint8_t type = 0; type < TYPES; type++) {
+        if (strcmp(name, TYPE_NAMES[type]) != 0) continue;
+        if (fields != 2 + value_count(type)) return false;
+
+        memset(sample, 0, sizeof(*sample));
+        sample->timestamp_us = timestamp;
+        sample->type = type;
+        for (int i = 0; i < 4; i++) sample->data[i] = (int32_t)v[i];
+        return true;
+    }
+    return false;
+}
+
+
+static bool load(const char *path, sample_list_t *list) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        return false;
+    }
+
+    char line[LINE_MAX_CHARS];
+    sample_t sample;
+    while (fgets(line, sizeof(line), file)) {
+        if (parse_line(line, &sample)) append(list, &sample);
+    }
+    fclose(file);
+    return true;
+}
+
+
+static void write_samples(const char *path, const sample_list_t *list) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        perror(path);
+        return;
+    }
+
+    for (uint32_t i = 0; i < list->count; i++) {
+        const sample_t *s = &list->samples[i];
+        fprintf(file, "%s,%llu", TYPE_NAMES[s->type], (unsigned long long)s->timestamp_us);
+        for (int v = 0; v < value_count(s->type); v++) fprintf(file, ",%ld", (long)s->data[v]);
+        fprintf(file, "\n");
+    }
+    fclose(file);
+}
+
+
+/*
+ * Differences from the golden run, by type. False if there were any.
+ */
+static bool compare(const sample_list_t *output, const sample_list_t *golden) {
+    uint32_t differ = 0;
+    uint32_t first = UINT32_MAX;
+    int64_t worst[TYPES] = {0};
+
+    uint32_t common = output->count < golden->count ? output->count : golden->count;
+    for (uint32_t i = 0; i < common; i++) {
+        const sample_t *a = &output->samples[i];
+        const sample_t *b = &golden->samples[i];
+
+        bool same = a->type == b->type && a->timestamp_us == b->timestamp_us;
+        for (int v = 0; same && v < value_count(a->type); v++) {
+            int64_t diff = llabs((int64_t)a->data[v] - b->data[v]);
+            if (diff > worst[a->type]) worst[a->type] = diff;
+            same = diff == 0;
+        }
+        if (!same) {
+            differ++;
+            if (first == UINT32_MAX) first = i;
+        }
+    }
+
+    if (differ == 0 && output->count == golden->count) {
+        printf("golden   %lu records, identical\n", (unsigned long)common);
+        return true;
+    }
+
+    printf("golden   %lu records against %lu, %lu differ",
+           (unsigned long)output->count, (unsigned long)golden->count, (unsigned long)differ);
+    if (first != UINT32_MAX) {
+        printf(", first at record %lu (%s at %llu us)", (unsigned long)first + 1,
+               TYPE_NAMES[golden->samples[first].type],
+               (unsigned long long)golden->samples[first].timestamp_us);
+    }
+    printf("\n");
+    for (uint8_t type = 0; type < TYPES; type++) {
+        if (worst[type]) printf("         %-8s largest difference %lld\n", TYPE_NAMES[type], (long long)worst[type]);
+    }
+    return false;
+}
+
+
+static int usage(const char *name) {
+    fprintf(stderr, "usage: %s <recording.csv> [--out file] [--golden file]\n", name);
+    return 2;
+}
+
+
+int main(int argc, char **argv) {
+    const char *recording_path = NULL;
+    const char *out_path = NULL;
+    const char *golden_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+            golden_path = argv[++i];
+        } else if (recording_path == NULL) {
+            recording_path = argv[i];
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (recording_path == NULL) return usage(argv[0]);
+
+    static sample_list_t input, output, golden;
+    if (!load(recording_path, &input)) return 2;
+    if (golden_path != NULL && !load(golden_path, &golden)) return 2;
+    if (input.count == 0) {
+        fprintf(stderr, "%s: no samples\n", recording_path);
+        return 2;
+    }
+
+    replay_load(input.samples, input.count);
+    uint64_t first = replay_first_us();
+    uint64_t last = replay_last_us();
+    host_clock_set_us(first);
+
+    calibration_init();
+    imu_add_consumer(&ring);
+    if (!imu_start_polled()) {
+        fprintf(stderr, "replay sensors did not start\n");
+        return 2;
+    }
+
+    uint64_t start = wall_us();
+    while (!replay_done() && time_us_64() < last + DRAIN_US) {
+        uint64_t next = imu_poll();
+
+        sample_t sample;
+        while (sample_ring_pop(&ring, &sample)) append(&output, &sample);
+
+        host_clock_set_us(next > time_us_64() ? next : time_us_64() + 1);
+    }
+    uint64_t elapsed = wall_us() - start;
+    if (elapsed == 0) elapsed = 1;
+
+    double recorded_s = (last - first) * 1e-6;
+    printf("replay   %lu samples, %.1f s recorded, in %.3f s\n",
+           (unsigned long)input.count, recorded_s, elapsed * 1e-6);
+    printf("rate     %.0f samples/s, %.0fx real time, %lu records out, %lu dropped\n",
+           input.count / (elapsed * 1e-6), recorded_s / (elapsed * 1e-6),
+           (unsigned long)output.count, (unsigned long)sample_ring_dropped(&ring));
+
+    if (out_path != NULL) write_samples(out_path, &output);
+    if (golden_path != NULL && !compare(&output, &golden)) return 1;
+    return 0;
+}
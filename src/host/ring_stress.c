@@ -0,0 +1,132 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "sample_ring.h"
+
+/*
+ * Producer and consumer threads through one sample ring
+ *
+ *   ring_stress [samples]
+ *
+ * The producer pushes numbered samples as fast as it can, the consumer
+ * pops them and now and then stalls so the ring fills and drops. Every
+ * sample carries its number in the timestamp and a pattern derived from
+ * it in the data, so the consumer can tell a torn copy or a sample out of
+ * order from a dropped one. At the end every number has to be accounted
+ * for, either popped or counted as a drop by both the producer and the
+ * ring. Exits with 1 on any corruption or miscount.
+ *
+ * Build it with -fsanitize=thread as well to have the memory ordering
+ * checked, not just its effects.
+ */
+
+/*
+ * #Defines
+ */
+#define DEFAULT_SAMPLES 20000000
+
+// Pops between consumer stalls, and how long a stall spins
+#define STALL_EVERY 4096
+#define STALL_SPINS 20000
+
+static sample_ring_t ring;
+static uint32_t total;
+static uint32_t producer_drops;
+static atomic_bool finished;
+
+
+static int32_t pattern(uint32_t n, int i) {
+    return (int32_t)((n ^ 0x5a5a5a5a) * 2654435761u + i * 40503u);
+}
+
+
+static void *produce(void *arg) {
+    for (uint32_t n = 0; n < total; n++) {
+        sample_t sample = {
+            .timestamp_us = n,
+            .type = n % (SAMPLE_ATTITUDE + 1),
+            .data = {pattern(n, 0), pattern(n, 1), pattern(n, 2), pattern(n, 3)}
+        };
+        if (!sample_ring_push(&ring, &sample)) {
+            // Let the consumer in, on a single core it would otherwise
+            // only run once this thread's time slice is up
+            producer_drops++;
+            sched_yield();
+        }
+    }
+    atomic_store_explicit(&finished, true, memory_order_release);
+    return NULL;
+}
+
+
+static bool intact(const sample_t *sample) {
+    uint32_t n = (uint32_t)sample->timestamp_us;
+    if (sample->timestamp_us >= total || sample->type != n % (SAMPLE_ATTITUDE + 1)) return false;
+
+    for (int i = 0; i < 4; i++) {
+        if (sample->data[i] != pattern(n, i)) return false;
+    }
+    return true;
+}
+
+
+int main(int argc, char **argv) {
+    total = argc > 1 ? (uint32_t)atol(argv[1]) : DEFAULT_SAMPLES;
+    if (total == 0) {
+        fprintf(stderr, "usage: %s [samples]\n", argv[0]);
+        return 2;
+    }
+
+    sample_ring_init(&ring);
+
+    pthread_t producer;
+    if (pthread_create(&producer, NULL, produce, NULL) != 0) {
+        fprintf(stderr, "no producer thread\n");
+        return 2;
+    }
+
+    uint32_t popped = 0, corrupt = 0, out_of_order = 0, gaps = 0;
+    uint64_t next = 0;
+    while (true) {
+        // Checked before the pop, so empty after the producer finished
+        // really is the end
+        bool done = atomic_load_explicit(&finished, memory_order_acquire);
+
+        sample_t sample;
+        if (!sample_ring_pop(&ring, &sample)) {
+            if (done) break;
+            sched_yield();
+            continue;
+        }
+
+        if (!intact(&sample)) {
+            if (corrupt++ == 0) printf("sample %lu torn\n", (unsigned long)popped);
+        } else if (sample.timestamp_us < next) {
+            if (out_of_order++ == 0) {
+                printf("sample %llu after %llu\n", (unsigned long long)sample.timestamp_us,
+                       (unsigned long long)next - 1);
+            }
+        } else {
+            if (sample.timestamp_us > next) gaps++;
+            next = sample.timestamp_us + 1;
+        }
+
+        if (++popped % STALL_EVERY == 0) {
+            for (volatile int spin = 0; spin < STALL_SPINS; spin++) {}
+        }
+    }
+
+    pthread_join(producer, NULL);
+    uint32_t ring_drops = sample_ring_dropped(&ring);
+    bool counted = popped + producer_drops == total && ring_drops == producer_drops;
+
+    printf("ring     %lu samples, %lu popped, %lu dropped in %lu gaps, ring counted %lu\n",
+           (unsigned long)total, (unsigned long)popped, (unsigned long)producer_drops,
+           (unsigned long)gaps, (unsigned long)ring_drops);
+    printf("errors   %lu torn, %lu out of order, counts %s\n",
+           (unsigned long)corrupt, (unsigned long)out_of_order, counted ? "add up" : "DO NOT ADD UP");
+
+    return corrupt == 0 && out_of_order == 0 && counted ? 0 : 1;
+}
@@ -0,0 +1,200 @@
+#include "gy89_sim.h"
+#include "i2c_sim.h"
+
+/*
+ * #Defines
+ */
+#define BMP180_ADDR     0x77
+#define BMP180_ID       0x55
+
+#define CALIB           0xAA
+#define ID_REG          0xD0
+#define VERSION_REG     0xD1
+#define SOFT_RESET      0xE0
+#define CTRL_MEAS       0xF4
+#define OUT_MSB         0xF6
+#define OUT_LSB         0xF7
+#define OUT_XLSB        0xF8
+
+#define RESET_VALUE     0xB6
+#define SCO             0b00100000
+#define MEAS_TEMP       0x0E
+#define MEAS_PRESSURE   0x14
+
+// Calibration words from the datasheet's worked example
+static const int16_t COEFFS[11] = {
+    408, -72, -14383, (int16_t)32741, (int16_t)32757, 23153, 6190, 4, -32768, -8711, 2868
+};
+
+enum { AC1, AC2, AC3, AC4, AC5, AC6, B1, B2, MB, MC, MD };
+
+// Conversion time per oversampling setting, us
+static const uint32_t PRESSURE_TIME_US[4] = {4500, 7500, 13500, 25500};
+static const uint32_t TEMP_TIME_US = 4500;
+
+typedef struct bmp180_sim {
+    i2c_sim_device_t dev;
+    float    temp_c;
+    int32_t  pressure_pa;
+    uint16_t noise;
+    uint32_t seed;
+    bool     converting;
+    uint64_t done_us;
+    uint32_t conversions;
+} bmp180_sim_t;
+
+static bmp180_sim_t bmp180;
+
+
+/*
+ * Datasheet compensation, used to pick the raw value the chip would
+ * have to produce for the modelled temperature and pressure
+ */
+static int32_t compensate_b5(int32_t ut) {
+    int32_t x1 = ((ut - (uint16_t)COEFFS[AC6]) * (uint16_t)COEFFS[AC5]) >> 15;
+    int32_t x2 = (COEFFS[MC] * 2048) / (x1 + COEFFS[MD]);
+    return x1 + x2;
+}
+
+
+static int32_t compensate_pressure(int32_t up, int32_t b5, uint8_t oss) {
+    int32_t b6 = b5 - 4000;
+    int32_t x1 = (COEFFS[B2] * ((b6 * b6) >> 12)) >> 11;
+    int32_t x2 = (COEFFS[AC2] * b6) >> 11;
+    int32_t x3 = x1 + x2;
+    int32_t b3 = (((COEFFS[AC1] * 4 + x3) << oss) + 2) / 4;
+    x1 = (COEFFS[AC3] * b6) >> 13;
+    x2 = (COEFFS[B1] * ((b6 * b6) >> 12)) >> 16;
+    x3 = ((x1 + x2) + 2) >> 2;
+    uint32_t b4 = ((uint16_t)COEFFS[AC4] * (uint32_t)(x3 + 32768)) >> 15;
+    uint32_t b7 = ((uint32_t)up - b3) * (50000 >> oss);
+    int32_t p = b7 < 0x80000000 ? (b7 * 2) / b4 : (b7 / b4) * 2;
+
+    x1 = (p >> 8) * (p >> 8);
+    x1 = (x1 * 3038) >> 16;
+    x2 = (-7357 * p) >> 16;
+    return p + ((x1 + x2 + 3791) >> 4);
+}
+
+
+static int32_t raw_temp(bmp180_sim_t *sim) {
+    int32_t target = (int32_t)(sim->temp_c * 10);
+    int32_t lo = 0, hi = 0xFFFF;
+    while (lo < hi) {
+        int32_t mid = (lo + hi) / 2;
+        if (((compensate_b5(mid) + 8) >> 4) < target) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+
+static int32_t raw_pressure(bmp180_sim_t *sim, uint8_t oss) {
+    int32_t b5 = compensate_b5(raw_temp(sim));
+    int32_t lo = 0, hi = (0x10000 << oss) - 1;
+    while (lo < hi) {
+        int32_t mid = (lo + hi) / 2;
+        if (compensate_pressure(mid, b5, oss) < sim->pressure_pa) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+
+static int32_t add_noise(bmp180_sim_t *sim, int32_t raw) {
+    if (!sim->noise) return raw;
+    sim->seed = sim->seed * 1664525 + 1013904223;
+    return raw + (int32_t)((sim->seed >> 16) % (2 * sim->noise + 1)) - sim->noise;
+}
+
+
+/*
+ * Latch the result of a finished conversion into the output registers
+ */
+static void update(bmp180_sim_t *sim) {
+    uint8_t *regs = sim->dev.regs;
+    if (!sim->converting || time_us_64() < sim->done_us) return;
+
+    uint8_t ctrl = regs[CTRL_MEAS];
+    uint8_t oss  = ctrl >> 6;
+    if ((ctrl & 0x1F) == MEAS_TEMP) {
+        int32_t ut = add_noise(sim, raw_temp(sim));
+        regs[OUT_MSB]  = ut >> 8;
+        regs[OUT_LSB]  = ut & 0xFF;
+    } else {
+        int32_t up = add_noise(sim, raw_pressure(sim, oss)) << (8 - oss);
+        regs[OUT_MSB]  = up >> 16;
+        regs[OUT_LSB]  = (up >> 8) & 0xFF;
+        regs[OUT_XLSB] = up & 0xFF;
+    }
+
+    regs[CTRL_MEAS] &= ~SCO;
+    sim->converting = false;
+    sim->conversions++;
+}
+
+
+static void reset(bmp180_sim_t *sim) {
+    uint8_t *regs = sim->dev.regs;
+    for (int i = 0; i < 11; i++) {
+        regs[CALIB + 2 * i]     = (uint16_t)COEFFS[i] >> 8;
+        regs[CALIB + 2 * i + 1] = (uint16_t)COEFFS[i] & 0xFF;
+    }
+    regs[ID_REG]      = BMP180_ID;
+    regs[VERSION_REG] = 0x02;
+    regs[CTRL_MEAS]   = 0;
+    regs[OUT_MSB]     = 0x80;
+    regs[OUT_LSB]     = 0;
+    regs[OUT_XLSB]    = 0;
+    sim->converting   = false;
+}
+
+
+static void on_write(i2c_sim_device_t *dev, uint8_t reg, uint8_t value) {
+    bmp180_sim_t *sim = (bmp180_sim_t *)dev;
+    update(sim);
+
+    if (reg == SOFT_RESET) {
+        if (value == RESET_VALUE) reset(sim);
+        return;
+    }
+    if (reg != CTRL_MEAS) return;
+
+    // Start a conversion, SCO stays set until it completes
+    uint8_t meas = value & 0x1F;
+    dev->regs[CTRL_MEAS] = value;
+    if (meas == MEAS_TEMP || meas == MEAS_PRESSURE) {
+        sim->converting = true;
+        sim->done_us = time_us_64() + (meas == MEAS_TEMP ? TEMP_TIME_US : PRESSURE_TIME_US[value >> 6]);
+        dev->regs[CTRL_MEAS] |= SCO;
+    }
+}
+
+
+static uint8_t on_read(i2c_sim_device_t *dev, uint8_t reg) {
+    update((bmp180_sim_t *)dev);
+    return dev->regs[reg];
+}
+
+
+void bmp180_sim_attach(i2c_inst_t *i2c) {
+    bmp180_sim_t *sim = &bmp180;
+    *sim = (bmp180_sim_t){0};
+
+    sim->dev.addr = BMP180_ADDR;
+    sim->dev.on_write = on_write;
+    sim->dev.on_read  = on_read;
+    sim->seed = 4;
+    reset(sim);
+
+    i2c_sim_attach(i2c, &sim->dev);
+}
+
+
+void bmp180_sim_set_env(float temp_c, int32_t pressure_pa) {
+    bmp180.temp_c = temp_c;
+    bmp180.pressure_pa = pressure_pa;
+}
+
+
+void bmp180_sim_set_noise(uint16_t lsb) {
+    bmp180.noise = lsb;
+}
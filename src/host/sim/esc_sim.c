@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "esc.h"
+
+/*
+ * Stands in for the PIO ESC output on the host
+ * Encodes every frame as the Pico does and keeps the line busy for as
+ * long as the frame would take to send, so a protocol whose frames are
+ * longer than the control period drops calls the same way. The
+ * waveforms themselves are checked by esc_timing.
+ */
+
+static bool running = false;
+static esc_protocol_t protocol;
+static uint8_t motor_count;
+static uint64_t busy_until_us = 0;
+
+
+bool esc_init(esc_protocol_t esc_protocol, uint pin_base, uint8_t count) {
+    if (count == 0 || count > ESC_MAX_MOTORS || running) return false;
+
+    protocol = esc_protocol;
+    motor_count = count;
+    running = true;
+    return true;
+}
+
+
+/*
+ * State machine cycles the words take to shift out
+ */
+static uint32_t frame_cycles(const uint32_t *words, uint8_t count) {
+    if (esc_is_dshot(protocol)) return ESC_DSHOT_BITS * ESC_DSHOT_BIT_CYCLES;
+
+    uint32_t cycles = 0;
+    for (uint8_t i = 0; i < count; i++) cycles += (words[i] >> 8) + ESC_PULSE_OVERHEAD_CYCLES;
+    return cycles;
+}
+
+
+bool write_all_motors(const q16_t *outputs) {
+    uint64_t now = time_us_64();
+    if (!running || now < busy_until_us) return false;
+
+    uint32_t words[ESC_MAX_WORDS];
+    uint8_t count = esc_encode(protocol, outputs, motor_count, words);
+    busy_until_us = now + (uint64_t)frame_cycles(words, count) * 1000000 / esc_cycle_hz(protocol) + 1;
+    return true;
+}
+
+
+void esc_stop() {
+    running = false;
+}
@@ -0,0 +1,21 @@
+#include "gy89_sim.h"
+
+void gy89_sim_attach(i2c_inst_t *i2c) {
+    lsm303d_sim_attach(i2c);
+    l3gd20_sim_attach(i2c);
+    bmp180_sim_attach(i2c);
+
+    // Sitting level on the bench
+    lsm303d_sim_set_accel(0.0f, 0.0f, 1.0f);
+    lsm303d_sim_set_mag(0.22f, 0.0f, -0.52f);
+    l3gd20_sim_set_gyro(0.0f, 0.0f, 0.0f);
+    bmp180_sim_set_env(21.5f, 101325);
+    gy89_sim_set_noise(4);
+}
+
+
+void gy89_sim_set_noise(uint16_t lsb) {
+    lsm303d_sim_set_noise(lsb);
+    l3gd20_sim_set_noise(lsb);
+    bmp180_sim_set_noise(lsb);
+}
@@ -0,0 +1,27 @@
+#ifndef GY89_SIM_H
+#define GY89_SIM_H
+
+#include "hardware/i2c.h"
+
+/*
+ * Register accurate models of the GY-89's LSM303D, L3GD20 and BMP180
+ */
+
+void gy89_sim_attach(i2c_inst_t *i2c);
+void lsm303d_sim_attach(i2c_inst_t *i2c);
+void l3gd20_sim_attach(i2c_inst_t *i2c);
+void bmp180_sim_attach(i2c_inst_t *i2c);
+
+// What the simulated board is measuring
+void lsm303d_sim_set_accel(float x, float y, float z); // g
+void lsm303d_sim_set_mag(float x, float y, float z);   // gauss
+void l3gd20_sim_set_gyro(float x, float y, float z);   // dps
+void bmp180_sim_set_env(float temp_c, int32_t pressure_pa);
+
+// Peak noise added to every conversion, LSB
+void lsm303d_sim_set_noise(uint16_t lsb);
+void l3gd20_sim_set_noise(uint16_t lsb);
+void bmp180_sim_set_noise(uint16_t lsb);
+void gy89_sim_set_noise(uint16_t lsb);
+
+#endif
@@ -0,0 +1,143 @@
+#include "i2c_sim.h"
+#include "gy89_sim.h"
+
+/*
+ * #Defines
+ */
+#define ST_AUTO_INCREMENT 0b10000000
+
+i2c_inst_t i2c0_inst;
+i2c_inst_t i2c1_inst;
+
+static i2c_sim_stats_t bus_stats[2];
+
+
+static i2c_sim_stats_t *stats_for(i2c_inst_t *i2c) {
+    return &bus_stats[i2c == i2c1];
+}
+
+
+static i2c_sim_device_t *find_device(i2c_inst_t *i2c, uint8_t addr) {
+    for (i2c_sim_device_t *dev = i2c->devices; dev != NULL; dev = dev->next) {
+        if (dev->addr == addr) return dev;
+    }
+    return NULL;
+}
+
+
+/*
+ * Account for one START/RESTART, the address byte, len data bytes and
+ * the optional STOP
+ */
+static void count_transfer(i2c_inst_t *i2c, i2c_sim_device_t *dev, size_t len, bool nostop) {
+    uint32_t clocks = 1 + 9 * (1 + len) + (nostop ? 0 : 1);
+    uint64_t ns = (uint64_t)clocks * 1000000000 / (i2c->baudrate ? i2c->baudrate : 100000);
+
+    i2c_sim_stats_t *bus = stats_for(i2c);
+    bus->transactions++;
+    bus->bytes += 1 + len;
+    bus->bus_time_ns += ns;
+
+    if (dev == NULL) {
+        bus->naks++;
+        return;
+    }
+    dev->stats.transactions++;
+    dev->stats.bytes += 1 + len;
+    dev->stats.bus_time_ns += ns;
+}
+
+
+static void advance(i2c_sim_device_t *dev) {
+    if (!dev->increment) return;
+
+    if (dev->wrap_from && dev->reg_ptr == dev->wrap_from) {
+        dev->reg_ptr = dev->wrap_to;
+    } else {
+        dev->reg_ptr++;
+    }
+}
+
+
+unsigned int i2c_init(i2c_inst_t *i2c, unsigned int baudrate) {
+    i2c->baudrate = baudrate;
+
+    // The GY-89 hangs off i2c0, as wired on the board
+    if (i2c == i2c0 && i2c->devices == NULL) {
+        gy89_sim_attach(i2c);
+    }
+    return baudrate;
+}
+
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    i2c_sim_device_t *dev = find_device(i2c, addr);
+    count_transfer(i2c, dev, len, nostop);
+    if (dev == NULL) return PICO_ERROR_GENERIC;
+    if (len == 0) return 0;
+
+    // First byte is the sub-address
+    dev->reg_ptr = src[0];
+    dev->increment = true;
+    if (dev->msb_auto_increment) {
+        dev->reg_ptr   = src[0] & ~ST_AUTO_INCREMENT;
+        dev->increment = (src[0] & ST_AUTO_INCREMENT) != 0;
+    }
+
+    for (size_t i = 1; i < len; i++) {
+        if (dev->on_write) {
+            dev->on_write(dev, dev->reg_ptr, src[i]);
+        } else {
+            dev->regs[dev->reg_ptr] = src[i];
+        }
+        advance(dev);
+    }
+    return len;
+}
+
+
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop) {
+    i2c_sim_device_t *dev = find_device(i2c, addr);
+    count_transfer(i2c, dev, len, nostop);
+    if (dev == NULL) {
+        // Nothing drives SDA, the pull ups read back as ones
+        for (size_t i = 0; i < len; i++) dst[i] = 0xFF;
+        return PICO_ERROR_GENERIC;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = dev->on_read ? dev->on_read(dev, dev->reg_ptr) : dev->regs[dev->reg_ptr];
+        advance(dev);
+    }
+    return len;
+}
+
+
+void i2c_sim_attach(i2c_inst_t *i2c, i2c_sim_device_t *dev) {
+    dev->next = i2c->devices;
+    i2c->devices = dev;
+}
+
+
+i2c_sim_stats_t i2c_sim_get_stats(i2c_inst_t *i2c) {
+    return *stats_for(i2c);
+}
+
+
+void i2c_sim_reset_stats(i2c_inst_t *i2c) {
+    *stats_for(i2c) = (i2c_sim_stats_t){0};
+    for (i2c_sim_device_t *dev = i2c->devices; dev != NULL; dev = dev->next) {
+        dev->stats = (i2c_sim_stats_t){0};
+    }
+}
+
+
+i2c_sim_stats_t i2c_sim_stats_delta(i2c_sim_stats_t before, i2c_sim_stats_t after) {
+    i2c_sim_stats_t delta = {
+        after.transactions - before.transactions,
+        after.bytes        - before.bytes,
+        after.naks         - before.naks,
+        after.bus_time_ns  - before.bus_time_ns,
+    };
+    return delta;
+}
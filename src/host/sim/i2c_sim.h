@@ -0,0 +1,54 @@
+#ifndef I2C_SIM_H
+#define I2C_SIM_H
+
+#include "hardware/i2c.h"
+
+/*
+ * Register level I2C bus simulator for host builds
+ *
+ * Stands in for the SDK's i2c_write_blocking() / i2c_read_blocking().
+ * A write sets the device's register pointer from its first byte and
+ * stores any further bytes, a read returns bytes from the register
+ * pointer. Traffic is counted per bus and per device so the cost of a
+ * driver call can be measured exactly.
+ */
+
+// Bus traffic, bus_time_ns is what the transfers take on the wire at the
+// configured baudrate (START, 9 clocks per byte including ACK, STOP)
+typedef struct i2c_sim_stats {
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t naks;
+    uint64_t bus_time_ns;
+} i2c_sim_stats_t;
+
+typedef struct i2c_sim_device {
+    uint8_t addr;
+    // ST parts only auto-increment when bit 7 of the sub-address is set,
+    // others (BMP180) always increment
+    bool    msb_auto_increment;
+    uint8_t regs[256];
+    uint8_t reg_ptr;
+    bool    increment;
+    // Auto-increment rolls back to wrap_to after reading wrap_from, used
+    // by the FIFO burst reads. Unused while wrap_from is 0.
+    uint8_t wrap_from;
+    uint8_t wrap_to;
+
+    // Optional hooks, the defaults store to / load from regs
+    void    (*on_write)(struct i2c_sim_device *dev, uint8_t reg, uint8_t value);
+    uint8_t (*on_read)(struct i2c_sim_device *dev, uint8_t reg);
+
+    i2c_sim_stats_t stats;
+    struct i2c_sim_device *next;
+} i2c_sim_device_t;
+
+void i2c_sim_attach(i2c_inst_t *i2c, i2c_sim_device_t *dev);
+
+i2c_sim_stats_t i2c_sim_get_stats(i2c_inst_t *i2c);
+void i2c_sim_reset_stats(i2c_inst_t *i2c);
+
+// Difference between two snapshots, for costing a single driver call
+i2c_sim_stats_t i2c_sim_stats_delta(i2c_sim_stats_t before, i2c_sim_stats_t after);
+
+#endif
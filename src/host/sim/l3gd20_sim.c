@@ -0,0 +1,110 @@
+#include "gy89_sim.h"
+#include "i2c_sim.h"
+#include "st_axes.h"
+
+/*
+ * #Defines
+ */
+#define L3GD20_ADDR     0b1101010
+#define L3GD20_ID       0b11010100
+
+#define WHO_AM_I        0x0F
+#define CTRL_REG1       0x20
+#define CTRL_REG4       0x23
+#define CTRL_REG5       0x24
+#define OUT_TEMP        0x26
+#define STATUS_REG      0x27
+#define OUT_X_L         0x28
+#define OUT_Z_H         0x2D
+#define FIFO_CTRL_REG   0x2E
+#define FIFO_SRC_REG    0x2F
+
+#define FIFO_EN         0b01000000
+
+typedef struct l3gd20_sim {
+    i2c_sim_device_t dev;
+    st_axes_t gyro;
+    float     temp_c;
+} l3gd20_sim_t;
+
+static l3gd20_sim_t l3gd20;
+
+// CTRL_REG1 DR[1:0], Hz
+static const float GYRO_ODR[4] = {95, 190, 380, 760};
+// CTRL_REG4 FS[1:0], dps/LSB
+static const float GYRO_LSB[4] = {8.75e-3f, 17.5e-3f, 70e-3f, 70e-3f};
+
+
+static void configure(l3gd20_sim_t *sim) {
+    uint8_t *regs = sim->dev.regs;
+
+    // PD bit, 0 is power down
+    bool on = regs[CTRL_REG1] & 0b00001000;
+    st_axes_configure(&sim->gyro, on ? GYRO_ODR[regs[CTRL_REG1] >> 6] : 0,
+                      GYRO_LSB[(regs[CTRL_REG4] >> 4) & 0b11], time_us_64());
+
+    // Bursts from OUT_Z_H roll back to OUT_X_L so the FIFO drains in one read
+    st_axes_configure_fifo(&sim->gyro, regs[CTRL_REG5] & FIFO_EN, regs[FIFO_CTRL_REG]);
+    sim->dev.wrap_from = st_axes_fifo_active(&sim->gyro) ? OUT_Z_H : 0;
+    sim->dev.wrap_to   = OUT_X_L;
+}
+
+
+static void on_write(i2c_sim_device_t *dev, uint8_t reg, uint8_t value) {
+    l3gd20_sim_t *sim = (l3gd20_sim_t *)dev;
+
+    // Identification, output and status registers are read only
+    if (reg == WHO_AM_I || (reg >= OUT_TEMP && reg <= OUT_Z_H) || reg == FIFO_SRC_REG) return;
+
+    dev->regs[reg] = value;
+    if (reg == CTRL_REG1 || reg == CTRL_REG4 || reg == CTRL_REG5 || reg == FIFO_CTRL_REG) {
+        configure(sim);
+    }
+}
+
+
+static uint8_t on_read(i2c_sim_device_t *dev, uint8_t reg) {
+    l3gd20_sim_t *sim = (l3gd20_sim_t *)dev;
+    uint64_t now = time_us_64();
+
+    if (reg == STATUS_REG) return st_axes_read_status(&sim->gyro, now);
+    if (reg >= OUT_X_L && reg <= OUT_Z_H) return st_axes_read_out(&sim->gyro, reg - OUT_X_L, now);
+    if (reg == FIFO_SRC_REG) return st_axes_read_fifo_src(&sim->gyro, now);
+
+    // -1 LSB/degC, offset unspecified so centre it on 25 degC
+    if (reg == OUT_TEMP) return (uint8_t)(int8_t)(25.0f - sim->temp_c);
+
+    return dev->regs[reg];
+}
+
+
+void l3gd20_sim_attach(i2c_inst_t *i2c) {
+    l3gd20_sim_t *sim = &l3gd20;
+    *sim = (l3gd20_sim_t){0};
+
+    sim->dev.addr = L3GD20_ADDR;
+    sim->dev.msb_auto_increment = true;
+    sim->dev.on_write = on_write;
+    sim->dev.on_read  = on_read;
+    sim->temp_c = 25.0f;
+    sim->gyro.seed = 3;
+
+    // Power on defaults
+    sim->dev.regs[WHO_AM_I]  = L3GD20_ID;
+    sim->dev.regs[CTRL_REG1] = 0b00000111;
+    configure(sim);
+
+    i2c_sim_attach(i2c, &sim->dev);
+}
+
+
+void l3gd20_sim_set_gyro(float x, float y, float z) {
+    l3gd20.gyro.value[0] = x;
+    l3gd20.gyro.value[1] = y;
+    l3gd20.gyro.value[2] = z;
+}
+
+
+void l3gd20_sim_set_noise(uint16_t lsb) {
+    l3gd20.gyro.noise = lsb;
+}
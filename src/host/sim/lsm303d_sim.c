@@ -0,0 +1,140 @@
+#include "gy89_sim.h"
+#include "i2c_sim.h"
+#include "st_axes.h"
+
+/*
+ * #Defines
+ */
+#define LSM303D_ADDR    0x1E
+#define LSM303D_ID      0b01001001
+
+#define TEMP_OUT_L      0x05
+#define TEMP_OUT_H      0x06
+#define STATUS_M        0x07
+#define OUT_X_L_M       0x08
+#define OUT_Z_H_M       0x0D
+#define WHO_AM_I        0x0F
+#define CTRL0           0x1F
+#define CTRL1           0x20
+#define CTRL2           0x21
+#define CTRL5           0x24
+#define CTRL6           0x25
+#define CTRL7           0x26
+#define STATUS_A        0x27
+#define OUT_X_L_A       0x28
+#define OUT_Z_H_A       0x2D
+#define FIFO_CTRL       0x2E
+#define FIFO_SRC        0x2F
+
+#define FIFO_EN         0b01000000
+
+typedef struct lsm303d_sim {
+    i2c_sim_device_t dev;
+    st_axes_t acc;
+    st_axes_t mag;
+    float     temp_c;
+} lsm303d_sim_t;
+
+static lsm303d_sim_t lsm303d;
+
+// CTRL1 AODR[3:0], Hz
+static const float ACC_ODR[16] = {0, 3.125f, 6.25f, 12.5f, 25, 50, 100, 200, 400, 800, 1600};
+// CTRL2 AFS[2:0], g/LSB
+static const float ACC_LSB[8]  = {0.061e-3f, 0.122e-3f, 0.183e-3f, 0.244e-3f, 0.732e-3f};
+// CTRL5 M_ODR[2:0], Hz
+static const float MAG_ODR[8]  = {3.125f, 6.25f, 12.5f, 25, 50, 100};
+// CTRL6 MFS[1:0], gauss/LSB
+static const float MAG_LSB[4]  = {0.080e-3f, 0.160e-3f, 0.320e-3f, 0.479e-3f};
+
+
+static void configure(lsm303d_sim_t *sim) {
+    uint8_t *regs = sim->dev.regs;
+    uint64_t now = time_us_64();
+
+    st_axes_configure(&sim->acc, ACC_ODR[regs[CTRL1] >> 4], ACC_LSB[(regs[CTRL2] >> 3) & 0b111], now);
+
+    // MD[1:0] = 00 is continuous conversion, anything else is powered down
+    bool mag_on = (regs[CTRL7] & 0b11) == 0;
+    st_axes_configure(&sim->mag, mag_on ? MAG_ODR[(regs[CTRL5] >> 2) & 0b111] : 0,
+                      MAG_LSB[(regs[CTRL6] >> 5) & 0b11], now);
+
+    // The FIFO only holds accelerometer data, bursts from OUT_Z_H_A roll
+    // back to OUT_X_L_A so it drains in one read
+    st_axes_configure_fifo(&sim->acc, regs[CTRL0] & FIFO_EN, regs[FIFO_CTRL]);
+    sim->dev.wrap_from = st_axes_fifo_active(&sim->acc) ? OUT_Z_H_A : 0;
+    sim->dev.wrap_to   = OUT_X_L_A;
+}
+
+
+static void on_write(i2c_sim_device_t *dev, uint8_t reg, uint8_t value) {
+    lsm303d_sim_t *sim = (lsm303d_sim_t *)dev;
+
+    // Output and status registers are read only
+    if (reg < 0x12 || reg == STATUS_A || (reg >= OUT_X_L_A && reg <= OUT_Z_H_A) || reg == FIFO_SRC) return;
+
+    dev->regs[reg] = value;
+    if ((reg >= CTRL0 && reg <= CTRL7) || reg == FIFO_CTRL) configure(sim);
+}
+
+
+static uint8_t on_read(i2c_sim_device_t *dev, uint8_t reg) {
+    lsm303d_sim_t *sim = (lsm303d_sim_t *)dev;
+    uint64_t now = time_us_64();
+
+    if (reg == STATUS_A) return st_axes_read_status(&sim->acc, now);
+    if (reg >= OUT_X_L_A && reg <= OUT_Z_H_A) return st_axes_read_out(&sim->acc, reg - OUT_X_L_A, now);
+    if (reg == FIFO_SRC) return st_axes_read_fifo_src(&sim->acc, now);
+    if (reg == STATUS_M) return st_axes_read_status(&sim->mag, now);
+    if (reg >= OUT_X_L_M && reg <= OUT_Z_H_M) return st_axes_read_out(&sim->mag, reg - OUT_X_L_M, now);
+
+    // 12 bit temperature, 8 LSB/degC
+    int16_t temp = (int16_t)(sim->temp_c * 8);
+    if (reg == TEMP_OUT_L) return temp & 0xFF;
+    if (reg == TEMP_OUT_H) return (temp >> 8) & 0x0F;
+
+    return dev->regs[reg];
+}
+
+
+void lsm303d_sim_attach(i2c_inst_t *i2c) {
+    lsm303d_sim_t *sim = &lsm303d;
+    *sim = (lsm303d_sim_t){0};
+
+    sim->dev.addr = LSM303D_ADDR;
+    sim->dev.msb_auto_increment = true;
+    sim->dev.on_write = on_write;
+    sim->dev.on_read  = on_read;
+    sim->temp_c = 25.0f;
+    sim->acc.seed = 1;
+    sim->mag.seed = 2;
+
+    // Power on defaults
+    sim->dev.regs[WHO_AM_I] = LSM303D_ID;
+    sim->dev.regs[CTRL1]    = 0b00000111;
+    sim->dev.regs[CTRL5]    = 0b00011000;
+    sim->dev.regs[CTRL6]    = 0b00100000;
+    sim->dev.regs[CTRL7]    = 0b00000010;
+    configure(sim);
+
+    i2c_sim_attach(i2c, &sim->dev);
+}
+
+
+void lsm303d_sim_set_accel(float x, float y, float z) {
+    lsm303d.acc.value[0] = x;
+    lsm303d.acc.value[1] = y;
+    lsm303d.acc.value[2] = z;
+}
+
+
+void lsm303d_sim_set_mag(float x, float y, float z) {
+    lsm303d.mag.value[0] = x;
+    lsm303d.mag.value[1] = y;
+    lsm303d.mag.value[2] = z;
+}
+
+
+void lsm303d_sim_set_noise(uint16_t lsb) {
+    lsm303d.acc.noise = lsb;
+    lsm303d.mag.noise = lsb;
+}
@@ -0,0 +1,66 @@
+#include "ppm_sim.h"
+#include <string.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include "pico/stdlib.h"
+#include "common.h"
+#include "ppm.h"
+
+/*
+ * Stands in for the PIO receiver on the host
+ * A task publishes a frame every PPM_SIM_FRAME_MS with whatever the
+ * test last set, the same way the PIO interrupt does on the Pico.
+ */
+
+#define PPM_SIM_FRAME_MS 20
+
+static uint32_t widths[PPM_MAX_CHANNELS] = {
+    1500, 1500, 1000, 1500, 1000, 1000, 1000, 1000
+};
+static uint8_t channel_count = 8;
+static TaskHandle_t sim_task = NULL;
+
+TASK_MEMORY(sim, configMINIMAL_STACK_SIZE);
+
+
+void ppm_sim_set_channels(const int16_t *us, uint8_t count) {
+    if (count > PPM_MAX_CHANNELS) count = PPM_MAX_CHANNELS;
+
+    taskENTER_CRITICAL();
+    for (uint8_t i = 0; i < count; i++) widths[i] = us[i];
+    channel_count = count;
+    taskEXIT_CRITICAL();
+}
+
+
+static void ppm_sim_task(void *unused) {
+    TickType_t last = xTaskGetTickCount();
+    uint32_t frame[PPM_MAX_CHANNELS];
+    uint8_t count;
+
+    for (;;) {
+        vTaskDelayUntil(&last, pdMS_TO_TICKS(PPM_SIM_FRAME_MS));
+
+        taskENTER_CRITICAL();
+        memcpy(frame, widths, sizeof(frame));
+        count = channel_count;
+        taskEXIT_CRITICAL();
+
+        ppm_publish_frame(frame, count, time_us_64());
+    }
+}
+
+
+void ppm_init(uint pin, bool invert) {
+    if (sim_task == NULL) {
+        sim_task = TASK_CREATE(sim, ppm_sim_task, "PPM Sim", NULL, configMAX_PRIORITIES - 1);
+    }
+}
+
+
+void ppm_stop() {
+    if (sim_task != NULL) {
+        vTaskDelete(sim_task);
+        sim_task = NULL;
+    }
+}
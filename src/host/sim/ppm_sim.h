@@ -0,0 +1,13 @@
+#ifndef PPM_SIM_H
+#define PPM_SIM_H
+
+#include <stdint.h>
+
+/*
+ * Simulated PPM receiver, replaces the PIO backend of ppm_init()
+ */
+
+// Pulse widths in us of the frames sent from now on
+void ppm_sim_set_channels(const int16_t *us, uint8_t count);
+
+#endif
@@ -0,0 +1,153 @@
+#include "st_axes.h"
+
+/*
+ * #Defines
+ */
+#define OUT_BYTES 6
+
+#define FIFO_SRC_WTM    0b10000000
+#define FIFO_SRC_OVRN   0b01000000
+#define FIFO_SRC_EMPTY  0b00100000
+#define FIFO_SRC_FSS    0b00011111
+
+
+static int16_t quantise(st_axes_t *axes, float value) {
+    if (axes->lsb == 0) return 0;
+    float counts = value / axes->lsb;
+
+    if (axes->noise) {
+        // Cheap deterministic LCG, repeatable between runs
+        axes->seed = axes->seed * 1664525 + 1013904223;
+        counts += (int32_t)((axes->seed >> 16) % (2 * axes->noise + 1)) - axes->noise;
+    }
+
+    if (counts >  32767) return  32767;
+    if (counts < -32768) return -32768;
+    return (int16_t)counts;
+}
+
+
+static uint8_t fifo_mode(st_axes_t *axes) {
+    return axes->fifo_ctrl >> 5;
+}
+
+
+static void fifo_push(st_axes_t *axes) {
+    if (axes->fifo_count == ST_FIFO_DEPTH) {
+        // FIFO mode stops when full, stream mode drops the oldest
+        if (fifo_mode(axes) == ST_FIFO_FIFO) {
+            axes->fifo_dropped++;
+            return;
+        }
+        axes->fifo_head = (axes->fifo_head + 1) % ST_FIFO_DEPTH;
+        axes->fifo_count--;
+        axes->fifo_dropped++;
+    }
+
+    uint8_t tail = (axes->fifo_head + axes->fifo_count) % ST_FIFO_DEPTH;
+    for (int i = 0; i < 3; i++) axes->fifo[tail][i] = axes->out[i];
+    axes->fifo_count++;
+}
+
+
+static void convert(st_axes_t *axes) {
+    for (int i = 0; i < 3; i++) {
+        axes->out[i] = quantise(axes, axes->value[i]);
+    }
+    axes->conversions++;
+
+    if (st_axes_fifo_active(axes)) fifo_push(axes);
+}
+
+
+void st_axes_configure(st_axes_t *axes, float odr_hz, float lsb, uint64_t now_us) {
+    axes->period_us = odr_hz > 0 ? (uint32_t)(1000000 / odr_hz + 0.5f) : 0;
+    axes->lsb = lsb;
+    axes->last_us = now_us;
+}
+
+
+void st_axes_configure_fifo(st_axes_t *axes, bool enabled, uint8_t fifo_ctrl) {
+    // Changing mode, or passing through bypass, empties the FIFO
+    if (!enabled || (fifo_ctrl >> 5) != fifo_mode(axes) || (fifo_ctrl >> 5) == ST_FIFO_BYPASS) {
+        axes->fifo_head  = 0;
+        axes->fifo_count = 0;
+    }
+    axes->fifo_enabled = enabled;
+    axes->fifo_ctrl    = fifo_ctrl;
+}
+
+
+bool st_axes_fifo_active(st_axes_t *axes) {
+    return axes->fifo_enabled && fifo_mode(axes) != ST_FIFO_BYPASS;
+}
+
+
+/*
+ * Run every conversion that has fallen due since the last access
+ */
+void st_axes_update(st_axes_t *axes, uint64_t now_us) {
+    if (axes->period_us == 0) return;
+
+    uint64_t due = (now_us - axes->last_us) / axes->period_us;
+    if (due == 0) return;
+    axes->last_us += due * axes->period_us;
+
+    // Unread data being replaced is an overrun
+    if ((axes->status & ST_STATUS_XYZDA) || due > 1) {
+        axes->status |= ST_STATUS_XYZOR;
+    }
+    axes->status |= ST_STATUS_XYZDA;
+
+    // Past a FIFO's worth, older conversions could never be read anyway
+    uint64_t skipped = due > ST_FIFO_DEPTH + 1 ? due - (ST_FIFO_DEPTH + 1) : 0;
+    axes->conversions += skipped;
+    if (st_axes_fifo_active(axes)) axes->fifo_dropped += skipped;
+    for (uint64_t i = skipped; i < due; i++) convert(axes);
+}
+
+
+uint8_t st_axes_read_status(st_axes_t *axes, uint64_t now_us) {
+    st_axes_update(axes, now_us);
+    return axes->status;
+}
+
+
+uint8_t st_axes_read_fifo_src(st_axes_t *axes, uint64_t now_us) {
+    st_axes_update(axes, now_us);
+
+    uint8_t count = axes->fifo_count;
+    uint8_t src = count & FIFO_SRC_FSS;
+    if (count == 0)                       src |= FIFO_SRC_EMPTY;
+    if (count == ST_FIFO_DEPTH)           src |= FIFO_SRC_OVRN;
+    if (count >= (axes->fifo_ctrl & FIFO_SRC_FSS)) src |= FIFO_SRC_WTM;
+    return src;
+}
+
+
+/*
+ * Read OUT_X_L + offset. Conversions only land at the start of a read so
+ * a burst never mixes two samples, reading OUT_Z_H clears the status.
+ * With the FIFO running the output registers show the oldest stored
+ * sample and reading OUT_Z_H pops it.
+ */
+uint8_t st_axes_read_out(st_axes_t *axes, uint8_t offset, uint64_t now_us) {
+    bool fifo = st_axes_fifo_active(axes);
+
+    if (offset == 0) {
+        st_axes_update(axes, now_us);
+        if (fifo && axes->fifo_count > 0) {
+            for (int i = 0; i < 3; i++) axes->out[i] = axes->fifo[axes->fifo_head][i];
+        }
+    }
+
+    uint16_t word = (uint16_t)axes->out[(offset % OUT_BYTES) / 2];
+    if (offset == OUT_BYTES - 1) {
+        axes->status = 0;
+        if (fifo && axes->fifo_count > 0) {
+            axes->fifo_head = (axes->fifo_head + 1) % ST_FIFO_DEPTH;
+            axes->fifo_count--;
+        }
+    }
+    return (offset & 1) ? word >> 8 : word & 0xFF;
+}
@@ -0,0 +1,51 @@
+#ifndef ST_AXES_H
+#define ST_AXES_H
+
+#include "pico.h"
+
+/*
+ * One 3-axis output block of an ST MEMS part (OUT_X_L..OUT_Z_H plus its
+ * STATUS register) converting at a fixed output data rate, with the
+ * 32 level FIFO the L3GD20 and LSM303D accelerometer share
+ */
+
+#define ST_STATUS_XYZDA  0b00001111
+#define ST_STATUS_XYZOR  0b11110000
+
+#define ST_FIFO_DEPTH    32
+
+// FIFO_CTRL FM[2:0]
+#define ST_FIFO_BYPASS          0
+#define ST_FIFO_FIFO            1
+#define ST_FIFO_STREAM          2
+#define ST_FIFO_STREAM_TO_FIFO  3
+#define ST_FIFO_BYPASS_TO_STREAM 4
+
+typedef struct st_axes {
+    uint32_t period_us;    // 0 while powered down
+    uint64_t last_us;      // time of the most recent conversion
+    float    lsb;          // physical units per LSB at the configured full scale
+    float    value[3];     // what the sensor is currently measuring
+    uint16_t noise;        // peak noise, LSB
+    uint32_t seed;
+    int16_t  out[3];
+    uint8_t  status;
+    uint32_t conversions;
+
+    bool     fifo_enabled;
+    uint8_t  fifo_ctrl;
+    int16_t  fifo[ST_FIFO_DEPTH][3];
+    uint8_t  fifo_head;
+    uint8_t  fifo_count;
+    uint32_t fifo_dropped;
+} st_axes_t;
+
+void    st_axes_configure(st_axes_t *axes, float odr_hz, float lsb, uint64_t now_us);
+void    st_axes_configure_fifo(st_axes_t *axes, bool enabled, uint8_t fifo_ctrl);
+bool    st_axes_fifo_active(st_axes_t *axes);
+void    st_axes_update(st_axes_t *axes, uint64_t now_us);
+uint8_t st_axes_read_status(st_axes_t *axes, uint64_t now_us);
+uint8_t st_axes_read_fifo_src(st_axes_t *axes, uint64_t now_us);
+uint8_t st_axes_read_out(st_axes_t *axes, uint8_t offset, uint64_t now_us);
+
+#endif
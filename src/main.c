@@ -1,19 +1,92 @@
 // Includes
 #include <FreeRTOS.h>
+#include <task.h>
 #include <stdio.h>
 #include "hello_there.h"
+#include "common/common.h"
 #include "pico/stdlib.h"
+#include "rc/ppm.h"
+#include "monitor/task_stats.h"
+#include "monitor/console.h"
+#include "sensors/calibration.h"
 #include "sensors/imu.h"
+#include "sensors/sample_ring.h"
+#include "telemetry/telemetry.h"
+#include "blackbox/blackbox.h"
+#include "control/rate_control.h"
+#include "esc/esc.h"
+
+// Samples from the IMU task to the logger or telemetry
+static sample_ring_t output_ring;
+
+// Samples for the calibration procedures
+static sample_ring_t calibration_ring;
+
+// Raw samples for the flight log
+static sample_ring_t blackbox_ring;
+
+// Gyro samples for the rate controller
+static sample_ring_t control_ring;
+
+// Stack sizes in words
+TASK_MEMORY(led, 128);
+TASK_MEMORY(output, 256);
+TASK_MEMORY(calibration, 512);
+TASK_MEMORY(console, 256);
+TASK_MEMORY(blackbox, 512);
+#ifndef UAV_CORE1_ACQUISITION
+TASK_MEMORY(imu, 256);
+TASK_MEMORY(control, 256);
+#endif
+#if defined(UAV_HOST_BUILD) || !defined(UAV_BINARY_TELEMETRY)
+TASK_MEMORY(report, 256);
+#endif
+
+static bool motors_on() {
+    q16_t outputs[FRAME_MOTORS];
+    return rate_control_motors(outputs);
+}
+
 
 /*
  * Main function
  */
 int main() {
     stdio_init_all();
+    console_init();
+    ppm_init(PPM_PIN, false);
+    if (!esc_init(ESC_PROTOCOL, ESC_PIN_BASE, FRAME_MOTORS)) printf("ESC output init failed\n");
+    calibration_init();
+    blackbox_init();
     
     // Create Tasks
-    xTaskCreate(led_task, "LED Task", 128, NULL, 1, NULL);
-    xTaskCreate(imu_logger_task, "IMU Task", 256, NULL, 1, NULL);
+    TASK_CREATE(led, led_task, "LED Task", NULL, 1);
+    imu_add_consumer(&output_ring);
+    imu_add_consumer(&calibration_ring);
+    imu_set_raw_consumer(&blackbox_ring);
+    imu_add_consumer(&control_ring);
+    rate_control_init(&control_ring);
+    set_motors_check(motors_on);
+#ifdef UAV_CORE1_ACQUISITION
+    // Flown on core1 straight after each gyro read
+    imu_set_gyro_callback(rate_control_update);
+    imu_start_core1();
+#else
+    TASK_CREATE(imu, imu_task, "IMU Task", NULL, 2);
+    TASK_CREATE(control, rate_control_task, "Rate Control", NULL, 3);
+#endif
+#ifdef UAV_BINARY_TELEMETRY
+    TASK_CREATE(output, telemetry_task, "Telemetry", &output_ring, 1);
+#else
+    TASK_CREATE(output, imu_logger_task, "IMU Logger", &output_ring, 1);
+#endif
+    TASK_CREATE(calibration, calibration_task, "Calibration", &calibration_ring, 1);
+    TASK_CREATE(console, console_task, "Console", NULL, 1);
+    TASK_CREATE(blackbox, blackbox_task, "Blackbox", &blackbox_ring, 1);
+#if defined(UAV_HOST_BUILD) || !defined(UAV_BINARY_TELEMETRY)
+    // Telemetry carries the task stats, otherwise print them
+    TASK_CREATE(report, task_stats_report_task, "Task Stats", NULL, 1);
+#endif
     vTaskStartScheduler();
 
     // Infinite loop - Program will never get to here in execution
@@ -0,0 +1,169 @@
+#include "console.h"
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "periodic.h"
+
+typedef struct console_command {
+    char key;
+    const char *help;
+    console_handler_t handler;
+} console_command_t;
+
+static console_command_t commands[CONSOLE_MAX_COMMANDS];
+static uint8_t command_count = 0;
+
+static SemaphoreHandle_t port;
+#ifdef UAV_STATIC_ALLOCATION
+static StaticSemaphore_t port_memory;
+#endif
+
+#ifdef UAV_BINARY_TELEMETRY
+// Free running indices, the text is text[tail..head) modulo the size
+static char text[CONSOLE_TEXT_SIZE];
+static uint32_t text_head = 0;
+static uint32_t text_tail = 0;
+
+
+// Before the scheduler starts a critical section would leave interrupts
+// off until it does, and there is nothing to race with anyway
+static bool lock_text() {
+    bool running = xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED;
+    if (running) taskENTER_CRITICAL();
+    return running;
+}
+
+
+static void unlock_text(bool locked) {
+    if (locked) taskEXIT_CRITICAL();
+}
+#endif
+
+
+/*
+ * Before anything prints or registers a command
+ */
+void console_init() {
+#ifdef UAV_STATIC_ALLOCATION
+    port = xSemaphoreCreateMutexStatic(&port_memory);
+#else
+    port = xSemaphoreCreateMutex();
+#endif
+}
+
+
+/*
+ * Hold the USB serial port for a run of writes that must not be split,
+ * from tasks only. Before the scheduler starts there is nobody to share
+ * it with.
+ */
+void console_claim_port() {
+    if (port != NULL && xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+        xSemaphoreTake(port, portMAX_DELAY);
+    }
+}
+
+
+void console_release_port() {
+    if (port != NULL && xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+        xSemaphoreGive(port);
+    }
+}
+
+
+/*
+ * Add a command, false if the key is taken or there is no room left
+ */
+bool console_register(char key, const char *help, console_handler_t handler) {
+    if (command_count >= CONSOLE_MAX_COMMANDS || key == '?') return false;
+
+    for (uint8_t i = 0; i < command_count; i++) {
+        if (commands[i].key == key) return false;
+    }
+
+    commands[command_count++] = (console_command_t){key, help, handler};
+    return true;
+}
+
+
+/*
+ * printf() for the operator, from any task on core0
+ */
+void console_printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+#ifdef UAV_BINARY_TELEMETRY
+    char line[CONSOLE_LINE_MAX];
+    int length = vsnprintf(line, sizeof(line), format, args);
+    if (length > (int)sizeof(line) - 1) length = sizeof(line) - 1;
+
+    bool locked = lock_text();
+    if (length > 0 && text_head - text_tail + length <= CONSOLE_TEXT_SIZE) {
+        for (int i = 0; i < length; i++) text[text_head++ % CONSOLE_TEXT_SIZE] = line[i];
+    }
+    unlock_text(locked);
+#else
+    console_claim_port();
+    vprintf(format, args);
+    console_release_port();
+#endif
+    va_end(args);
+}
+
+
+/*
+ * Up to max bytes of the text waiting to be sent, for the telemetry task.
+ * Returns how many, 0 with nothing waiting or binary telemetry off.
+ */
+size_t console_take_text(char *out, size_t max) {
+    size_t length = 0;
+#ifdef UAV_BINARY_TELEMETRY
+    bool locked = lock_text();
+    while (length < max && text_tail != text_head) out[length++] = text[text_tail++ % CONSOLE_TEXT_SIZE];
+    unlock_text(locked);
+#endif
+    return length;
+}
+
+
+static void print_help() {
+    for (uint8_t i = 0; i < command_count; i++) {
+        console_printf("  %c  %s\n", commands[i].key, commands[i].help);
+    }
+}
+
+
+static void run(char key) {
+    if (key == '?') {
+        print_help();
+        return;
+    }
+
+    for (uint8_t i = 0; i < command_count; i++) {
+        if (commands[i].key == key) {
+            commands[i].handler();
+            return;
+        }
+    }
+}
+
+
+/*
+ * Poll for keys, everything typed since the last poll is run in order
+ */
+void console_task() {
+    static periodic_t loop;
+    periodic_init(&loop, "Console", CONSOLE_POLL_MS);
+
+    while (true) {
+        periodic_wait(&loop);
+
+        int c;
+        while ((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT) {
+            run((char)c);
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Single key commands over the USB serial port
+ *
+ * Modules register a key and a handler before the scheduler starts, the
+ * console task polls stdin and runs the handler of each key it receives
+ * on its own stack. '?' lists the commands.
+ *
+ * Replies and prompts go out through console_printf(). With binary
+ * telemetry the port carries telemetry frames, so the text is held here
+ * until the telemetry task sends it as text frames, otherwise it is
+ * printed straight away.
+ *
+ * Whatever writes to the port directly, the telemetry frames, the
+ * blackbox dump and the text logger, claims it for the whole of what it
+ * writes, so one never lands in the middle of another.
+ */
+
+#define CONSOLE_MAX_COMMANDS 12
+#define CONSOLE_POLL_MS      50
+
+// Text waiting for the telemetry task, a power of two. A reply that does
+// not fit is dropped whole, one call formats at most CONSOLE_LINE_MAX - 1
+// bytes.
+#define CONSOLE_TEXT_SIZE    1024
+#define CONSOLE_LINE_MAX     160
+
+typedef void (*console_handler_t)();
+
+void console_init();
+bool console_register(char key, const char *help, console_handler_t handler);
+void console_printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+size_t console_take_text(char *out, size_t max);
+void console_claim_port();
+void console_release_port();
+void console_task();
+
+#endif
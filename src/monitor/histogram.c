@@ -0,0 +1,64 @@
+#include "histogram.h"
+#include <string.h>
+
+#define SUB_BINS (1 << HISTOGRAM_SUB_BITS)
+
+// Highest power of two with its own bins
+#define TOP_EXPONENT ((HISTOGRAM_BINS / SUB_BINS) - 1 + HISTOGRAM_SUB_BITS - 1)
+
+
+static uint8_t bin_of(uint32_t value) {
+    if (value < SUB_BINS) return value;
+
+    uint8_t exponent = 31 - __builtin_clz(value);
+    if (exponent > TOP_EXPONENT) return HISTOGRAM_BINS - 1;
+
+    uint8_t sub = (value >> (exponent - HISTOGRAM_SUB_BITS)) & (SUB_BINS - 1);
+    return (exponent - HISTOGRAM_SUB_BITS + 1) * SUB_BINS + sub;
+}
+
+
+// Largest value that lands in a bin
+static uint32_t bin_upper(uint8_t bin) {
+    if (bin < SUB_BINS) return bin;
+    if (bin == HISTOGRAM_BINS - 1) return UINT32_MAX;
+
+    uint8_t shift = bin / SUB_BINS - 1;
+    uint32_t lower = (uint32_t)(SUB_BINS + bin % SUB_BINS) << shift;
+    return lower + (1u << shift) - 1;
+}
+
+
+void histogram_reset(histogram_t *histogram) {
+    memset(histogram, 0, sizeof(*histogram));
+}
+
+
+void histogram_add(histogram_t *histogram, uint32_t value) {
+    histogram->bins[bin_of(value)]++;
+    histogram->count++;
+    if (value > histogram->max) histogram->max = value;
+}
+
+
+/*
+ * Value below which percent of the samples fall, rounded up to the top
+ * of its bin but never past the largest sample. 0 when empty.
+ */
+uint32_t histogram_percentile(const histogram_t *histogram, uint8_t percent) {
+    if (histogram->count == 0) return 0;
+
+    // Rank of the sample wanted, counting from 1
+    uint32_t rank = ((uint64_t)histogram->count * percent + 99) / 100;
+    if (rank == 0) rank = 1;
+
+    uint32_t seen = 0;
+    for (uint8_t bin = 0; bin < HISTOGRAM_BINS; bin++) {
+        seen += histogram->bins[bin];
+        if (seen >= rank) {
+            uint32_t upper = bin_upper(bin);
+            return upper < histogram->max ? upper : histogram->max;
+        }
+    }
+    return histogram->max;
+}
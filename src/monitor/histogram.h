@@ -0,0 +1,27 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+
+/*
+ * Log scale histogram of durations in us
+ * Each power of two is split into four bins, so a bin is at most a
+ * quarter of its value wide and a percentile is within 25% above the
+ * true one. Values 0 to 3 are exact, anything past 2^24 us (16 s) goes
+ * in the last bin. The largest value is also kept exactly.
+ */
+
+#define HISTOGRAM_SUB_BITS  2
+#define HISTOGRAM_BINS      93  // up to 2^24 us, then one bin for the rest
+
+typedef struct histogram {
+    uint32_t bins[HISTOGRAM_BINS];
+    uint32_t count;
+    uint32_t max;
+} histogram_t;
+
+void histogram_reset(histogram_t *histogram);
+void histogram_add(histogram_t *histogram, uint32_t value);
+uint32_t histogram_percentile(const histogram_t *histogram, uint8_t percent);
+
+#endif
@@ -0,0 +1,103 @@
+#include "periodic.h"
+#include <string.h>
+#include <task.h>
+#include "hardware/timer.h"
+
+static const periodic_t *loops[PERIODIC_MAX_LOOPS];
+static uint8_t loop_count = 0;
+
+
+/*
+ * Set up a loop running every period_ms, the first iteration starts on
+ * the first periodic_wait()
+ */
+void periodic_init(periodic_t *loop, const char *name, uint32_t period_ms) {
+    strncpy(loop->name, name, PERIODIC_NAME_LEN);
+    loop->period_ticks = pdMS_TO_TICKS(period_ms);
+    loop->period_us = period_ms * 1000;
+    loop->deadline_us = loop->period_us;
+    loop->running = false;
+    periodic_reset(loop);
+
+    taskENTER_CRITICAL();
+    if (loop_count < PERIODIC_MAX_LOOPS) {
+        loops[loop_count++] = loop;
+    }
+    taskEXIT_CRITICAL();
+}
+
+
+void periodic_set_deadline(periodic_t *loop, uint32_t deadline_us) {
+    loop->deadline_us = deadline_us;
+}
+
+
+/*
+ * End the current iteration and sleep until the next one is due
+ * Returns false if this iteration missed its deadline.
+ */
+bool periodic_wait(periodic_t *loop) {
+    bool missed = false;
+
+    if (!loop->running) {
+        loop->wake = xTaskGetTickCount();
+    } else {
+        uint32_t execution = time_us_64() - loop->started_us;
+        histogram_add(&loop->execution, execution);
+        missed = execution > loop->deadline_us;
+    }
+
+    // Returns pdFALSE when the wake time has already passed
+    if (xTaskDelayUntil(&loop->wake, loop->period_ticks) == pdFALSE && loop->running) {
+        missed = true;
+    }
+
+    uint64_t now = time_us_64();
+    if (loop->running) {
+        histogram_add(&loop->period, now - loop->started_us);
+        loop->iterations++;
+        if (missed) loop->misses++;
+    }
+    loop->running = true;
+    loop->started_us = now;
+
+    return !missed;
+}
+
+
+/*
+ * Clear the stats, the loop keeps its timing
+ */
+void periodic_reset(periodic_t *loop) {
+    loop->iterations = 0;
+    loop->misses = 0;
+    histogram_reset(&loop->period);
+    histogram_reset(&loop->execution);
+}
+
+
+/*
+ * Percentiles are read while the loop may be recording, so from another
+ * task they can be an iteration out between fields
+ */
+void periodic_get_stats(const periodic_t *loop, periodic_stats_t *stats) {
+    stats->period_us = loop->period_us;
+    stats->iterations = loop->iterations;
+    stats->misses = loop->misses;
+    stats->period_p50_us = histogram_percentile(&loop->period, 50);
+    stats->period_p99_us = histogram_percentile(&loop->period, 99);
+    stats->period_max_us = loop->period.max;
+    stats->exec_p50_us = histogram_percentile(&loop->execution, 50);
+    stats->exec_p99_us = histogram_percentile(&loop->execution, 99);
+    stats->exec_max_us = loop->execution.max;
+}
+
+
+uint8_t periodic_count() {
+    return loop_count;
+}
+
+
+const periodic_t *periodic_get(uint8_t index) {
+    return index < loop_count ? loops[index] : NULL;
+}
@@ -0,0 +1,68 @@
+#ifndef PERIODIC_H
+#define PERIODIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <FreeRTOS.h>
+#include "histogram.h"
+
+/*
+ * Fixed rate task loop with timing stats
+ *
+ * Wakes on absolute tick deadlines with xTaskDelayUntil, so unlike
+ * task_delay_ms() a slow iteration does not push every later one back.
+ * Each iteration records the time since the previous one started
+ * (period) and how long its work took (execution) into histograms. An
+ * iteration misses its deadline when its work overruns the deadline or
+ * the next wake up was already due when it finished.
+ *
+ *   periodic_init(&loop, "Telemetry", 5);
+ *   while (true) {
+ *       periodic_wait(&loop);
+ *       ...
+ *   }
+ */
+
+// Loops visible to periodic_get(), for telemetry
+#define PERIODIC_MAX_LOOPS 8
+
+#define PERIODIC_NAME_LEN 12
+
+typedef struct periodic {
+    char name[PERIODIC_NAME_LEN];
+    TickType_t period_ticks;
+    TickType_t wake;
+    uint32_t period_us;
+    uint32_t deadline_us;       // execution budget, the period unless set
+
+    bool running;               // an iteration has started
+    uint64_t started_us;        // of the current iteration
+    uint32_t iterations;
+    uint32_t misses;
+    histogram_t period;
+    histogram_t execution;
+} periodic_t;
+
+typedef struct periodic_stats {
+    uint32_t period_us;
+    uint32_t iterations;
+    uint32_t misses;
+    uint32_t period_p50_us;
+    uint32_t period_p99_us;
+    uint32_t period_max_us;
+    uint32_t exec_p50_us;
+    uint32_t exec_p99_us;
+    uint32_t exec_max_us;
+} periodic_stats_t;
+
+void periodic_init(periodic_t *loop, const char *name, uint32_t period_ms);
+void periodic_set_deadline(periodic_t *loop, uint32_t deadline_us);
+bool periodic_wait(periodic_t *loop);
+void periodic_reset(periodic_t *loop);
+void periodic_get_stats(const periodic_t *loop, periodic_stats_t *stats);
+
+// Every loop that has been initialised
+uint8_t periodic_count();
+const periodic_t *periodic_get(uint8_t index);
+
+#endif
@@ -0,0 +1,146 @@
+#include "task_stats.h"
+#include <stdio.h>
+#include <string.h>
+#include <task.h>
+#include "hardware/timer.h"
+#include "common.h"
+#include "periodic.h"
+#include "console.h"
+
+// The host report goes to stderr, stdout may be carrying telemetry
+#ifdef UAV_HOST_BUILD
+#define REPORT_STREAM stderr
+#else
+#define REPORT_STREAM stdout
+#endif
+
+typedef struct task_trace {
+    uint32_t switched_in_us;
+    uint32_t switches;
+    uint32_t max_run_us;
+} task_trace_t;
+
+// Written only from the context switch, which cannot preempt itself
+static task_trace_t trace[TASK_STATS_MAX_TASKS];
+
+
+/*
+ * Run time clock, the low word of the 1 MHz timer. Wraps every 71
+ * minutes, which is fine as only differences are used.
+ */
+uint32_t task_stats_time_us(void) {
+    return time_us_32();
+}
+
+
+void task_stats_switched_in(uint32_t number) {
+    if (number >= TASK_STATS_MAX_TASKS) return;
+
+    trace[number].switched_in_us = time_us_32();
+    trace[number].switches++;
+}
+
+
+void task_stats_switched_out(uint32_t number) {
+    if (number >= TASK_STATS_MAX_TASKS) return;
+
+    uint32_t run = time_us_32() - trace[number].switched_in_us;
+    if (run > trace[number].max_run_us) {
+        trace[number].max_run_us = run;
+    }
+}
+
+
+void task_stats_window_init(task_stats_window_t *window) {
+    memset(window, 0, sizeof(*window));
+    window->total_us = task_stats_time_us();
+}
+
+
+/*
+ * Stats of every task since the previous collect through this window
+ * Fills at most max entries and returns how many. Walks every task list
+ * with the scheduler suspended, so call it at a low rate.
+ */
+uint8_t task_stats_collect(task_stats_window_t *window, task_stats_t *stats, uint8_t max) {
+    static TaskStatus_t status[TASK_STATS_MAX_TASKS];
+    uint32_t total_us;
+
+    UBaseType_t tasks = uxTaskGetSystemState(status, TASK_STATS_MAX_TASKS, &total_us);
+    uint32_t elapsed = total_us - window->total_us;
+    window->total_us = total_us;
+
+    uint8_t count = 0;
+    for (UBaseType_t i = 0; i < tasks && count < max; i++) {
+        UBaseType_t number = status[i].xTaskNumber;
+        if (number >= TASK_STATS_MAX_TASKS) continue;
+
+        uint32_t run = status[i].ulRunTimeCounter - window->run_us[number];
+        uint32_t switches = trace[number].switches;
+
+        task_stats_t *s = &stats[count++];
+        s->number = number;
+        s->priority = status[i].uxCurrentPriority;
+        strncpy(s->name, status[i].pcTaskName, TASK_STATS_NAME_LEN);
+        s->cpu_permille = elapsed ? ((uint64_t)run * 1000 + elapsed / 2) / elapsed : 0;
+        s->switches = switches - window->switches[number];
+        s->max_run_us = trace[number].max_run_us;
+        s->stack_free = status[i].usStackHighWaterMark;
+
+        window->run_us[number] = status[i].ulRunTimeCounter;
+        window->switches[number] = switches;
+    }
+    return count;
+}
+
+
+static void print_loops() {
+    periodic_stats_t stats;
+
+    fprintf(REPORT_STREAM, "%-12s %8s %10s %8s %26s %26s\n",
+            "Loop", "Period", "Iterations", "Misses", "period p50/p99/max us", "exec p50/p99/max us");
+    for (uint8_t i = 0; i < periodic_count(); i++) {
+        const periodic_t *loop = periodic_get(i);
+        periodic_get_stats(loop, &stats);
+        fprintf(REPORT_STREAM, "%-12.*s %8lu %10lu %8lu %8lu %8lu %8lu %8lu %8lu %8lu\n",
+                PERIODIC_NAME_LEN, loop->name, (unsigned long)stats.period_us,
+                (unsigned long)stats.iterations, (unsigned long)stats.misses,
+                (unsigned long)stats.period_p50_us, (unsigned long)stats.period_p99_us,
+                (unsigned long)stats.period_max_us, (unsigned long)stats.exec_p50_us,
+                (unsigned long)stats.exec_p99_us, (unsigned long)stats.exec_max_us);
+    }
+}
+
+
+/*
+ * Prints a table of every task and periodic loop each
+ * TASK_STATS_PERIOD_MS
+ */
+void task_stats_report_task(void *unused) {
+    static task_stats_window_t window;
+    static task_stats_t stats[TASK_STATS_MAX_TASKS];
+    static periodic_t report;
+
+    task_stats_window_init(&window);
+    periodic_init(&report, "Task Stats", TASK_STATS_PERIOD_MS);
+
+    while (true) {
+        periodic_wait(&report);
+
+        uint8_t count = task_stats_collect(&window, stats, TASK_STATS_MAX_TASKS);
+
+        console_claim_port();
+        fprintf(REPORT_STREAM, "%-12s %3s %6s %8s %10s %10s\n",
+                "Task", "Pri", "CPU%", "Switches", "MaxRun us", "StackFree");
+        for (uint8_t i = 0; i < count; i++) {
+            const task_stats_t *s = &stats[i];
+            fprintf(REPORT_STREAM, "%-12.*s %3u %4u.%u %8lu %10lu %10u\n",
+                    TASK_STATS_NAME_LEN, s->name, s->priority,
+                    s->cpu_permille / 10, s->cpu_permille % 10,
+                    (unsigned long)s->switches, (unsigned long)s->max_run_us, s->stack_free);
+        }
+        print_loops();
+        fprintf(REPORT_STREAM, "\n");
+        console_release_port();
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef TASK_STATS_H
+#define TASK_STATS_H
+
+#include <stdint.h>
+#include <FreeRTOS.h>
+
+/*
+ * Per task CPU load, run time and stack headroom
+ *
+ * FreeRTOS keeps the run time of each task against the 1 MHz system
+ * timer (configGENERATE_RUN_TIME_STATS). The switch hooks in
+ * FreeRTOSConfig.h add the longest single run and the number of times
+ * each task was switched in. Only FreeRTOS tasks are covered, the bare
+ * metal core1 loop is not.
+ */
+
+// Tasks tracked, by FreeRTOS task number, which starts at 1
+#define TASK_STATS_MAX_TASKS 16
+
+// Task name as reported, truncated
+#define TASK_STATS_NAME_LEN 12
+
+// How often the report and telemetry go out
+#define TASK_STATS_PERIOD_MS 1000
+
+typedef struct task_stats {
+    uint8_t number;
+    uint8_t priority;
+    char name[TASK_STATS_NAME_LEN];     // NUL padded, not always terminated
+    uint16_t cpu_permille;              // over the window
+    uint32_t switches;                  // over the window
+    uint32_t max_run_us;                // longest single run since boot
+    uint16_t stack_free;                // fewest words ever left on the stack
+} task_stats_t;
+
+// Counters at the previous collect, one per reader of the stats
+typedef struct task_stats_window {
+    uint32_t total_us;
+    uint32_t run_us[TASK_STATS_MAX_TASKS];
+    uint32_t switches[TASK_STATS_MAX_TASKS];
+} task_stats_window_t;
+
+void task_stats_window_init(task_stats_window_t *window);
+uint8_t task_stats_collect(task_stats_window_t *window, task_stats_t *stats, uint8_t max);
+void task_stats_report_task(void *unused);
+
+// Called by the kernel, see FreeRTOSConfig.h
+uint32_t task_stats_time_us(void);
+void task_stats_switched_in(uint32_t number);
+void task_stats_switched_out(uint32_t number);
+
+#endif
@@ -0,0 +1,127 @@
+#include "ppm.h"
+#include <stdatomic.h>
+
+/*
+ * Newest frame, guarded by a sequence lock
+ * The writer makes the sequence odd while it updates the frame and even
+ * again once it is done. A reader retries until it copies the frame
+ * between two identical, even sequence values. Readers never block the
+ * writer, which runs in interrupt context.
+ */
+static ppm_frame_t frame;
+static _Atomic uint32_t sequence = 0;
+
+static TaskHandle_t frame_task = NULL;
+
+
+/*
+ * Publish one frame of pulse widths, once per frame from the receiver
+ */
+void ppm_publish_frame(const uint32_t *widths_us, uint8_t count, uint64_t timestamp_us) {
+    uint32_t seq = atomic_load_explicit(&sequence, memory_order_relaxed);
+    atomic_store_explicit(&sequence, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    if (count > PPM_MAX_CHANNELS) count = PPM_MAX_CHANNELS;
+    frame.timestamp_us = timestamp_us;
+    frame.cycle++;
+    frame.count = count;
+    for (uint8_t i = 0; i < count; i++) {
+        frame.channels[i] = widths_us[i] > INT16_MAX ? INT16_MAX : widths_us[i];
+    }
+
+    atomic_store_explicit(&sequence, seq + 2, memory_order_release);
+
+    if (frame_task != NULL) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveIndexedFromISR(frame_task, PPM_NOTIFY_INDEX, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
+
+void ppm_snapshot(ppm_frame_t *out) {
+    uint32_t before, after;
+
+    do {
+        before = atomic_load_explicit(&sequence, memory_order_acquire);
+        *out = frame;
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&sequence, memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
+
+uint64_t ppm_frame_timestamp_us() {
+    ppm_frame_t copy;
+    ppm_snapshot(&copy);
+    return copy.timestamp_us;
+}
+
+
+/*
+ * Wake this task on every new frame
+ */
+void ppm_notify_task(TaskHandle_t task) {
+    frame_task = task;
+}
+
+
+/*
+ * Block the calling task until the next frame, false on timeout
+ */
+bool ppm_wait_frame(uint32_t timeout_ms) {
+    frame_task = xTaskGetCurrentTaskHandle();
+    return ulTaskNotifyTakeIndexed(PPM_NOTIFY_INDEX, pdTRUE, pdMS_TO_TICKS(timeout_ms)) > 0;
+}
+
+
+static int16_t deadband(int16_t v, int16_t bandwidth) {
+    if (bandwidth == 0) return v;
+    if (v < 0) return v > -bandwidth ? 0 : v + bandwidth;
+    return v < bandwidth ? 0 : v - bandwidth;
+}
+
+
+/*
+ * Pulse width of a channel, counting from 1. Channels the receiver is
+ * not sending read as centred.
+ */
+int16_t read_channel(int16_t channel) {
+    ppm_frame_t copy;
+    ppm_snapshot(&copy);
+
+    return (channel >= 1 && channel <= copy.count)
+        ? copy.channels[channel - 1]
+        : PPM_CENTRE_US;
+}
+
+
+int16_t read_throttle(int16_t channel, int16_t zero_point) {
+    int16_t v = read_channel(channel);
+    return v < zero_point ? 0 : v;
+}
+
+
+int16_t read_reversable_throttle(int16_t channel, int16_t zero_point, int16_t band) {
+    return deadband(read_channel(channel) - zero_point, band);
+}
+
+
+int16_t read_midstick(int16_t channel, int16_t band) {
+    return deadband(read_channel(channel) - PPM_CENTRE_US, band);
+}
+
+
+int16_t read_switch(int16_t channel, int16_t bands) {
+    int16_t v = read_channel(channel) - 1000;
+    int16_t bandwidth = 1000 / bands;
+    int16_t n = 0;
+
+    // Likely faster than a division, a 3-way switch is 3 subtractions
+    while (v > bandwidth) {
+        v -= bandwidth;
+        n++;
+    }
+    return n;
+}
@@ -0,0 +1,61 @@
+#ifndef PPM_H
+#define PPM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include "pico.h"
+
+/*
+ * PPM radio receiver input
+ *
+ * Ported from the legacy Arduino PPM class. Edges are timed by a PIO
+ * state machine and the pulse widths DMA'd into a double buffered frame,
+ * the CPU only runs once per frame to publish it. Readers get a
+ * consistent copy through a sequence lock, so a frame can never be torn
+ * between two receiver updates.
+ */
+
+#define PPM_PIN 15
+
+// Up to 16 channels of PPM, but the true number is auto-detected
+#define PPM_MAX_CHANNELS 16
+
+// 2.5 ms of space indicates a reset condition back to channel 1
+#define PPM_DETECTION_SPACE_US 2500
+
+// Notification index used to wake a task on each new frame
+#define PPM_NOTIFY_INDEX 2
+
+// Defaults from the legacy API
+#define PPM_THROTTLE_ZERO_POINT 1200
+#define PPM_CENTRE_US           1500
+
+typedef struct ppm_frame {
+    uint64_t timestamp_us;      // when the sync gap ending the frame was seen
+    uint32_t cycle;             // frames received, wraps
+    uint8_t count;              // channels in this frame
+    int16_t channels[PPM_MAX_CHANNELS];    // pulse widths, us
+} ppm_frame_t;
+
+void ppm_init(uint pin, bool invert);
+void ppm_stop();
+void ppm_notify_task(TaskHandle_t task);
+bool ppm_wait_frame(uint32_t timeout_ms);
+
+// Consistent copy of the newest frame
+void ppm_snapshot(ppm_frame_t *frame);
+uint64_t ppm_frame_timestamp_us();
+
+// Legacy API, each call reads the newest frame
+int16_t read_channel(int16_t channel);
+int16_t read_throttle(int16_t channel, int16_t zero_point);
+int16_t read_reversable_throttle(int16_t channel, int16_t zero_point, int16_t band);
+int16_t read_midstick(int16_t channel, int16_t band);
+int16_t read_switch(int16_t channel, int16_t bands);
+
+// Called once per frame by the receiver backend, from interrupt context
+void ppm_publish_frame(const uint32_t *widths_us, uint8_t count, uint64_t timestamp_us);
+
+#endif
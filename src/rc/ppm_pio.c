@@ -0,0 +1,102 @@
+#include "ppm.h"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "pico/stdlib.h"
+#include "ppm.pio.h"
+
+/*
+ * PIO + DMA backend
+ * The state machine pushes one count per gap, DMA moves it into the
+ * active half of a double buffer, and the sync gap raises IRQ 0. The
+ * handler swaps halves, restarts DMA and publishes the finished one, so
+ * the CPU runs once per frame rather than once per edge.
+ */
+
+static const PIO ppm_pio = pio0;
+
+static uint sm;
+static uint program_offset;
+static int dma_channel = -1;
+
+static uint32_t buffers[2][PPM_MAX_CHANNELS];
+static uint8_t active = 0;
+
+
+static void start_dma(uint8_t buffer) {
+    dma_channel_config c = dma_channel_get_default_config(dma_channel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, pio_get_dreq(ppm_pio, sm, false));
+
+    dma_channel_configure(dma_channel, &c, buffers[buffer], &ppm_pio->rxf[sm], PPM_MAX_CHANNELS, true);
+}
+
+
+static void ppm_irq_handler() {
+    // Shared with anything else on PIO0
+    if (!pio_interrupt_get(ppm_pio, 0)) return;
+
+    uint64_t now = time_us_64();
+
+    // The last gap ended at least the sync threshold ago, so DMA has long
+    // since taken it from the FIFO. What is left there is past the 16th
+    // channel and belongs to no frame.
+    dma_channel_abort(dma_channel);
+    uint32_t remaining = dma_channel_hw_addr(dma_channel)->transfer_count;
+    pio_sm_clear_fifos(ppm_pio, sm);
+
+    uint8_t done = active;
+    active ^= 1;
+    start_dma(active);
+    pio_interrupt_clear(ppm_pio, 0);
+
+    // Counts run down from the threshold
+    uint8_t count = PPM_MAX_CHANNELS - remaining;
+    uint32_t *widths = buffers[done];
+    for (uint8_t i = 0; i < count; i++) {
+        widths[i] = PPM_DETECTION_SPACE_US - widths[i] + PPM_PIO_LOST_COUNTS;
+    }
+
+    ppm_publish_frame(widths, count, now);
+}
+
+
+/*
+ * Start receiving on pin, invert for receivers with an active low stream
+ */
+void ppm_init(uint pin, bool invert) {
+    program_offset = pio_add_program(ppm_pio, &ppm_program);
+    sm = pio_claim_unused_sm(ppm_pio, true);
+    dma_channel = dma_claim_unused_channel(true);
+
+    ppm_program_init(ppm_pio, sm, program_offset, pin, PPM_DETECTION_SPACE_US);
+    gpio_set_inover(pin, invert ? GPIO_OVERRIDE_INVERT : GPIO_OVERRIDE_NORMAL);
+
+    active = 0;
+    start_dma(active);
+
+    pio_set_irq0_source_enabled(ppm_pio, pis_interrupt0, true);
+    irq_add_shared_handler(PIO0_IRQ_0, ppm_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(PIO0_IRQ_0, true);
+
+    pio_sm_set_enabled(ppm_pio, sm, true);
+}
+
+
+void ppm_stop() {
+    if (dma_channel < 0) return;
+
+    pio_sm_set_enabled(ppm_pio, sm, false);
+    pio_set_irq0_source_enabled(ppm_pio, pis_interrupt0, false);
+    irq_remove_handler(PIO0_IRQ_0, ppm_irq_handler);
+
+    dma_channel_abort(dma_channel);
+    dma_channel_unclaim(dma_channel);
+    dma_channel = -1;
+
+    pio_sm_unclaim(ppm_pio, sm);
+    pio_remove_program(ppm_pio, &ppm_program, program_offset);
+}
@@ -0,0 +1,91 @@
+#include "altitude.h"
+
+// Table spans p / QNH from 0.25 to 1.25 in 256 steps, as Q2.30
+#define RATIO_MIN    ((uint32_t)1 << 28)
+#define STEP_SHIFT   22
+#define STEPS        256
+
+/*
+ * Altitude in cm at each step,
+ * round(4433000 * (1 - (0.25 + i / 256) ^ (1 / 5.255))) for i = 0..256
+ */
+static const int32_t ALTITUDE_TABLE_CM[STEPS + 1] = {
+     1027909,  1017848,  1007911,   998096,   988398,   978816,   969345,   959983,
+      950727,   941575,   932523,   923571,   914714,   905951,   897280,   888698,
+      880204,   871796,   863471,   855228,   847065,   838980,   830972,   823039,
+      815179,   807392,   799675,   792027,   784446,   776933,   769484,   762099,
+      754777,   747517,   740316,   733175,   726093,   719067,   712097,   705183,
+      698323,   691516,   684761,   678057,   671404,   664801,   658247,   651741,
+      645282,   638869,   632503,   626181,   619904,   613670,   607480,   601331,
+      595225,   589159,   583134,   577149,   571203,   565296,   559427,   553596,
+      547801,   542043,   536322,   530635,   524984,   519367,   513785,   508236,
+      502720,   497237,   491786,   486367,   480980,   475624,   470298,   465003,
+      459737,   454501,   449294,   444116,   438967,   433845,   428752,   423685,
+      418646,   413634,   408648,   403688,   398754,   393846,   388963,   384104,
+      379271,   374462,   369677,   364916,   360178,   355464,   350773,   346104,
+      341459,   336835,   332234,   327655,   323097,   318560,   314045,   309551,
+      305077,   300624,   296192,   291779,   287387,   283014,   278660,   274326,
+      270011,   265715,   261438,   257180,   252939,   248717,   244513,   240327,
+      236159,   232008,   227875,   223758,   219659,   215577,   211511,   207463,
+      203430,   199414,   195414,   191430,   187461,   183509,   179572,   175651,
+      171745,   167854,   163978,   160117,   156270,   152439,   148622,   144819,
+      141031,   137257,   133497,   129751,   126018,   122300,   118595,   114903,
+      111225,   107560,   103908,   100270,    96644,    93031,    89431,    85844,
+       82269,    78706,    75156,    71619,    68093,    64579,    61078,    57588,
+       54110,    50644,    47190,    43747,    40315,    36895,    33486,    30088,
+       26702,    23326,    19962,    16608,    13265,     9933,     6611,     3300,
+           0,    -3290,    -6570,    -9839,   -13098,   -16347,   -19586,   -22815,
+      -26034,   -29244,   -32443,   -35633,   -38813,   -41983,   -45144,   -48296,
+      -51438,   -54570,   -57694,   -60808,   -63913,   -67009,   -70096,   -73174,
+      -76243,   -79303,   -82355,   -85397,   -88431,   -91456,   -94473,   -97481,
+     -100481,  -103472,  -106455,  -109430,  -112396,  -115354,  -118304,  -121246,
+     -124180,  -127106,  -130023,  -132933,  -135835,  -138729,  -141616,  -144494,
+     -147365,  -150229,  -153085,  -155933,  -158774,  -161607,  -164433,  -167251,
+     -170062,  -172866,  -175663,  -178452,  -181234,  -184010,  -186778,  -189539,
+     -192293,
+};
+
+// 2^46 / QNH, turns a pressure into p / QNH as Q2.30 once shifted by 16
+static volatile uint32_t inv_qnh = (uint32_t)(((uint64_t)1 << 46) / ALTITUDE_STANDARD_QNH_PA);
+static volatile uint32_t qnh = ALTITUDE_STANDARD_QNH_PA;
+
+
+/*
+ * Set the sea level pressure altitudes are measured from, false if it is
+ * outside ALTITUDE_MIN_QNH_PA to ALTITUDE_MAX_QNH_PA
+ */
+bool altitude_set_qnh(uint32_t qnh_pa) {
+    if (qnh_pa < ALTITUDE_MIN_QNH_PA || qnh_pa > ALTITUDE_MAX_QNH_PA) return false;
+
+    // Only inv_qnh is read per sample and it is one word, so the sampling
+    // side sees either the old reference or the new one
+    inv_qnh = (uint32_t)(((uint64_t)1 << 46) / qnh_pa);
+    qnh = qnh_pa;
+    return true;
+}
+
+
+uint32_t altitude_qnh_pa() {
+    return qnh;
+}
+
+
+/*
+ * Altitude above the QNH reference in cm, for a pressure in Pa
+ */
+int32_t altitude_cm(int32_t pressure_pa) {
+    if (pressure_pa <= 0) return ALTITUDE_TABLE_CM[0];
+
+    uint32_t ratio = (uint32_t)(((uint64_t)pressure_pa * inv_qnh) >> 16);
+    if (ratio < RATIO_MIN) return ALTITUDE_TABLE_CM[0];
+
+    uint32_t offset = ratio - RATIO_MIN;
+    uint32_t i = offset >> STEP_SHIFT;
+    if (i >= STEPS) return ALTITUDE_TABLE_CM[STEPS];
+
+    // 16 bits of the position between entries, a step is at most ~10100 cm
+    // so the product stays inside 32 bits
+    int32_t frac = (int32_t)((offset >> (STEP_SHIFT - 16)) & 0xFFFF);
+    int32_t low = ALTITUDE_TABLE_CM[i];
+    return low + (((ALTITUDE_TABLE_CM[i + 1] - low) * frac) >> 16);
+}
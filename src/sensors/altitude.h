@@ -0,0 +1,33 @@
+#ifndef ALTITUDE_H
+#define ALTITUDE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Pressure altitude without pow()
+ *
+ * h = 44330 m * (1 - (p / QNH)^(1 / 5.255)) only depends on p / QNH, so
+ * the curve is tabulated once over that ratio and linearly interpolated.
+ * The ratio itself is a multiply by the reciprocal of QNH, worked out when
+ * QNH is set. Against the exact formula the result is within
+ *
+ *   2.5 cm   for p / QNH >= 0.75, up to about 2.4 km
+ *   5 cm     for p / QNH >= 0.5,  up to about 5.5 km
+ *   17 cm    for p / QNH >= 0.25, up to about 10 km
+ *
+ * counting the rounding of the table to whole centimetres. Outside
+ * 0.25 to 1.25 the altitude is held at the end of the table.
+ */
+
+#define ALTITUDE_STANDARD_QNH_PA 101325
+
+// Settings a pilot could plausibly dial in
+#define ALTITUDE_MIN_QNH_PA      87000
+#define ALTITUDE_MAX_QNH_PA      108500
+
+bool altitude_set_qnh(uint32_t qnh_pa);
+uint32_t altitude_qnh_pa();
+int32_t altitude_cm(int32_t pressure_pa);
+
+#endif
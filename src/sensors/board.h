@@ -0,0 +1,87 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include "sensor.h"
+
+/*
+ * What the flight controller is built from: the sensor bus, the data
+ * ready lines and which driver stream fills each sensor role.
+ *
+ * A board defines BOARD_<ROLE> as a stream name for each role it has,
+ * out of ACC, MAG, GYRO and BARO, with its BOARD_<ROLE>_RATE_HZ. Roles
+ * with a data ready line also define BOARD_<ROLE>_DRDY_PIN, the rest are
+ * polled. Every role is read once per sample period, released at
+ * BOARD_<ROLE>_PHASE_US into it, so polled roles sharing the bus can be
+ * kept apart. Pick a board with -DUAV_BOARD_<NAME>.
+ */
+
+// The default board, when none is picked
+#if !defined(UAV_BOARD_GY89) && !defined(UAV_BOARD_REPLAY)
+#define UAV_BOARD_GY89
+#endif
+
+#if defined(UAV_BOARD_GY89)
+
+// GY-89 (LSM303D, L3GD20, BMP180) on the Pico carrier
+#include "gy89/gy89.h"
+
+#define BOARD_BUS { .i2c = i2c0, .sda_pin = 21, .scl_pin = 20, .baudrate = 400000 }
+
+#define BOARD_ACC                gy89_acc
+#define BOARD_ACC_RATE_HZ        50
+#define BOARD_ACC_DRDY_PIN       17     // LSM303D INT1
+
+#define BOARD_MAG                gy89_mag
+#define BOARD_MAG_RATE_HZ        50
+#define BOARD_MAG_DRDY_PIN       18     // LSM303D INT2
+#define BOARD_MAG_PHASE_US       10000  // between accel reads
+
+#define BOARD_GYRO               gy89_gyro
+#define BOARD_GYRO_RATE_HZ       95
+#define BOARD_GYRO_DRDY_PIN      16     // L3GD20 DRDY/INT2
+
+#define BOARD_BARO               gy89_baro
+#define BOARD_BARO_RATE_HZ       200
+#define BOARD_BARO_PHASE_US      2000
+
+#elif defined(UAV_BOARD_REPLAY)
+
+// A blackbox recording played back on the host, see replay/replay.h. The
+// GY-89's rates and phases, but every role polled and sampled at the
+// period of the recording.
+#include "replay/replay.h"
+
+#define BOARD_BUS { .i2c = i2c0, .sda_pin = 21, .scl_pin = 20, .baudrate = 400000 }
+
+#define BOARD_ACC                replay_acc
+#define BOARD_ACC_RATE_HZ        50
+
+#define BOARD_MAG                replay_mag
+#define BOARD_MAG_RATE_HZ        50
+#define BOARD_MAG_PHASE_US       10000
+
+#define BOARD_GYRO               replay_gyro
+#define BOARD_GYRO_RATE_HZ       95
+
+#define BOARD_BARO               replay_baro
+#define BOARD_BARO_RATE_HZ       200
+#define BOARD_BARO_PHASE_US      2000
+
+#else
+#error "No board selected"
+#endif
+
+#ifndef BOARD_ACC_PHASE_US
+#define BOARD_ACC_PHASE_US       0
+#endif
+#ifndef BOARD_MAG_PHASE_US
+#define BOARD_MAG_PHASE_US       0
+#endif
+#ifndef BOARD_GYRO_PHASE_US
+#define BOARD_GYRO_PHASE_US      0
+#endif
+#ifndef BOARD_BARO_PHASE_US
+#define BOARD_BARO_PHASE_US      0
+#endif
+
+#endif
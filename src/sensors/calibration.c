@@ -0,0 +1,344 @@
+#include "calibration.h"
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdatomic.h>
+#include <string.h>
+#include "common.h"
+#include "crc16.h"
+#include "storage.h"
+#include "console.h"
+#include "periodic.h"
+#include "board.h"
+
+_Static_assert(SAMPLE_ACC < CALIBRATION_SENSORS &&
+               SAMPLE_MAG < CALIBRATION_SENSORS &&
+               SAMPLE_GYRO < CALIBRATION_SENSORS,
+               "calibrated sample types must index the transforms");
+
+// "CALB", and the layout version of the record after it
+#define RECORD_MAGIC   0x424C4143
+#define RECORD_VERSION 1
+
+// Stillness limits, as a standard deviation in SI units
+#define GYRO_STILL_RADS   0.01f     // ~0.6 dps
+#define ACC_STILL_MS2     0.05f
+
+// Samples averaged per still reading
+#define GYRO_SAMPLES      100
+#define ACC_SAMPLES       32
+
+// Mag fit is tried every MAG_FIT_EVERY samples once there are MAG_MIN_SAMPLES,
+// and given up after MAG_MAX_SAMPLES
+#define MAG_MIN_SAMPLES   400
+#define MAG_FIT_EVERY     100
+#define MAG_MAX_SAMPLES   3000
+
+// Periods to throw away after switching a sensor to raw, while the
+// filters settle onto the new scale
+#define SETTLE_PERIODS    5
+
+#define STANDARD_GRAVITY  9.80665f
+
+typedef struct calibration_record {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t valid;         // bit per sample type
+    calib_affine_t affine[CALIBRATION_SENSORS];
+    uint16_t crc;           // over everything before it
+} calibration_record_t;
+
+_Static_assert(sizeof(calibration_record_t) <= FLASH_PAGE_SIZE, "calibration record must fit one page");
+
+// Two copies of each transform, acquisition reads the active one while
+// the other is rewritten, then the pointer flips
+static calib_affine_t transforms[CALIBRATION_SENSORS][2];
+static const calib_affine_t *_Atomic active[CALIBRATION_SENSORS];
+
+// What is in flash
+static calibration_record_t record;
+
+// Procedure in progress, requested from the console task
+static _Atomic int requested = -1;
+static atomic_bool cancel_requested = false;
+
+typedef struct procedure {
+    int type;               // sample type being calibrated, -1 when idle
+    uint8_t settle;
+    calib_affine_t previous;
+    calib_rest_t rest;
+    calib_six_t six;
+    calib_ellipsoid_t ellipsoid;
+} procedure_t;
+
+static procedure_t procedure = {.type = -1};
+
+// A calibration that finished with the motors running, in use but only
+// written to flash once they stop
+static bool save_pending = false;
+
+static const char *const NAMES[CALIBRATION_SENSORS] = {
+    [SAMPLE_ACC] = "accel",
+    [SAMPLE_MAG] = "mag",
+    [SAMPLE_GYRO] = "gyro"
+};
+
+
+/*
+ * Install a transform for acquisition to pick up from its next batch
+ */
+static void set_transform(sample_type_t type, const calib_affine_t *t) {
+    const calib_affine_t *current = atomic_load_explicit(&active[type], memory_order_relaxed);
+    calib_affine_t *spare = current == &transforms[type][0] ? &transforms[type][1] : &transforms[type][0];
+
+    *spare = *t;
+    atomic_store_explicit(&active[type], spare, memory_order_release);
+}
+
+
+/*
+ * Transform for acquisition to apply to the given sensor's raw counts
+ */
+const calib_affine_t *calibration_get(sample_type_t type) {
+    return atomic_load_explicit(&active[type], memory_order_acquire);
+}
+
+
+bool calibration_stored(sample_type_t type) {
+    return (record.valid & (1 << type)) != 0;
+}
+
+
+static uint16_t record_crc(const calibration_record_t *r) {
+    return crc16((const uint8_t *)r, offsetof(calibration_record_t, crc));
+}
+
+
+static void save_record() {
+    static uint8_t page[FLASH_PAGE_SIZE];
+
+    record.magic = RECORD_MAGIC;
+    record.version = RECORD_VERSION;
+    record.crc = record_crc(&record);
+
+    memset(page, 0xFF, sizeof(page));
+    memcpy(page, &record, sizeof(record));
+    storage_erase(STORAGE_CALIBRATION_OFFSET, FLASH_SECTOR_SIZE);
+    storage_program(STORAGE_CALIBRATION_OFFSET, page, sizeof(page));
+}
+
+
+static void start_gyro()  { calibration_start(SAMPLE_GYRO); }
+static void start_accel() { calibration_start(SAMPLE_ACC); }
+static void start_mag()   { calibration_start(SAMPLE_MAG); }
+
+
+/*
+ * Load the stored calibration, nominal scale for anything without one,
+ * and register the console commands. Before acquisition starts.
+ */
+void calibration_init() {
+    memcpy(&record, storage_read(STORAGE_CALIBRATION_OFFSET), sizeof(record));
+
+    if (record.magic != RECORD_MAGIC || record.version != RECORD_VERSION ||
+        record.crc != record_crc(&record)) {
+        memset(&record, 0, sizeof(record));
+    }
+
+    for (int type = 0; type < CALIBRATION_SENSORS; type++) {
+        calib_affine_t t;
+        if (calibration_stored(type)) t = record.affine[type];
+        else calib_affine_identity(&t);
+        set_transform(type, &t);
+    }
+
+    console_register('g', "calibrate gyro bias, keep still", start_gyro);
+    console_register('a', "calibrate accel, hold still on each face", start_accel);
+    console_register('m', "calibrate mag, rotate through every orientation", start_mag);
+    console_register('x', "cancel calibration", calibration_cancel);
+}
+
+
+/*
+ * Ask the calibration task to run a procedure, replacing any in progress
+ * Refused while the motors run, it would fly on uncalibrated sensors.
+ */
+void calibration_start(sample_type_t type) {
+    if (type >= CALIBRATION_SENSORS) return;
+
+    if (motors_running()) {
+        console_printf("not calibrating %s with the motors running\n", NAMES[type]);
+        return;
+    }
+    atomic_store(&requested, type);
+}
+
+
+void calibration_cancel() {
+    atomic_store(&cancel_requested, true);
+}
+
+
+/*
+ * Counts the sensor reads for a value in SI units, through its stream's
+ * scale. Worked from a large count, small ones round badly.
+ */
+static int32_t counts_for(q16_t (*to_q16)(int32_t), float value) {
+    return (int32_t)(value * 65536 * 8192 / to_q16(8192));
+}
+
+
+static void begin(int type) {
+    if (procedure.type >= 0) set_transform(procedure.type, &procedure.previous);
+
+    procedure.type = type;
+    procedure.settle = SETTLE_PERIODS;
+    procedure.previous = *calibration_get(type);
+    calib_rest_reset(&procedure.rest);
+    calib_six_reset(&procedure.six);
+    calib_ellipsoid_reset(&procedure.ellipsoid);
+
+    // Collect raw counts
+    calib_affine_t identity;
+    calib_affine_identity(&identity);
+    set_transform(type, &identity);
+
+    console_printf("calibrating %s\n", NAMES[type]);
+}
+
+
+static void finish(const calib_affine_t *t) {
+    int type = procedure.type;
+
+    set_transform(type, t);
+    record.affine[type] = *t;
+    record.valid |= 1 << type;
+    procedure.type = -1;
+
+    // The erase stops the CPU for ~45 ms, too long in flight
+    if (motors_running()) {
+        save_pending = true;
+        console_printf("%s calibration in use, stored once the motors stop\n", NAMES[type]);
+        return;
+    }
+    save_record();
+    console_printf("%s calibration stored\n", NAMES[type]);
+}
+
+
+static void abandon(const char *reason) {
+    set_transform(procedure.type, &procedure.previous);
+    console_printf("%s calibration %s, kept the previous one\n", NAMES[procedure.type], reason);
+    procedure.type = -1;
+}
+
+
+static void gyro_sample(const int32_t v[3]) {
+    calib_rest_add(&procedure.rest, v);
+    if (procedure.rest.count < GYRO_SAMPLES) return;
+
+    calib_affine_t t;
+    int32_t max_std = counts_for(SENSOR_CALL(BOARD_GYRO, to_q16), GYRO_STILL_RADS);
+    if (calib_gyro_bias(&procedure.rest, max_std, &t)) {
+        finish(&t);
+    } else {
+        console_printf("gyro moving, keep still\n");
+        calib_rest_reset(&procedure.rest);
+    }
+}
+
+
+static void acc_sample(const int32_t v[3]) {
+    calib_rest_add(&procedure.rest, v);
+    if (procedure.rest.count < ACC_SAMPLES) return;
+
+    int32_t max_std = counts_for(SENSOR_CALL(BOARD_ACC, to_q16), ACC_STILL_MS2);
+    if (calib_rest_still(&procedure.rest, max_std)) {
+        int32_t mean[3];
+        calib_rest_mean(&procedure.rest, mean);
+
+        if (calib_six_add(&procedure.six, mean)) {
+            int left = 0;
+            for (int face = 0; face < CALIB_FACES; face++) left += !(procedure.six.done & (1 << face));
+            console_printf("accel face %d done, %d to go\n", calib_six_face(mean), left);
+        }
+    }
+    calib_rest_reset(&procedure.rest);
+
+    if (calib_six_complete(&procedure.six)) {
+        calib_affine_t t;
+        int32_t one_g = counts_for(SENSOR_CALL(BOARD_ACC, to_q16), STANDARD_GRAVITY);
+        if (calib_six_solve(&procedure.six, one_g, &t)) finish(&t);
+        else abandon("out of range");
+    }
+}
+
+
+static void mag_sample(const int32_t v[3]) {
+    calib_ellipsoid_t *fit = &procedure.ellipsoid;
+    calib_ellipsoid_add(fit, v);
+
+    if (fit->count < MAG_MIN_SAMPLES || fit->count % MAG_FIT_EVERY != 0) return;
+
+    calib_affine_t t;
+    if (calib_ellipsoid_solve(fit, &t)) {
+        finish(&t);
+    } else if (fit->count >= MAG_MAX_SAMPLES) {
+        abandon("did not converge");
+    } else {
+        console_printf("mag fit needs more orientations\n");
+    }
+}
+
+
+/*
+ * Run whatever procedure is in progress on the samples since last period
+ * The ring is drained every period either way so it never backs up.
+ */
+static void drain(sample_ring_t *ring) {
+    bool collect = procedure.type >= 0 && procedure.settle == 0;
+    if (procedure.settle > 0) procedure.settle--;
+
+    sample_t sample;
+    while (sample_ring_pop(ring, &sample)) {
+        if (!collect || sample.type != procedure.type) continue;
+
+        switch (sample.type) {
+            case SAMPLE_GYRO: gyro_sample(sample.data); break;
+            case SAMPLE_ACC:  acc_sample(sample.data);  break;
+            case SAMPLE_MAG:  mag_sample(sample.data);  break;
+        }
+
+        // A procedure that finished leaves the rest of the batch alone
+        if (procedure.type < 0) collect = false;
+    }
+}
+
+
+/*
+ * Calibration procedures, as a low priority consumer of one sample ring
+ */
+void calibration_task(void *ring) {
+    static periodic_t loop;
+    periodic_init(&loop, "Calibration", CALIBRATION_PERIOD_MS);
+
+    if (!calibration_stored(SAMPLE_GYRO)) calibration_start(SAMPLE_GYRO);
+
+    while (true) {
+        periodic_wait(&loop);
+
+        if (atomic_exchange(&cancel_requested, false) && procedure.type >= 0) {
+            abandon("cancelled");
+        }
+
+        int type = atomic_exchange(&requested, -1);
+        if (type >= 0) begin(type);
+
+        if (save_pending && !motors_running()) {
+            save_pending = false;
+            save_record();
+            console_printf("calibration stored\n");
+        }
+
+        drain((sample_ring_t *)ring);
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <stdbool.h>
+#include "sample_ring.h"
+#include "calib_fit.h"
+
+/*
+ * Sensor calibration at run time
+ *
+ * Acquisition corrects every accel, mag and gyro sample with the transform
+ * calibration_get() returns, before any filtering. The transforms are
+ * loaded from flash at boot. The calibration task runs the procedures
+ * that replace them, from the samples in its own ring, and writes the
+ * result back to flash:
+ *
+ *   gyro   keep still for a second, runs by itself when none is stored
+ *   accel  hold still on each of the six faces in any order
+ *   mag    turn through every orientation until the fit converges
+ *
+ * Start them from the console, see calibration_init().
+ */
+
+// Accel, mag and gyro, indexed by sample type
+#define CALIBRATION_SENSORS 3
+
+#define CALIBRATION_PERIOD_MS 50
+
+void calibration_init();
+const calib_affine_t *calibration_get(sample_type_t type);
+bool calibration_stored(sample_type_t type);
+void calibration_start(sample_type_t type);
+void calibration_cancel();
+void calibration_task(void *ring);
+
+#endif
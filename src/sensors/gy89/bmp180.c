@@ -1,7 +1,7 @@
 #include "bmp180.h"
 #include "hardware/i2c.h"
-#include "imu.h"
-#include <math.h>
+#include "pico/time.h"
+#include "altitude.h"
 #include <stdio.h>
 
 #define       BMP180_ID       0x55
@@ -12,49 +12,41 @@ static const uint8_t CTRL_MEAS   = 0xF4; // Measurement Control
 static const uint8_t MSB         = 0xF6; // MSB of data
 static const uint8_t LSB         = 0xF7; // LSB of data
 static const uint8_t TEMP_ADDR   = 0x2E; // Temperature control register value
-static const uint8_t PRES_ADDR   = 0x34; // Pressure, OSS = 0, ultra-low power mode, 
-                                  // set to 0x74 for standard mode
+static const uint8_t PRES_ADDR   = 0x34; // Pressure control register value, OSS goes in bits 7:6
 static const uint8_t ID_REG      = 0xD0; // Contains device id
 static const uint8_t CHIP_ID     = 0x55; // Chip ID in ID_REG
 
-static const uint8_t OSS              = 0; // Oversampling ratio for pressure measurement
-static const uint8_t CONVERSION_DELAY = 4.5; // ms
-
-// Calibration Coefficients from EEPROM
-typedef struct {
-    int16_t ac1;
-    int16_t ac2;
-    int16_t ac3;
-    uint16_t ac4;
-    uint16_t ac5;
-    uint16_t ac6;
-    int16_t b1;
-    int16_t b2;
-    int16_t mb;
-    int16_t mc;
-    int16_t md;
-    int32_t b5;
-} bmp180_calib_coeffs_t;
+// Maximum conversion times from the datasheet, us
+static const uint32_t TEMP_CONVERSION_US        = 4500;
+static const uint32_t PRESSURE_CONVERSION_US[4] = {
+    4500,   // BMP180_OSS_ULTRA_LOW_POWER
+    7500,   // BMP180_OSS_STANDARD
+    13500,  // BMP180_OSS_HIGH_RES
+    25500   // BMP180_OSS_ULTRA_HIGH_RES
+};
+
+// Default pressure samples per temperature refresh
+static const uint8_t DEFAULT_TEMP_EVERY = 10;
 
 /*
     Combine 2 8-bit ints to a 16-bit int
 */
-static int16_t eight_to_sixteen(int8_t val1, int8_t val2) {
-    return ((val1 << 8) + val2);
+static int16_t eight_to_sixteen(uint8_t val1, uint8_t val2) {
+    return (int16_t)((val1 << 8) | val2);
 }
 
 /*
     Set the calibration constants in the struct
+    Returns 0 if any word reads back as 0x0000 or 0xFFFF (bad communication)
 */
-static void set_calibration_constants(bmp180_calib_coeffs_t *calib_coeffs, uint8_t *reg_vals) {
+static int set_calibration_constants(bmp180_calib_coeffs_t *calib_coeffs, uint8_t *reg_vals) {
 
     // Ensure data communication is good
     for (int i=0, j=1; i < 11; i++, j+=2) {
-        int16_t data = eight_to_sixteen(reg_vals[i*2], reg_vals[j]);
+        uint16_t data = (uint16_t)eight_to_sixteen(reg_vals[i*2], reg_vals[j]);
         if ((data == 0xFFFF) | (data == 0)) {
-            while (1) {
-                printf("Invalid calibration coefficient - data communication error\n");
-            }
+            printf("Invalid calibration coefficient - data communication error\n");
+            return 0;
         }
     }
 
@@ -70,44 +62,72 @@ static void set_calibration_constants(bmp180_calib_coeffs_t *calib_coeffs, uint8
     calib_coeffs->mb = eight_to_sixteen(reg_vals[16], reg_vals[17]);
     calib_coeffs->mc = eight_to_sixteen(reg_vals[18], reg_vals[19]);
     calib_coeffs->md = eight_to_sixteen(reg_vals[20], reg_vals[21]);
+    calib_coeffs->b5 = 0;
+
+    return 1;
 }
 
 /*
     Get the calibration constants from the EEPROM
+    The EEPROM is factory programmed so this only needs doing once
 */
-static void bmp180_get_cal_param(bmp180_calib_coeffs_t *calib_coeffs) {
+static int bmp180_get_cal_param(bmp180_t *bmp180) {
     uint8_t calib_data[22]; // 22, because there are 11 words of length 2 bytes
 
     // Read in calibration constants
-    i2c_write_blocking(I2C_PORT, BMP180_ADDR, &CALIB, 1, true);
-    i2c_read_blocking(I2C_PORT, BMP180_ADDR, calib_data, 22, false);
-
-    sleep_ms(CONVERSION_DELAY);
+    if (i2c_write_blocking(bmp180->i2c, BMP180_ADDR, &CALIB, 1, true) != 1) {
+        return 0;
+    }
+    if (i2c_read_blocking(bmp180->i2c, BMP180_ADDR, calib_data, 22, false) != 22) {
+        return 0;
+    }
 
     // Create struct to hold calibration data
-    set_calibration_constants(calib_coeffs, calib_data);
+    return set_calibration_constants(&bmp180->calib, calib_data);
 }
 
 /*
- * Read unrefined temperature data (i.e. raw temperature data) 
+ * Start a conversion, the result can be collected at bmp180->ready_us
+ * A pressure conversion takes up the oversampling last configured, which
+ * then stays until it is collected and compensated.
 */
-static int32_t bmp180_get_raw_temp() {
-    uint8_t temp_data[2];
+static void bmp180_start(bmp180_t *bmp180, bmp180_state_t state) {
+    if (state == BMP180_CONVERTING_PRESSURE) bmp180->oss = bmp180->oss_next;
 
-    // Write TEMP_ADDR into CTRL_MEAS
-    uint8_t temp_reg[] = {
+    uint8_t ctrl[] = {
         CTRL_MEAS,
-        TEMP_ADDR
+        state == BMP180_CONVERTING_TEMP ? TEMP_ADDR : PRES_ADDR + (bmp180->oss << 6)
     };
-    i2c_write_blocking(I2C_PORT, BMP180_ADDR, temp_reg, 2, false);
+    i2c_write_blocking(bmp180->i2c, BMP180_ADDR, ctrl, 2, false);
 
-    // Wait for CONVERSION_DELAYms
-    sleep_ms(CONVERSION_DELAY);
+    uint32_t conversion_us = state == BMP180_CONVERTING_TEMP
+        ? TEMP_CONVERSION_US
+        : PRESSURE_CONVERSION_US[bmp180->oss];
+    bmp180->ready_us = time_us_64() + conversion_us;
+    bmp180->state = state;
+}
+
+/*
+ * Start whichever conversion is due next. Temperature only changes
+ * slowly so it is refreshed once every temp_every pressure samples.
+*/
+static void bmp180_start_next(bmp180_t *bmp180) {
+    if (bmp180->since_temp >= bmp180->temp_every) {
+        bmp180_start(bmp180, BMP180_CONVERTING_TEMP);
+    } else {
+        bmp180_start(bmp180, BMP180_CONVERTING_PRESSURE);
+    }
+}
+
+/*
+ * Read unrefined temperature data (i.e. raw temperature data) 
+*/
+static int32_t bmp180_read_raw_temp(bmp180_t *bmp180) {
+    uint8_t temp_data[2];
 
-    // Read the data from the register
     // Read 2 bytes (i.e. MSB and LSB) starting from register 0xF6
-    i2c_write_blocking(I2C_PORT, BMP180_ADDR, &MSB, 1, true);
-    i2c_read_blocking(I2C_PORT, BMP180_ADDR, temp_data, 2, false); 
+    i2c_write_blocking(bmp180->i2c, BMP180_ADDR, &MSB, 1, true);
+    i2c_read_blocking(bmp180->i2c, BMP180_ADDR, temp_data, 2, false); 
 
     // Combine MSB and LSB
     return (temp_data[0] << 8) + temp_data[1];
@@ -116,59 +136,51 @@ static int32_t bmp180_get_raw_temp() {
 /*
  * Read unrefined pressure data (i.e. raw pressure data) 
 */
-static int32_t bmp180_get_raw_pressure() {
+static int32_t bmp180_read_raw_pressure(bmp180_t *bmp180) {
     uint8_t pressure_data[3];
 
-    // Write the data to the register
-    uint8_t pressure_reg[] = {
-        CTRL_MEAS,
-        PRES_ADDR + (OSS << 6)
-    };
-    i2c_write_blocking(I2C_PORT, BMP180_ADDR, pressure_reg, 2, false);
-
-    // Wait for CONVERSION_DELAYms
-    sleep_ms(CONVERSION_DELAY);
-
-    // Read the data from the register
     // Read 3 bytes (i.e. MSB, LSB and XLSB) starting from register 0xF6
-    i2c_write_blocking(I2C_PORT, BMP180_ADDR, &MSB, 1, true);
-    i2c_read_blocking(I2C_PORT, BMP180_ADDR, pressure_data, 3, false);
+    i2c_write_blocking(bmp180->i2c, BMP180_ADDR, &MSB, 1, true);
+    i2c_read_blocking(bmp180->i2c, BMP180_ADDR, pressure_data, 3, false);
 
     // Math found in datasheet
-    return ((pressure_data[0] << 16) + (pressure_data[1] << 8) + pressure_data[2]) >> (8 - OSS);
+    return ((pressure_data[0] << 16) + (pressure_data[1] << 8) + pressure_data[2]) >> (8 - bmp180->oss);
 }
 
 /*
- * Get refined temperature value in degrees C
+ * Refined temperature value in degrees C, also updates b5 for the
+ * pressure compensation
 */
-static float bmp180_get_temp(bmp180_calib_coeffs_t *calib_coeffs) {
-    int32_t raw_temp = bmp180_get_raw_temp();
+static float bmp180_compensate_temp(bmp180_t *bmp180, int32_t raw_temp) {
+    bmp180_calib_coeffs_t *calib_coeffs = &bmp180->calib;
 
     // Magical conversion maths found in datasheet
     int32_t X1 = ((raw_temp - calib_coeffs->ac6) * calib_coeffs->ac5) >> 15;
     int32_t X2 = (calib_coeffs->mc << 11) / (X1 + calib_coeffs->md);
     int32_t B5 = X1 + X2;
     calib_coeffs->b5 = B5;
-    return ((B5 + 8) >> 4) / 10;
+    bmp180->temp_dc = (B5 + 8) >> 4;
+    return bmp180->temp_dc / 10.0f;
 }
 
 /*
- * Get refined pressure value in Pa
+ * Refined pressure value in Pa
 */
-static int32_t bmp180_get_pressure(bmp180_calib_coeffs_t *calib_coeffs) {
-    int32_t raw_pressure = bmp180_get_raw_pressure();
+static int32_t bmp180_compensate_pressure(bmp180_t *bmp180, int32_t raw_pressure) {
+    bmp180_calib_coeffs_t *calib_coeffs = &bmp180->calib;
+    uint8_t oss = bmp180->oss;
 
     // Magical conversion maths found in datasheet
     int32_t B6 = calib_coeffs->b5 - 4000;
     int32_t X1 = (calib_coeffs->b2 * ((B6 * B6) >> 12)) >> 11;
     int32_t X2 = (calib_coeffs->ac2 * B6) >> 11;
     int32_t X3 = X1 + X2;
-    int32_t B3 = (((calib_coeffs->ac1 * 4 + X3) << OSS) + 2) / 4;
+    int32_t B3 = (((calib_coeffs->ac1 * 4 + X3) << oss) + 2) / 4;
     X1 = (calib_coeffs->ac3 * B6) >> 13;
     X2 = (calib_coeffs->b1 * ((B6 * B6) >> 12)) >> 16;
     X3 = ((X1 + X2) + 2) >> 2;
     uint32_t B4 = (calib_coeffs->ac4 * (uint32_t)(X3 + 32768)) >> 15;
-    uint32_t B7 = ((uint32_t)(raw_pressure) - B3) * (50000 >> OSS);
+    uint32_t B7 = ((uint32_t)(raw_pressure) - B3) * (50000 >> oss);
     int32_t pressure = 0;
     if (B7 < 0x80000000) {
         pressure = (B7 * 2) / B4;
@@ -184,53 +196,104 @@ static int32_t bmp180_get_pressure(bmp180_calib_coeffs_t *calib_coeffs) {
 }
 
 /*
-    Get the altitude in metres
+    Initialise the BMP180 peripheral and cache its calibration
 */
-static float bmp180_get_altitude(bmp180_calib_coeffs_t *calib_coeffs) {
-    float pressure = bmp180_get_pressure(calib_coeffs) / 100; // hPa
-    const float P0 = 1013.25; // Pressure are sea-level in hPa
-
-    // Maths found in datasheet
-    return 44330 * (1 - pow((pressure)/P0, 1/5.255));
+int bmp180_init(bmp180_t *bmp180, i2c_inst_t *i2c) {
+    bmp180->i2c = i2c;
+    bmp180->oss = BMP180_OSS_ULTRA_LOW_POWER;
+    bmp180->oss_next = BMP180_OSS_ULTRA_LOW_POWER;
+    bmp180->temp_every = DEFAULT_TEMP_EVERY;
+    bmp180->since_temp = DEFAULT_TEMP_EVERY;
+    bmp180->state = BMP180_IDLE;
+    bmp180->temp = 0;
+    bmp180->temp_dc = 0;
+    bmp180->pressure_pa = 0;
+    bmp180->altitude_cm = 0;
 
-} 
-
-/*
-    Initialise and get data from the BMP180 peripheral
-*/
-int bmp180_init() {
-    
     // Write to and read from chip id register
     // Used to test communication is functioning
     uint8_t chipID[1];
-    i2c_write_blocking(I2C_PORT, BMP180_ADDR, &ID_REG, 1, true);
-    i2c_read_blocking(I2C_PORT, BMP180_ADDR, chipID, 1, false);
+    i2c_write_blocking(bmp180->i2c, BMP180_ADDR, &ID_REG, 1, true);
+    i2c_read_blocking(bmp180->i2c, BMP180_ADDR, chipID, 1, false);
     if (chipID[0] != CHIP_ID) {
         return 0;
-    } else {
-        return 1;
     }
+
+    // Read and validate the calibration coefficients once
+    return bmp180_get_cal_param(bmp180);
 }
 
 /*
-    Return all data from BMP180 sensor
+    Set the pressure oversampling and how many pressure samples to take
+    per temperature refresh. Takes effect from the next conversion, one
+    already running is still read back with the oversampling it started
+    with.
 */
-Barometer read_barometer() {
-    
-    // Get calibration coefficients
-    bmp180_calib_coeffs_t bmp180_coeffs;
-    bmp180_get_cal_param(&bmp180_coeffs);
-
-    Barometer baro = {
-        // Get temperature degrees C
-        (float)bmp180_get_temp(&bmp180_coeffs),
-  
-        // Get pressure in hPa
-        (float)(bmp180_get_pressure(&bmp180_coeffs) / 100),
-
-        // Get Altitude in m
-        (float)bmp180_get_altitude(&bmp180_coeffs)
-    };
+void bmp180_configure(bmp180_t *bmp180, bmp180_oss_t oss, uint8_t temp_every) {
+    bmp180->oss_next = oss & 0b11;
+    bmp180->temp_every = temp_every;
+}
+
+/*
+    Advance the conversion state machine, never blocks
+
+    Collects a finished conversion and immediately starts the next one so
+    the BMP180 is always converting between calls. Returns 1 and fills
+    baro when a new pressure sample completes, 0 otherwise.
+*/
+int bmp180_poll(bmp180_t *bmp180, Barometer *baro) {
+    if (bmp180->state == BMP180_IDLE) {
+        bmp180_start_next(bmp180);
+        return 0;
+    }
+
+    if (time_us_64() < bmp180->ready_us) {
+        return 0;
+    }
+
+    if (bmp180->state == BMP180_CONVERTING_TEMP) {
+        bmp180->temp = bmp180_compensate_temp(bmp180, bmp180_read_raw_temp(bmp180));
+        bmp180->since_temp = 0;
+        bmp180_start(bmp180, BMP180_CONVERTING_PRESSURE);
+        return 0;
+    }
+
+    int32_t pressure = bmp180_compensate_pressure(bmp180, bmp180_read_raw_pressure(bmp180));
+    bmp180->pressure_pa = pressure;
+    bmp180->altitude_cm = altitude_cm(pressure);
+    bmp180->sample_us = bmp180->ready_us;
+    bmp180->since_temp++;
+    bmp180_start_next(bmp180);
+
+    // Temp C, Pressure hPa, Altitude m
+    baro->temp     = bmp180->temp;
+    baro->pressure = pressure / 100.0f;
+    baro->altitude = bmp180->altitude_cm / 100.0f;
+    baro->timestamp_us = bmp180->sample_us;
+    return 1;
+}
+
+/*
+    Time for one pressure conversion at the configured oversampling, the
+    fastest the samples can come
+*/
+uint32_t bmp180_sample_period_us(const bmp180_t *bmp180) {
+    return PRESSURE_CONVERSION_US[bmp180->oss_next];
+}
+
+/*
+    Return all data from BMP180 sensor, waiting for a fresh sample
+    Blocks for up to a temperature plus a pressure conversion
+*/
+Barometer read_barometer(bmp180_t *bmp180) {
+    Barometer baro;
+
+    while (!bmp180_poll(bmp180, &baro)) {
+        uint64_t now = time_us_64();
+        if (bmp180->ready_us > now) {
+            sleep_us(bmp180->ready_us - now);
+        }
+    }
 
     return baro;
-}
\ No newline at end of file
+}
@@ -1,14 +1,62 @@
 #ifndef BMP180_H
 #define BMP180_H
 
-// Temp, Pressure and Altitude
-typedef struct barometer {
-    float temp;
-    float pressure;
-    float altitude;
-} Barometer;
-
-int bmp180_init();
-Barometer read_barometer();
+#include "hardware/i2c.h"
+#include "sensor.h"
+
+// Calibration Coefficients from EEPROM
+typedef struct {
+    int16_t ac1;
+    int16_t ac2;
+    int16_t ac3;
+    uint16_t ac4;
+    uint16_t ac5;
+    uint16_t ac6;
+    int16_t b1;
+    int16_t b2;
+    int16_t mb;
+    int16_t mc;
+    int16_t md;
+    int32_t b5;
+} bmp180_calib_coeffs_t;
+
+// Pressure oversampling, more samples is less noise but a longer conversion
+typedef enum {
+    BMP180_OSS_ULTRA_LOW_POWER = 0,  // 4.5 ms
+    BMP180_OSS_STANDARD        = 1,  // 7.5 ms
+    BMP180_OSS_HIGH_RES        = 2,  // 13.5 ms
+    BMP180_OSS_ULTRA_HIGH_RES  = 3   // 25.5 ms
+} bmp180_oss_t;
+
+typedef enum {
+    BMP180_IDLE,
+    BMP180_CONVERTING_TEMP,
+    BMP180_CONVERTING_PRESSURE
+} bmp180_state_t;
+
+// Driver state, the calibration is read once by bmp180_init()
+typedef struct bmp180 {
+    i2c_inst_t *i2c;
+    bmp180_calib_coeffs_t calib;
+
+    // Conversion state machine
+    uint8_t oss;            // of the pressure conversion in flight
+    uint8_t oss_next;       // taken up by the next one
+    uint8_t temp_every;     // pressure samples per temperature refresh
+    uint8_t since_temp;
+    bmp180_state_t state;
+    uint64_t ready_us;      // when the conversion in flight completes
+    float temp;             // last compensated temperature, degrees C
+    int32_t temp_dc;        // the same in 0.1 C
+    int32_t pressure_pa;    // last compensated pressure, Pa
+    int32_t altitude_cm;    // the same as altitude above QNH, cm
+    uint64_t sample_us;     // when that pressure conversion finished
+} bmp180_t;
+
+int bmp180_init(bmp180_t *bmp180, i2c_inst_t *i2c);
+void bmp180_configure(bmp180_t *bmp180, bmp180_oss_t oss, uint8_t temp_every);
+int bmp180_poll(bmp180_t *bmp180, Barometer *baro);
+uint32_t bmp180_sample_period_us(const bmp180_t *bmp180);
+Barometer read_barometer(bmp180_t *bmp180);
 
 #endif
@@ -0,0 +1,176 @@
+#include "gy89.h"
+
+// Samples per FIFO before the watermark flag is raised. The data ready
+// lines fire on every sample, the FIFOs only hold what a late read missed.
+#define FIFO_WATERMARK 16
+
+// FIFO drain buffer, shared as only one stream is read at a time
+static RawXYZ fifo[L3GD20_FIFO_DEPTH > LSM303D_FIFO_DEPTH ? L3GD20_FIFO_DEPTH : LSM303D_FIFO_DEPTH];
+
+// BMP180 driver state, holds the cached calibration
+static bmp180_t bmp180;
+static Barometer baro;
+static bool baro_ready = false;
+
+
+static uint8_t raw_to_samples(sample_type_t type, const RawXYZ *raw, uint8_t count,
+                              sample_t *samples, uint64_t now_us, uint32_t period_us) {
+    for (uint8_t i = 0; i < count; i++) {
+        samples[i].type = type;
+        samples[i].data[0] = raw[i].x;
+        samples[i].data[1] = raw[i].y;
+        samples[i].data[2] = raw[i].z;
+        samples[i].data[3] = 0;
+    }
+    sensor_stamp_batch(samples, count, now_us, period_us);
+    return count;
+}
+
+
+/*
+ * LSM303D accelerometer, fixed at 50 Hz and read from its FIFO
+ */
+bool gy89_acc_init(const sensor_bus_t *bus) {
+    return init_lsm303d(bus->i2c);
+}
+
+
+uint32_t gy89_acc_configure(uint32_t rate_hz) {
+    lsm303d_enable_fifo(FIFO_WATERMARK);
+    return LSM303D_SAMPLE_PERIOD_US;
+}
+
+
+void gy89_acc_start() {
+    lsm303d_enable_acc_drdy_interrupt();
+}
+
+
+bool gy89_acc_poll() {
+    return lsm303d_acc_data_ready();
+}
+
+
+uint8_t gy89_acc_read_batch(sample_t *samples, uint8_t max, uint64_t now_us) {
+    if (max > LSM303D_FIFO_DEPTH) max = LSM303D_FIFO_DEPTH;
+
+    uint8_t count = read_acceleration_fifo(fifo, max);
+    return raw_to_samples(SAMPLE_ACC, fifo, count, samples, now_us, LSM303D_SAMPLE_PERIOD_US);
+}
+
+
+/*
+ * LSM303D magnetometer, fixed at 50 Hz, one sample per read
+ * Shares the part with the accelerometer, which has already probed it.
+ */
+bool gy89_mag_init(const sensor_bus_t *bus) {
+    return init_lsm303d(bus->i2c);
+}
+
+
+uint32_t gy89_mag_configure(uint32_t rate_hz) {
+    return LSM303D_SAMPLE_PERIOD_US;
+}
+
+
+void gy89_mag_start() {
+    lsm303d_enable_mag_drdy_interrupt();
+}
+
+
+bool gy89_mag_poll() {
+    return lsm303d_mag_data_ready();
+}
+
+
+uint8_t gy89_mag_read_batch(sample_t *samples, uint8_t max, uint64_t now_us) {
+    if (max == 0) return 0;
+
+    fifo[0] = read_magnetometer_raw();
+    return raw_to_samples(SAMPLE_MAG, fifo, 1, samples, now_us, LSM303D_SAMPLE_PERIOD_US);
+}
+
+
+/*
+ * L3GD20 gyroscope, 95 to 760 Hz, read from its FIFO and interrupting
+ * on every sample
+ * Not at the watermark: the rate controller steps on each gyro read, and
+ * a line firing once per batch would leave it up to 16 samples behind.
+ */
+bool gy89_gyro_init(const sensor_bus_t *bus) {
+    return init_l3gd20(bus->i2c);
+}
+
+
+uint32_t gy89_gyro_configure(uint32_t rate_hz) {
+    l3gd20_odr_t odr = L3GD20_ODR_760HZ;
+    if (rate_hz <= 95)       odr = L3GD20_ODR_95HZ;
+    else if (rate_hz <= 190) odr = L3GD20_ODR_190HZ;
+    else if (rate_hz <= 380) odr = L3GD20_ODR_380HZ;
+
+    l3gd20_set_odr(odr);
+    l3gd20_enable_fifo(FIFO_WATERMARK);
+    return l3gd20_sample_period_us();
+}
+
+
+void gy89_gyro_start() {
+    l3gd20_enable_drdy_interrupt(false);
+}
+
+
+bool gy89_gyro_poll() {
+    return l3gd20_data_ready();
+}
+
+
+uint8_t gy89_gyro_read_batch(sample_t *samples, uint8_t max, uint64_t now_us) {
+    if (max > L3GD20_FIFO_DEPTH) max = L3GD20_FIFO_DEPTH;
+
+    uint8_t count = read_gyroscope_fifo(fifo, max);
+    return raw_to_samples(SAMPLE_GYRO, fifo, count, samples, now_us, l3gd20_sample_period_us());
+}
+
+
+/*
+ * BMP180, converting back to back. Polling advances its conversion state
+ * machine and the finished sample waits for read_batch.
+ */
+bool gy89_baro_init(const sensor_bus_t *bus) {
+    return bmp180_init(&bmp180, bus->i2c);
+}
+
+
+uint32_t gy89_baro_configure(uint32_t rate_hz) {
+    return bmp180_sample_period_us(&bmp180);
+}
+
+
+void gy89_baro_start() {
+    baro_ready = false;
+}
+
+
+bool gy89_baro_poll() {
+    if (!baro_ready) {
+        baro_ready = bmp180_poll(&bmp180, &baro);
+    }
+    return baro_ready;
+}
+
+
+uint8_t gy89_baro_read_batch(sample_t *samples, uint8_t max, uint64_t now_us) {
+    if (max == 0 || !gy89_baro_poll()) return 0;
+
+    // Its conversion time, not when it was collected, which can be a
+    // whole schedule period later
+    samples[0].timestamp_us = bmp180.sample_us;
+    samples[0].type = SAMPLE_BARO;
+    samples[0].data[0] = bmp180.pressure_pa;
+    samples[0].data[1] = bmp180.temp_dc;
+    samples[0].data[2] = bmp180.altitude_cm;
+    samples[0].data[3] = 0;
+
+    baro_ready = false;
+    return 1;
+}
@@ -0,0 +1,50 @@
+#ifndef GY89_H
+#define GY89_H
+
+#include "sensor.h"
+#include "lsm303d.h"
+#include "l3gd20.h"
+#include "bmp180.h"
+
+/*
+ * GY-89 streams for the sensor driver interface, see sensor.h
+ * The LSM303D provides two of them, accel and mag.
+ */
+
+bool gy89_acc_init(const sensor_bus_t *bus);
+uint32_t gy89_acc_configure(uint32_t rate_hz);
+void gy89_acc_start();
+bool gy89_acc_poll();
+uint8_t gy89_acc_read_batch(sample_t *samples, uint8_t max, uint64_t now_us);
+
+static inline q16_t gy89_acc_to_q16(int32_t raw) {
+    return lsm303d_acc_raw_to_q16(raw);
+}
+
+bool gy89_mag_init(const sensor_bus_t *bus);
+uint32_t gy89_mag_configure(uint32_t rate_hz);
+void gy89_mag_start();
+bool gy89_mag_poll();
+uint8_t gy89_mag_read_batch(sample_t *samples, uint8_t max, uint64_t now_us);
+
+static inline q16_t gy89_mag_to_q16(int32_t raw) {
+    return lsm303d_mag_raw_to_q16(raw);
+}
+
+bool gy89_gyro_init(const sensor_bus_t *bus);
+uint32_t gy89_gyro_configure(uint32_t rate_hz);
+void gy89_gyro_start();
+bool gy89_gyro_poll();
+uint8_t gy89_gyro_read_batch(sample_t *samples, uint8_t max, uint64_t now_us);
+
+static inline q16_t gy89_gyro_to_q16(int32_t raw) {
+    return l3gd20_raw_to_rads_q16(raw);
+}
+
+bool gy89_baro_init(const sensor_bus_t *bus);
+uint32_t gy89_baro_configure(uint32_t rate_hz);
+void gy89_baro_start();
+bool gy89_baro_poll();
+uint8_t gy89_baro_read_batch(sample_t *samples, uint8_t max, uint64_t now_us);
+
+#endif
@@ -1,6 +1,6 @@
 #include "l3gd20.h"
 #include "hardware/i2c.h"
-#include "imu.h"
+#include "hardware/timer.h"
 
 
 #define   L3GD20_ID 0b11010100
@@ -34,30 +34,63 @@ static const uint8_t INT1_TSH_ZH = 0x36;
 static const uint8_t INT1_TSH_ZL = 0x37;
 static const uint8_t INT1_DURATION = 0x38;
 
+// CTRL_REG3, what drives the DRDY/INT2 line
+static const uint8_t I2_DRDY = 0b00001000;
+static const uint8_t I2_WTM  = 0b00000100;
+
+// STATUS_REG
+static const uint8_t ZYXDA = 0b00001000;
+
+// CTRL_REG5
+static const uint8_t FIFO_EN = 0b01000000;
+
+// FIFO_CTRL_REG, FM[2:0] in bits 7:5 and the watermark in bits 4:0
+static const uint8_t FIFO_MODE_BYPASS = 0b00000000;
+static const uint8_t FIFO_MODE_STREAM = 0b01000000;
+
+// FIFO_SRC_REG
+static const uint8_t FIFO_SRC_OVRN  = 0b01000000;
+static const uint8_t FIFO_SRC_EMPTY = 0b00100000;
+static const uint8_t FIFO_SRC_FSS   = 0b00011111;
+
+// Sample period at each output data rate, us
+static const uint32_t ODR_PERIOD_US[4] = {
+    10526,  // L3GD20_ODR_95HZ
+    5263,   // L3GD20_ODR_190HZ
+    2632,   // L3GD20_ODR_380HZ
+    1316    // L3GD20_ODR_760HZ
+};
+
+static l3gd20_odr_t current_odr = L3GD20_ODR_95HZ;
+
+// Bus the L3GD20 is on, set by init_l3gd20()
+static i2c_inst_t *i2c;
 
 
 static void write_l3gdq20(uint8_t reg, uint8_t data) {
     uint8_t buf[2] = {reg, data};
-    i2c_write_blocking(I2C_PORT, L3GD20_ADDR, buf, 2, false);
+    i2c_write_blocking(i2c, L3GD20_ADDR, buf, 2, false);
 }
 
 
 static uint8_t read_l3gdq20(uint8_t reg) {
     uint8_t data[1];
-    i2c_write_blocking(I2C_PORT, L3GD20_ADDR, &reg, 1, true);
-    i2c_read_blocking(I2C_PORT, L3GD20_ADDR, &data, 1, false);
+    i2c_write_blocking(i2c, L3GD20_ADDR, &reg, 1, true);
+    i2c_read_blocking(i2c, L3GD20_ADDR, data, 1, false);
     return data[0];
 }
 
 
-static uint8_t multi_read_l3gdq20(uint8_t reg, uint8_t *data, uint8_t len) {
+static void multi_read_l3gdq20(uint8_t reg, uint8_t *data, uint8_t len) {
     reg = reg | 0b10000000;
-    i2c_write_blocking(I2C_PORT, L3GD20_ADDR, &reg, 1, true);
-    i2c_read_blocking(I2C_PORT, L3GD20_ADDR, data, len, false);
+    i2c_write_blocking(i2c, L3GD20_ADDR, &reg, 1, true);
+    i2c_read_blocking(i2c, L3GD20_ADDR, data, len, false);
 }
 
 
-int init_l3gd20() {
+int init_l3gd20(i2c_inst_t *bus) {
+    i2c = bus;
+
     // Check the who am i register
     uint8_t id = read_l3gdq20(WHO_AM_I);
     if (id != L3GD20_ID) {
@@ -68,28 +101,125 @@ int init_l3gd20() {
     write_l3gdq20(CTRL_REG1, 0b00001111); // 95 Hz, 12.5 Hz cut-off, normal mode, XYZ enabled
     write_l3gdq20(CTRL_REG2, 0b00000000); // HPF disabled, 250 dps
     write_l3gdq20(CTRL_REG4, 0b00000000); // 250 dps
+    current_odr = L3GD20_ODR_95HZ;
+
+    return 1;
+}
+
+
+/*
+ * Set the output data rate, keeping the lowest cut-off for each rate
+ */
+void l3gd20_set_odr(l3gd20_odr_t odr) {
+    write_l3gdq20(CTRL_REG1, (odr << 6) | 0b00001111); // normal mode, XYZ enabled
+    current_odr = odr;
+}
+
+
+/*
+ * Time between samples at the configured output data rate
+ */
+uint32_t l3gd20_sample_period_us() {
+    return ODR_PERIOD_US[current_odr];
+}
+
+
+/*
+ * Run the FIFO in stream mode, it keeps the newest 32 samples and sets
+ * its watermark flag once `watermark` are waiting
+ */
+void l3gd20_enable_fifo(uint8_t watermark) {
+    // Passing through bypass empties the FIFO
+    write_l3gdq20(FIFO_CTRL_REG, FIFO_MODE_BYPASS);
+    write_l3gdq20(CTRL_REG5, FIFO_EN);
+    write_l3gdq20(FIFO_CTRL_REG, FIFO_MODE_STREAM | (watermark & FIFO_SRC_FSS));
+}
+
+
+/*
+ * Drive DRDY/INT2 from new data, or from the FIFO watermark when the
+ * FIFO is running so the line only fires once per batch
+ */
+void l3gd20_enable_drdy_interrupt(bool watermark) {
+    write_l3gdq20(CTRL_REG3, watermark ? I2_WTM : I2_DRDY);
+}
+
+
+/*
+ * New data status, for polling when the interrupt line is not in use
+ */
+bool l3gd20_data_ready() {
+    return read_l3gdq20(STATUS_REG) & ZYXDA;
+}
+
+
+/*
+ * Number of unread samples in the FIFO
+ */
+uint8_t l3gd20_fifo_level() {
+    uint8_t src = read_l3gdq20(FIFO_SRC_REG);
+
+    if (src & FIFO_SRC_EMPTY) return 0;
+    if (src & FIFO_SRC_OVRN)  return L3GD20_FIFO_DEPTH;
+    return src & FIFO_SRC_FSS;
 }
 
 
 static float raw_to_dps(int16_t raw) {
-    return raw * 0.00875;
+    return q16_to_float(l3gd20_raw_to_q16(raw));
 }
 
 
-Gyroscope read_gyroscope() {
-    int16_t raw_x, raw_y, raw_z;
+static RawXYZ bytes_to_raw(const uint8_t *data) {
+    RawXYZ raw = {
+        (int16_t)((data[1] << 8) | data[0]),
+        (int16_t)((data[3] << 8) | data[2]),
+        (int16_t)((data[5] << 8) | data[4])
+    };
+    return raw;
+}
+
+
+RawXYZ read_gyroscope_raw() {
     uint8_t data[6];
 
     multi_read_l3gdq20(OUT_X_L, data, 6);
-    raw_x = (data[1] << 8) | data[0];
-    raw_y = (data[3] << 8) | data[2];
-    raw_z = (data[5] << 8) | data[4];
+    return bytes_to_raw(data);
+}
+
+
+Gyroscope read_gyroscope() {
+    RawXYZ raw = read_gyroscope_raw();
 
+    // Stamped when the bus read completes
     Gyroscope gyro = {
-        raw_to_dps(raw_x),
-        raw_to_dps(raw_y),
-        raw_to_dps(raw_z)
+        raw_to_dps(raw.x),
+        raw_to_dps(raw.y),
+        raw_to_dps(raw.z),
+        time_us_64()
     };
 
     return gyro;
+}
+
+
+/*
+ * Drain up to max_samples raw samples from the FIFO, oldest first
+ * In FIFO mode the read address rolls back from OUT_Z_H to OUT_X_L, so
+ * every pending sample comes out in a single auto-increment burst.
+ * Returns the number of samples read.
+ */
+uint8_t read_gyroscope_fifo(RawXYZ *samples, uint8_t max_samples) {
+    uint8_t count = l3gd20_fifo_level();
+    if (count > max_samples) count = max_samples;
+    if (count == 0) return 0;
+
+    uint8_t data[L3GD20_FIFO_DEPTH * 6];
+    multi_read_l3gdq20(OUT_X_L, data, count * 6);
+
+    for (uint8_t i = 0; i < count; i++) {
+        samples[i] = bytes_to_raw(&data[i * 6]);
+    }
+
+    return count;
 }
\ No newline at end of file
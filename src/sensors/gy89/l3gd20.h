@@ -1,15 +1,49 @@
 #ifndef L3GD20_H
 #define L3GD20_H
 
-// Gyroscope, Measured in degrees per second
-typedef struct gyroscope {
-    float x;
-    float y;
-    float z;
-} Gyroscope;
+#include <stdbool.h>
+#include <stdint.h>
+#include "hardware/i2c.h"
+#include "raw.h"
+#include "sensor.h"
 
 
-int init_l3gd20();
+#define L3GD20_FIFO_DEPTH 32
+
+// +- 250 dps full scale, 8.75 mdps/LSB, as Q16.16 dps
+#define L3GD20_DPS_SHIFT  6
+#define L3GD20_DPS_SCALE  Q16_SCALE(0.00875, L3GD20_DPS_SHIFT)
+
+static inline q16_t l3gd20_raw_to_q16(int32_t raw) {
+    return q16_from_raw(raw, L3GD20_DPS_SCALE, L3GD20_DPS_SHIFT);
+}
+
+// The same rate as Q16.16 rad/s, for the attitude estimator
+#define L3GD20_RADS_SHIFT 12
+#define L3GD20_RADS_SCALE Q16_SCALE(0.00875 * 3.14159265358979 / 180, L3GD20_RADS_SHIFT)
+
+static inline q16_t l3gd20_raw_to_rads_q16(int32_t raw) {
+    return q16_from_raw(raw, L3GD20_RADS_SCALE, L3GD20_RADS_SHIFT);
+}
+
+// CTRL_REG1 DR[1:0]
+typedef enum {
+    L3GD20_ODR_95HZ  = 0,
+    L3GD20_ODR_190HZ = 1,
+    L3GD20_ODR_380HZ = 2,
+    L3GD20_ODR_760HZ = 3
+} l3gd20_odr_t;
+
+
+int init_l3gd20(i2c_inst_t *bus);
+void l3gd20_set_odr(l3gd20_odr_t odr);
+uint32_t l3gd20_sample_period_us();
+void l3gd20_enable_fifo(uint8_t watermark);
+void l3gd20_enable_drdy_interrupt(bool watermark);
+bool l3gd20_data_ready();
+uint8_t l3gd20_fifo_level();
 Gyroscope read_gyroscope();
+RawXYZ read_gyroscope_raw();
+uint8_t read_gyroscope_fifo(RawXYZ *samples, uint8_t max_samples);
 
 #endif
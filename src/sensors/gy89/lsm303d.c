@@ -1,6 +1,6 @@
 #include "lsm303d.h"
 #include "hardware/i2c.h"
-#include "imu.h"
+#include "hardware/timer.h"
 
 
 #define       LSM303D_ID       0b01001001
@@ -68,18 +68,50 @@ static const uint8_t OUT_Z_H_M      = 0x0D;
 static const uint8_t ACC_XYZ_START  = OUT_X_L_A | 0b10000000;
 static const uint8_t MAG_XYZ_START  = OUT_X_L_M | 0b10000000;
 
+// CTRL3 / CTRL4, what drives the INT1 / INT2 lines
+static const uint8_t P1_DRDYA       = 0b00000100;
+static const uint8_t P2_DRDYM       = 0b00000100;
+
+// STATUS_A / STATUS_M
+static const uint8_t ZYXDA          = 0b00001000;
+
+// CTRL0
+static const uint8_t FIFO_EN        = 0b01000000;
+
+// FIFO_CTRL, FM[2:0] in bits 7:5 and the threshold in bits 4:0
+static const uint8_t FIFO_MODE_BYPASS = 0b00000000;
+static const uint8_t FIFO_MODE_STREAM = 0b01000000;
+
+// FIFO_SRC
+static const uint8_t FIFO_SRC_OVRN  = 0b01000000;
+static const uint8_t FIFO_SRC_EMPTY = 0b00100000;
+static const uint8_t FIFO_SRC_FSS   = 0b00011111;
+
+// Bus the LSM303D is on, set by init_lsm303d()
+static i2c_inst_t *i2c;
+
 
 static void write_lsm303d_reg(uint8_t reg, uint8_t data, bool nostop) {
     uint8_t buf[2] = {reg, data};
-    i2c_write_blocking(I2C_PORT, LSM303D_ADDR, buf, 2, nostop);
+    i2c_write_blocking(i2c, LSM303D_ADDR, buf, 2, nostop);
 }
 
 
-int init_lsm303d() {
+static uint8_t read_lsm303d_reg(uint8_t reg) {
+    uint8_t data[1];
+    i2c_write_blocking(i2c, LSM303D_ADDR, &reg, 1, true);
+    i2c_read_blocking(i2c, LSM303D_ADDR, data, 1, false);
+    return data[0];
+}
+
+
+int init_lsm303d(i2c_inst_t *bus) {
+    i2c = bus;
+
     // Check the who am I register
     uint8_t data[1];
-    i2c_write_blocking(I2C_PORT, LSM303D_ADDR, &WHO_AM_I, 1, true);
-    i2c_read_blocking(I2C_PORT, LSM303D_ADDR, data, 1, false);
+    i2c_write_blocking(i2c, LSM303D_ADDR, &WHO_AM_I, 1, true);
+    i2c_read_blocking(i2c, LSM303D_ADDR, data, 1, false);
 
     if (data[0] != LSM303D_ID) {
         return 0;
@@ -101,53 +133,144 @@ int init_lsm303d() {
 
 
 static float raw_to_ms2(int16_t raw) {
-    // +- 4g range -> 0.122 mg/LSB
-    return raw * 0.122 / 1000 * 9.81;
+    return q16_to_float(lsm303d_acc_raw_to_q16(raw));
 }
 
 
-Accelerometer read_acceleration() {
-    int16_t raw_x, raw_y, raw_z;
+static RawXYZ bytes_to_raw(const uint8_t *buff) {
+    RawXYZ raw = {
+        (int16_t)(buff[1] << 8 | buff[0]),
+        (int16_t)(buff[3] << 8 | buff[2]),
+        (int16_t)(buff[5] << 8 | buff[4])
+    };
+    return raw;
+}
+
+
+RawXYZ read_acceleration_raw() {
     uint8_t buff[6];
 
-    i2c_write_blocking(I2C_PORT, LSM303D_ADDR, &ACC_XYZ_START, 1, true);
-    i2c_read_blocking(I2C_PORT, LSM303D_ADDR, buff, 6, false);
+    i2c_write_blocking(i2c, LSM303D_ADDR, &ACC_XYZ_START, 1, true);
+    i2c_read_blocking(i2c, LSM303D_ADDR, buff, 6, false);
 
-    raw_x = (int16_t)(buff[1] << 8 | buff[0]);
-    raw_y = (int16_t)(buff[3] << 8 | buff[2]);
-    raw_z = (int16_t)(buff[5] << 8 | buff[4]);
+    return bytes_to_raw(buff);
+}
+
+
+Accelerometer read_acceleration() {
+    RawXYZ raw = read_acceleration_raw();
     
+    // Stamped when the bus read completes, the newest the data can be
     Accelerometer acc = {
-        raw_to_ms2(raw_x),
-        raw_to_ms2(raw_y),
-        raw_to_ms2(raw_z)
+        raw_to_ms2(raw.x),
+        raw_to_ms2(raw.y),
+        raw_to_ms2(raw.z),
+        time_us_64()
     };
 
     return acc;
 }
 
 
+/*
+ * Run the accelerometer FIFO in stream mode, it keeps the newest 32
+ * samples and sets its threshold flag once `watermark` are waiting
+ */
+void lsm303d_enable_fifo(uint8_t watermark) {
+    // Passing through bypass empties the FIFO
+    write_lsm303d_reg(FIFO_CTRL, FIFO_MODE_BYPASS, false);
+    write_lsm303d_reg(CTRL0, FIFO_EN, false);
+    write_lsm303d_reg(FIFO_CTRL, FIFO_MODE_STREAM | (watermark & FIFO_SRC_FSS), false);
+}
+
+
+/*
+ * Accelerometer data ready on INT1
+ */
+void lsm303d_enable_acc_drdy_interrupt() {
+    write_lsm303d_reg(CTRL3, P1_DRDYA, false);
+}
+
+
+/*
+ * Magnetometer data ready on INT2
+ */
+void lsm303d_enable_mag_drdy_interrupt() {
+    write_lsm303d_reg(CTRL4, P2_DRDYM, false);
+}
+
+
+/*
+ * New data status, for polling when the interrupt lines are not in use
+ */
+bool lsm303d_acc_data_ready() {
+    return read_lsm303d_reg(STATUS_A) & ZYXDA;
+}
+
+
+bool lsm303d_mag_data_ready() {
+    return read_lsm303d_reg(STATUS_M) & ZYXDA;
+}
+
+
+/*
+ * Number of unread accelerometer samples in the FIFO
+ */
+uint8_t lsm303d_fifo_level() {
+    uint8_t src = read_lsm303d_reg(FIFO_SRC);
+
+    if (src & FIFO_SRC_EMPTY) return 0;
+    if (src & FIFO_SRC_OVRN)  return LSM303D_FIFO_DEPTH;
+    return src & FIFO_SRC_FSS;
+}
+
+
+/*
+ * Drain up to max_samples raw samples from the accelerometer FIFO, oldest first
+ * In FIFO mode the read address rolls back from OUT_Z_H_A to OUT_X_L_A,
+ * so every pending sample comes out in a single auto-increment burst.
+ * Returns the number of samples read.
+ */
+uint8_t read_acceleration_fifo(RawXYZ *samples, uint8_t max_samples) {
+    uint8_t count = lsm303d_fifo_level();
+    if (count > max_samples) count = max_samples;
+    if (count == 0) return 0;
+
+    uint8_t buff[LSM303D_FIFO_DEPTH * 6];
+    i2c_write_blocking(i2c, LSM303D_ADDR, &ACC_XYZ_START, 1, true);
+    i2c_read_blocking(i2c, LSM303D_ADDR, buff, count * 6, false);
+
+    for (uint8_t i = 0; i < count; i++) {
+        samples[i] = bytes_to_raw(&buff[i * 6]);
+    }
+
+    return count;
+}
+
+
 static float raw_to_gauss(int16_t raw) {
-    // +- 4 gauss range -> 0.16 mg/LSB
-    return raw * 0.16 / 1000;
+    return q16_to_float(lsm303d_mag_raw_to_q16(raw));
 }
 
 
-Magnetometer read_magnetometer() {
-    int16_t raw_x, raw_y, raw_z;
+RawXYZ read_magnetometer_raw() {
     uint8_t buff[6];
 
-    i2c_write_blocking(I2C_PORT, LSM303D_ADDR, &MAG_XYZ_START, 1, true);
-    i2c_read_blocking(I2C_PORT, LSM303D_ADDR, buff, 6, false);
+    i2c_write_blocking(i2c, LSM303D_ADDR, &MAG_XYZ_START, 1, true);
+    i2c_read_blocking(i2c, LSM303D_ADDR, buff, 6, false);
+
+    return bytes_to_raw(buff);
+}
+
 
-    raw_x = (int16_t)(buff[1] << 8 | buff[0]);
-    raw_y = (int16_t)(buff[3] << 8 | buff[2]);
-    raw_z = (int16_t)(buff[5] << 8 | buff[4]);
+Magnetometer read_magnetometer() {
+    RawXYZ raw = read_magnetometer_raw();
     
     Magnetometer mag = {
-        raw_to_gauss(raw_x),
-        raw_to_gauss(raw_y),
-        raw_to_gauss(raw_z)
+        raw_to_gauss(raw.x),
+        raw_to_gauss(raw.y),
+        raw_to_gauss(raw.z),
+        time_us_64()
     };
 
     return mag;
@@ -1,26 +1,47 @@
 #ifndef LSM303D_H
 #define LSM303D_H
 
+#include <stdbool.h>
+#include <stdint.h>
+#include "hardware/i2c.h"
+#include "raw.h"
+#include "sensor.h"
 
-// Acceleration, Measured in m/s2
-typedef struct accelerometer {
-    float x;
-    float y;
-    float z;
-} Accelerometer;
 
+#define LSM303D_FIFO_DEPTH 32
 
-// Magnetometer, Measured in Gauss
-typedef struct magnetometer {
-    float x;
-    float y;
-    float z;
-} Magnetometer;
+// Accel and mag both run at the fixed 50 Hz set by init_lsm303d()
+#define LSM303D_SAMPLE_PERIOD_US 20000
 
+// +- 4 g full scale, 0.122 mg/LSB, as Q16.16 m/s2
+#define LSM303D_ACC_SHIFT  9
+#define LSM303D_ACC_SCALE  Q16_SCALE(0.122e-3 * 9.81, LSM303D_ACC_SHIFT)
 
-int init_lsm303d();
+// +- 4 gauss full scale, 0.16 mgauss/LSB, as Q16.16 gauss
+#define LSM303D_MAG_SHIFT  12
+#define LSM303D_MAG_SCALE  Q16_SCALE(0.16e-3, LSM303D_MAG_SHIFT)
+
+static inline q16_t lsm303d_acc_raw_to_q16(int32_t raw) {
+    return q16_from_raw(raw, LSM303D_ACC_SCALE, LSM303D_ACC_SHIFT);
+}
+
+static inline q16_t lsm303d_mag_raw_to_q16(int32_t raw) {
+    return q16_from_raw(raw, LSM303D_MAG_SCALE, LSM303D_MAG_SHIFT);
+}
+
+
+int init_lsm303d(i2c_inst_t *bus);
+void lsm303d_enable_fifo(uint8_t watermark);
+void lsm303d_enable_acc_drdy_interrupt();
+void lsm303d_enable_mag_drdy_interrupt();
+bool lsm303d_acc_data_ready();
+bool lsm303d_mag_data_ready();
+uint8_t lsm303d_fifo_level();
 Accelerometer read_acceleration();
+RawXYZ read_acceleration_raw();
+uint8_t read_acceleration_fifo(RawXYZ *samples, uint8_t max_samples);
 Magnetometer read_magnetometer();
+RawXYZ read_magnetometer_raw();
 
 
 #endif
\ No newline at end of file
@@ -1,117 +1,644 @@
 #include "imu.h"
 #include <FreeRTOS.h>
+#include <task.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include "pico/stdlib.h"
-#include "hardware/i2c.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include "pico/multicore.h"
 #include "common.h"
-#include "gy89/lsm303d.h"
-#include "gy89/l3gd20.h"
-#include "gy89/bmp180.h"
-
-static void get_aggregated_data(
-    Accelerometer *acc,
-    Magnetometer *mag,
-    Gyroscope *gyro,
-    Barometer *baro,
-    uint16_t display_rate,
-    uint8_t aggregate_count
-);
-
-
-void imu_logger_task() {
-    // Setup Data Gathering
-    uint16_t display_rate = 250;  // ms
-    uint8_t  aggregate_count = 5;
-
-    // Init i2c Communication
-    i2c_init(I2C_PORT, 400000);
-    gpio_set_function(SDA_PIN, GPIO_FUNC_I2C);
-    gpio_set_function(SCL_PIN, GPIO_FUNC_I2C);
-    gpio_pull_up(SDA_PIN);
-    gpio_pull_up(SCL_PIN);
-
-
-    // Initialise + Config the LSM303D
-    while (!init_lsm303d()) {printf("LSM303D Init Failed\n"); task_delay_ms(100);}
-    while (!init_l3gd20())  {printf("L3GD20 Init Failed\n");  task_delay_ms(100);}
-    while (!bmp180_init()) {printf("BMP180 Init Failed\n"); task_delay_ms(100);}
-
-    Accelerometer acc;
-    Magnetometer mag;
-    Gyroscope gyro;
-    Barometer baro;
-
-    // Main Loop
+#include "board.h"
+#include "sensor_schedule.h"
+#include "ahrs.h"
+#include "filter.h"
+#include "calibration.h"
+
+// Data ready lines are delivered as bits on one notification index, a
+// bit per role numbered by its sample type
+#define DRDY_NOTIFY_INDEX 1
+#define DRDY_BIT(type)    (1u << (type))
+#define DRDY_ACC          DRDY_BIT(SAMPLE_ACC)
+#define DRDY_MAG          DRDY_BIT(SAMPLE_MAG)
+#define DRDY_GYRO         DRDY_BIT(SAMPLE_GYRO)
+#define DRDY_BARO         DRDY_BIT(SAMPLE_BARO)
+
+// Roles with a data ready line, the rest are only read when scheduled
+#ifdef BOARD_ACC_DRDY_PIN
+#define ACC_HAS_DRDY      DRDY_ACC
+#else
+#define ACC_HAS_DRDY      0
+#endif
+#ifdef BOARD_MAG_DRDY_PIN
+#define MAG_HAS_DRDY      DRDY_MAG
+#else
+#define MAG_HAS_DRDY      0
+#endif
+#ifdef BOARD_GYRO_DRDY_PIN
+#define GYRO_HAS_DRDY     DRDY_GYRO
+#else
+#define GYRO_HAS_DRDY     0
+#endif
+#ifdef BOARD_BARO_DRDY_PIN
+#define BARO_HAS_DRDY     DRDY_BARO
+#else
+#define BARO_HAS_DRDY     0
+#endif
+#define DRDY_ROLES        (ACC_HAS_DRDY | MAG_HAS_DRDY | GYRO_HAS_DRDY | BARO_HAS_DRDY)
+#if defined(BOARD_ACC_DRDY_PIN) || defined(BOARD_MAG_DRDY_PIN) || \
+    defined(BOARD_GYRO_DRDY_PIN) || defined(BOARD_BARO_DRDY_PIN)
+#define ANY_DRDY_PIN
+#endif
+
+// Filters every gyro and accel sample goes through, in order, at the
+// sample rate the stream was configured to
+static const filter_config_t GYRO_FILTERS[] = {
+    {FILTER_LOWPASS, 30, FILTER_BUTTERWORTH_Q},
+};
+
+static const filter_config_t ACC_FILTERS[] = {
+    {FILTER_PT2, 10, 0},
+};
+
+#define FILTER_COUNT(configs) (sizeof(configs) / sizeof((configs)[0]))
+
+// Gaps between gyro samples longer than this many periods are a restart
+// or lost samples, the attitude steps the nominal period over them
+#define MAX_DT_PERIODS 4
+
+// Batch drain buffer, kept off the task stack
+static sample_t batch[SENSOR_MAX_BATCH];
+
+// Sample period each role was configured to, us
+static uint32_t period_us[SAMPLE_ATTITUDE];
+
+// When each role is read, at its own sample period
+static sensor_schedule_t schedule;
+
+// Task woken by the data ready interrupts
+static TaskHandle_t imu_task_handle = NULL;
+
+// Data ready lines seen by the core1 interrupt and not yet handled
+static volatile uint32_t core1_drdy_pending = 0;
+
+// Timer at the last edge of each data ready line, us
+static volatile uint64_t drdy_us[SAMPLE_ATTITUDE];
+
+// When the next read is expected, the timer's low 32 bits so it can be
+// read from the other core in one go, for imu_idle_us()
+static _Atomic uint32_t next_read_us;
+static _Atomic bool acquiring = false;
+
+// Filter chains built from the tables above
+static filter_chain_t gyro_filter;
+static filter_chain_t acc_filter;
+
+// Attitude, advanced once per gyro sample
+static ahrs_t ahrs;
+
+// Timestamp of the last gyro sample the attitude was advanced to
+static uint64_t last_gyro_us = 0;
+
+// Newest accel and mag counts, fed to the estimator alongside the gyro
+static int32_t latest_acc[3];
+static int32_t latest_mag[3];
+static bool have_acc = false;
+static bool new_mag = false;
+
+// Rings the samples are published into, one per consumer
+static sample_ring_t *consumers[IMU_MAX_CONSUMERS];
+static uint8_t consumer_count = 0;
+
+// Gets the samples as the drivers read them, for the blackbox
+static sample_ring_t *raw_consumer = NULL;
+
+// Run after every gyro read, for the rate controller
+static imu_callback_t volatile gyro_callback = NULL;
+
+
+static uint32_t drdy_bits(uint gpio) {
+#ifdef BOARD_ACC_DRDY_PIN
+    if (gpio == BOARD_ACC_DRDY_PIN)  return DRDY_ACC;
+#endif
+#ifdef BOARD_MAG_DRDY_PIN
+    if (gpio == BOARD_MAG_DRDY_PIN)  return DRDY_MAG;
+#endif
+#ifdef BOARD_GYRO_DRDY_PIN
+    if (gpio == BOARD_GYRO_DRDY_PIN) return DRDY_GYRO;
+#endif
+#ifdef BOARD_BARO_DRDY_PIN
+    if (gpio == BOARD_BARO_DRDY_PIN) return DRDY_BARO;
+#endif
+    return 0;
+}
+
+
+/*
+ * Note the time of a data ready edge, the timer is read in the interrupt
+ * so task or loop latency does not end up in the sample timestamps
+ */
+static void stamp_drdy(uint32_t bits, uint64_t now) {
+    for (uint8_t type = 0; type < SAMPLE_ATTITUDE; type++) {
+        if (bits & DRDY_BIT(type)) drdy_us[type] = now;
+    }
+}
+
+
+/*
+ * GPIO interrupt, forward each data ready line to the IMU task
+ */
+static void drdy_callback(uint gpio, uint32_t events) {
+    uint32_t bits = drdy_bits(gpio);
+    if (bits == 0 || imu_task_handle == NULL) return;
+
+    stamp_drdy(bits, time_us_64());
+
+    BaseType_t woken = pdFALSE;
+    xTaskNotifyIndexedFromISR(imu_task_handle, DRDY_NOTIFY_INDEX, bits, eSetBits, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+
+/*
+ * GPIO interrupt on core1, which has no scheduler to notify
+ * The event wakes the loop if it is already sitting in WFE.
+ */
+static void core1_drdy_callback(uint gpio, uint32_t events) {
+    uint32_t bits = drdy_bits(gpio);
+
+    stamp_drdy(bits, time_us_64());
+    core1_drdy_pending |= bits;
+    __sev();
+}
+
+
+#ifdef ANY_DRDY_PIN
+static void init_drdy_pin(uint pin, gpio_irq_callback_t callback) {
+    gpio_init(pin);
+    gpio_set_dir(pin, GPIO_IN);
+    gpio_pull_down(pin);
+    gpio_set_irq_enabled_with_callback(pin, GPIO_IRQ_EDGE_RISE, true, callback);
+}
+#endif
+
+
+/*
+ * Ask a role whether it has new data, for a scheduled read of a role
+ * whose data ready line should have fired but did not
+ */
+static bool poll_role(uint8_t type) {
+    switch (type) {
+#ifdef BOARD_ACC
+        case SAMPLE_ACC:  return SENSOR_CALL(BOARD_ACC, poll)();
+#endif
+#ifdef BOARD_MAG
+        case SAMPLE_MAG:  return SENSOR_CALL(BOARD_MAG, poll)();
+#endif
+#ifdef BOARD_GYRO
+        case SAMPLE_GYRO: return SENSOR_CALL(BOARD_GYRO, poll)();
+#endif
+#ifdef BOARD_BARO
+        case SAMPLE_BARO: return SENSOR_CALL(BOARD_BARO, poll)();
+#endif
+        default:          return false;
+    }
+}
+
+
+/*
+ * Register a consumer ring, only before acquisition starts
+ * Returns false if there is no room for another consumer.
+ */
+bool imu_add_consumer(sample_ring_t *ring) {
+    if (consumer_count >= IMU_MAX_CONSUMERS) return false;
+
+    sample_ring_init(ring);
+    consumers[consumer_count++] = ring;
+    return true;
+}
+
+
+/*
+ * Ring for every sample before calibration and filtering, only before
+ * acquisition starts
+ */
+void imu_set_raw_consumer(sample_ring_t *ring) {
+    sample_ring_init(ring);
+    raw_consumer = ring;
+}
+
+
+/*
+ * Called from the acquisition context straight after each gyro read has
+ * been published, and on every scheduled gyro release that found nothing
+ * to read, so a gyro going quiet can be noticed
+ */
+void imu_set_gyro_callback(imu_callback_t callback) {
+    gyro_callback = callback;
+}
+
+
+static void publish_raw(uint8_t count) {
+    if (raw_consumer == NULL) return;
+
+    for (uint8_t i = 0; i < count; i++) {
+        sample_ring_push(raw_consumer, &batch[i]);
+    }
+}
+
+
+static void publish(const sample_t *sample) {
+    for (uint8_t i = 0; i < consumer_count; i++) {
+        sample_ring_push(consumers[i], sample);
+    }
+}
+
+
+static void publish_batch(const sample_t *samples, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        publish(&samples[i]);
+    }
+}
+
+
+/*
+ * Build a chain for a stream's sample period, left empty and so passing
+ * samples straight through if a filter does not suit the rate
+ */
+static void init_filter(filter_chain_t *chain, const char *name,
+                        const filter_config_t *configs, uint8_t count, uint32_t sample_period_us) {
+    if (!filter_chain_configure(chain, configs, count, 1e6f / sample_period_us)) {
+        printf("%s filters do not fit %lu us samples, unfiltered\n", name, (unsigned long)sample_period_us);
+        filter_chain_init(chain);
+    }
+}
+
+
+/*
+ * Bring up the bus and every sensor on the board, false if any of them
+ * did not answer. Safe to call again after a failure.
+ */
+static bool init_sensors() {
+    static const sensor_bus_t bus = BOARD_BUS;
+    sensor_bus_init(&bus);
+    sensor_schedule_init(&schedule);
+
+#ifdef BOARD_ACC
+    if (!SENSOR_CALL(BOARD_ACC, init)(&bus))  {printf("Accelerometer Init Failed\n"); return false;}
+    period_us[SAMPLE_ACC] = SENSOR_CALL(BOARD_ACC, configure)(BOARD_ACC_RATE_HZ);
+    sensor_schedule_add(&schedule, SAMPLE_ACC, period_us[SAMPLE_ACC], BOARD_ACC_PHASE_US);
+    init_filter(&acc_filter, "Accelerometer", ACC_FILTERS, FILTER_COUNT(ACC_FILTERS), period_us[SAMPLE_ACC]);
+#endif
+#ifdef BOARD_MAG
+    if (!SENSOR_CALL(BOARD_MAG, init)(&bus))  {printf("Magnetometer Init Failed\n"); return false;}
+    period_us[SAMPLE_MAG] = SENSOR_CALL(BOARD_MAG, configure)(BOARD_MAG_RATE_HZ);
+    sensor_schedule_add(&schedule, SAMPLE_MAG, period_us[SAMPLE_MAG], BOARD_MAG_PHASE_US);
+#endif
+#ifdef BOARD_GYRO
+    if (!SENSOR_CALL(BOARD_GYRO, init)(&bus)) {printf("Gyroscope Init Failed\n"); return false;}
+    period_us[SAMPLE_GYRO] = SENSOR_CALL(BOARD_GYRO, configure)(BOARD_GYRO_RATE_HZ);
+    sensor_schedule_add(&schedule, SAMPLE_GYRO, period_us[SAMPLE_GYRO], BOARD_GYRO_PHASE_US);
+    init_filter(&gyro_filter, "Gyroscope", GYRO_FILTERS, FILTER_COUNT(GYRO_FILTERS), period_us[SAMPLE_GYRO]);
+#endif
+#ifdef BOARD_BARO
+    if (!SENSOR_CALL(BOARD_BARO, init)(&bus)) {printf("Barometer Init Failed\n"); return false;}
+    period_us[SAMPLE_BARO] = SENSOR_CALL(BOARD_BARO, configure)(BOARD_BARO_RATE_HZ);
+    sensor_schedule_add(&schedule, SAMPLE_BARO, period_us[SAMPLE_BARO], BOARD_BARO_PHASE_US);
+#endif
+
+    ahrs_init(&ahrs, AHRS_DEFAULT_KP, AHRS_DEFAULT_KI);
+    return true;
+}
+
+
+/*
+ * Wake on the data ready lines the board has and start every stream
+ * The interrupt is taken on whichever core calls this.
+ */
+static void start_sensors(gpio_irq_callback_t callback) {
+#ifdef BOARD_ACC
+#ifdef BOARD_ACC_DRDY_PIN
+    init_drdy_pin(BOARD_ACC_DRDY_PIN, callback);
+#endif
+    SENSOR_CALL(BOARD_ACC, start)();
+#endif
+#ifdef BOARD_MAG
+#ifdef BOARD_MAG_DRDY_PIN
+    init_drdy_pin(BOARD_MAG_DRDY_PIN, callback);
+#endif
+    SENSOR_CALL(BOARD_MAG, start)();
+#endif
+#ifdef BOARD_GYRO
+#ifdef BOARD_GYRO_DRDY_PIN
+    init_drdy_pin(BOARD_GYRO_DRDY_PIN, callback);
+#endif
+    SENSOR_CALL(BOARD_GYRO, start)();
+#endif
+#ifdef BOARD_BARO
+#ifdef BOARD_BARO_DRDY_PIN
+    init_drdy_pin(BOARD_BARO_DRDY_PIN, callback);
+#endif
+    SENSOR_CALL(BOARD_BARO, start)();
+#endif
+
+    sensor_schedule_start(&schedule, time_us_64());
+    atomic_store(&next_read_us, (uint32_t)time_us_64());
+    atomic_store(&acquiring, true);
+}
+
+
+/*
+ * Correct a batch of raw counts with the sensor's calibration
+ * Fetched once per batch, so a new calibration lands between batches.
+ */
+static void calibrate_batch(uint8_t type, uint8_t count) {
+    const calib_affine_t *t = calibration_get(type);
+    for (uint8_t j = 0; j < count; j++) calib_affine_apply(t, batch[j].data);
+}
+
+
+/*
+ * When the newest sample waiting for a role was taken
+ * A read answering a data ready line gets the time of the edge, moved
+ * on a whole number of sample periods if the read came late enough for
+ * newer samples to land since. Polled reads are stamped as they start.
+ */
+static uint64_t sample_time(uint8_t type, bool drdy) {
+    uint64_t now = time_us_64();
+    if (!drdy) return now;
+
+    uint32_t save = save_and_disable_interrupts();
+    uint64_t edge = drdy_us[type];
+    restore_interrupts(save);
+
+    uint32_t period = period_us[type];
+    if (edge >= now || period == 0) return edge;
+    return edge + (now - edge) / period * period;
+}
+
+
+/*
+ * Time step from the previous gyro sample to this one, the nominal
+ * period across a restart or a gap
+ */
+static uint32_t gyro_dt(uint64_t timestamp_us) {
+    uint32_t period = period_us[SAMPLE_GYRO];
+    uint64_t dt = timestamp_us - last_gyro_us;
+
+    if (last_gyro_us == 0 || timestamp_us <= last_gyro_us || dt > (uint64_t)period * MAX_DT_PERIODS) {
+        dt = period;
+    }
+    last_gyro_us = timestamp_us;
+    return (uint32_t)dt;
+}
+
+
+/*
+ * Read one role and publish what it returns, drdy when it is answering
+ * its data ready line
+ */
+static void read_role(uint8_t type, bool drdy) {
+    uint64_t now = sample_time(type, drdy);
+    uint8_t count;
+
+    switch (type) {
+#ifdef BOARD_ACC
+        case SAMPLE_ACC:
+            // Drain everything the accelerometer collected since last time
+            count = SENSOR_CALL(BOARD_ACC, read_batch)(batch, SENSOR_MAX_BATCH, now);
+            publish_raw(count);
+            calibrate_batch(SAMPLE_ACC, count);
+            for (uint8_t j = 0; j < count; j++) filter_chain_apply(&acc_filter, batch[j].data);
+            publish_batch(batch, count);
+
+            if (count > 0) {
+                for (int i = 0; i < 3; i++) latest_acc[i] = batch[count - 1].data[i];
+                have_acc = true;
+            }
+            break;
+#endif
+
+#ifdef BOARD_MAG
+        case SAMPLE_MAG:
+            count = SENSOR_CALL(BOARD_MAG, read_batch)(batch, SENSOR_MAX_BATCH, now);
+            publish_raw(count);
+            calibrate_batch(SAMPLE_MAG, count);
+            publish_batch(batch, count);
+
+            if (count > 0) {
+                for (int i = 0; i < 3; i++) latest_mag[i] = batch[count - 1].data[i];
+                new_mag = true;
+            }
+            break;
+#endif
+
+#ifdef BOARD_GYRO
+        case SAMPLE_GYRO:
+            count = SENSOR_CALL(BOARD_GYRO, read_batch)(batch, SENSOR_MAX_BATCH, now);
+            publish_raw(count);
+            calibrate_batch(SAMPLE_GYRO, count);
+            for (uint8_t j = 0; j < count; j++) filter_chain_apply(&gyro_filter, batch[j].data);
+            publish_batch(batch, count);
+
+            for (uint8_t j = 0; j < count; j++) {
+                // Full rate attitude update, the mag only on its first
+                // gyro sample after a new reading
+                q16_t rate[3] = {
+                    SENSOR_CALL(BOARD_GYRO, to_q16)(batch[j].data[0]),
+                    SENSOR_CALL(BOARD_GYRO, to_q16)(batch[j].data[1]),
+                    SENSOR_CALL(BOARD_GYRO, to_q16)(batch[j].data[2])
+                };
+                ahrs_update(&ahrs, rate, have_acc ? latest_acc : NULL,
+                            new_mag ? latest_mag : NULL, gyro_dt(batch[j].timestamp_us));
+                new_mag = false;
+            }
+
+            if (count > 0) {
+                sample_t attitude = {
+                    .timestamp_us = batch[count - 1].timestamp_us,
+                    .type = SAMPLE_ATTITUDE,
+                    .data = {ahrs.q[0], ahrs.q[1], ahrs.q[2], ahrs.q[3]}
+                };
+                publish(&attitude);
+            }
+
+            if (gyro_callback != NULL) gyro_callback();
+            break;
+#endif
+
+#ifdef BOARD_BARO
+        case SAMPLE_BARO:
+            // Non-blocking, only some releases complete a conversion
+            count = SENSOR_CALL(BOARD_BARO, read_batch)(batch, SENSOR_MAX_BATCH, now);
+            publish_raw(count);
+            publish_batch(batch, count);
+            break;
+#endif
+    }
+}
+
+
+/*
+ * Earliest of the next scheduled release and the next edge expected on
+ * any data ready line still firing
+ */
+static uint64_t next_read(uint64_t now) {
+    uint64_t next = sensor_schedule_next_us(&schedule);
+
+    for (uint8_t type = 0; type < SAMPLE_ATTITUDE; type++) {
+        if (!(DRDY_ROLES & DRDY_BIT(type))) continue;
+
+        uint32_t save = save_and_disable_interrupts();
+        uint64_t edge = drdy_us[type];
+        restore_interrupts(save);
+
+        // A line quiet for two periods is left to the schedule
+        uint64_t expected = edge + period_us[type];
+        if (edge != 0 && expected + period_us[type] > now && expected < next) next = expected;
+    }
+    return next;
+}
+
+
+/*
+ * Read the roles flagged in `ready` by their data ready lines and the ones
+ * the schedule says are due, shortest period first. A due role with a
+ * data ready line is checked first, as its line should have fired.
+ * No FreeRTOS calls, so it runs the same as a task or bare metal on core1.
+ */
+static void acquire(uint32_t ready) {
+    uint64_t now = time_us_64();
+    sensor_schedule_served(&schedule, ready, now);
+    uint32_t due = sensor_schedule_due(&schedule, now);
+    uint32_t read = 0;
+
+    for (uint8_t i = 0; i < schedule.count; i++) {
+        uint8_t type = schedule.slots[i].type;
+        uint32_t bit = DRDY_BIT(type);
+
+        if ((ready & bit) || ((due & bit) && (!(DRDY_ROLES & bit) || poll_role(type)))) {
+            read_role(type, (ready & bit) != 0);
+            read |= bit;
+        }
+    }
+
+    // Keeps coming every period once the gyro is quiet, which is the only
+    // way the controller on core1 gets to stop the motors
+    if ((due & DRDY_GYRO) && !(read & DRDY_GYRO) && gyro_callback != NULL) gyro_callback();
+
+    atomic_store(&next_read_us, (uint32_t)next_read(time_us_64()));
+}
+
+
+/*
+ * How long until acquisition next expects to touch the bus, us
+ * Work that stops interrupts or parks core1, like a flash write, fits
+ * in between so it does not delay a read or a data ready stamp. Zero
+ * when a read is due, UINT32_MAX when acquisition is not running.
+ */
+uint32_t imu_idle_us() {
+    if (!atomic_load(&acquiring)) return UINT32_MAX;
+
+    int32_t left = (int32_t)(atomic_load(&next_read_us) - (uint32_t)time_us_64());
+    return left > 0 ? (uint32_t)left : 0;
+}
+
+
+/*
+ * Ticks from now until the next scheduled release, rounded up
+ */
+static TickType_t ticks_until_release() {
+    const uint64_t tick_us = 1000000 / configTICK_RATE_HZ;
+    uint64_t release = sensor_schedule_next_us(&schedule);
+    uint64_t now = time_us_64();
+
+    if (release <= now) return 0;
+    if (release == UINT64_MAX) return portMAX_DELAY;
+    return (TickType_t)((release - now + tick_us - 1) / tick_us);
+}
+
+
+/*
+ * Acquisition as a FreeRTOS task
+ * Sleeps until a data ready line fires or the next role is released,
+ * so each role is read at its own rate and not at the fastest one.
+ */
+void imu_task() {
+    while (!init_sensors()) task_delay_ms(100);
+
+    imu_task_handle = xTaskGetCurrentTaskHandle();
+    start_sensors(&drdy_callback);
+
+    while (true) {
+        uint32_t ready = 0;
+        xTaskNotifyWaitIndexed(DRDY_NOTIFY_INDEX, 0, UINT32_MAX, &ready, ticks_until_release());
+        acquire(ready);
+    }
+}
+
+
+/*
+ * Wait in WFE for a data ready line or the next scheduled release
+ */
+static uint32_t core1_wait_drdy() {
+    absolute_time_t timeout = from_us_since_boot(sensor_schedule_next_us(&schedule));
+
     while (true) {
-        get_aggregated_data(&acc, &mag, &gyro, &baro, display_rate, aggregate_count);
-
-        // Display Acc and Mag Data
-        printf("Acc:  (x: %2.2f, y: %2.2f, z: %2.2f)\n", acc.x, acc.y, acc.z);
-        printf("Mag:  (x: %2.2f, y: %2.2f, z: %2.2f)\n", mag.x, mag.y, mag.z);
-        printf("Gyro: (x: %2.2f, y: %2.2f, z: %2.2f)\n", gyro.x, gyro.y, gyro.z);
-        printf("Baro: (Temp: %2.2f, Pressure: %2.2f, Altitude: %2.2f)\n", baro.temp, baro.pressure, baro.altitude);
-        printf("--------------------\n");
+        uint32_t save = save_and_disable_interrupts();
+        uint32_t bits = core1_drdy_pending;
+        core1_drdy_pending = 0;
+        restore_interrupts(save);
+
+        if (bits != 0) return bits;
+        if (best_effort_wfe_or_timeout(timeout)) return 0;
     }
 }
 
 
-static void get_aggregated_data(
-    Accelerometer *acc,
-    Magnetometer *mag,
-    Gyroscope *gyro,
-    Barometer *baro,
-    uint16_t display_rate,
-    uint8_t aggregate_count
-) {
-    // Store the data 
-    float acc_sums[3]  = {0, 0, 0};
-    float mag_sums[3]  = {0, 0, 0};
-    float gyro_sums[3] = {0, 0, 0};
-    float baro_sums[3] = {0, 0, 0};
-
-    uint8_t time_delay = display_rate / aggregate_count;
-
-    // Current It Data
-    Accelerometer curr_acc;
-    Magnetometer  curr_mag;
-    Gyroscope     curr_gyro;
-    Barometer     curr_baro;
-
-    for (uint8_t i = 0; i < aggregate_count; i++) {
-        curr_acc  = read_acceleration();
-        acc_sums[0] += curr_acc.x;
-        acc_sums[1] += curr_acc.y;
-        acc_sums[2] += curr_acc.z;
-
-        curr_mag  = read_magnetometer();
-        mag_sums[0] += curr_mag.x;
-        mag_sums[1] += curr_mag.y;
-        mag_sums[2] += curr_mag.z;
-
-        curr_gyro = read_gyroscope();
-        gyro_sums[0] += curr_gyro.x;
-        gyro_sums[1] += curr_gyro.y;
-        gyro_sums[2] += curr_gyro.z;
-
-        curr_baro = read_barometer();
-        baro_sums[0] += curr_baro.temp;
-        baro_sums[1] += curr_baro.pressure;
-        baro_sums[2] += curr_baro.altitude;
-
-        task_delay_ms(time_delay);
+/*
+ * Acquisition bare metal on core1
+ * Owns the I2C bus and the data ready interrupts outright, so USB and
+ * printf servicing on core0 can no longer delay a sample. Reaches core0
+ * only through the consumer rings.
+ */
+static void core1_main() {
+    // Lets core0 pause this core while it writes to flash
+    multicore_lockout_victim_init();
+
+    while (!init_sensors()) sleep_ms(100);
+
+    start_sensors(&core1_drdy_callback);
+
+    while (true) {
+        acquire(core1_wait_drdy());
     }
+}
+
+
+/*
+ * Start acquisition on core1, instead of creating imu_task
+ * Register the consumers first.
+ */
+void imu_start_core1() {
+    multicore_launch_core1(core1_main);
+}
+
+
+/*
+ * Acquisition driven by the caller instead, for the host replay
+ * Brings the sensors up once, false if they did not answer, then each
+ * imu_poll() reads whatever is due at time_us_64() and returns the time
+ * of the next release.
+ */
+bool imu_start_polled() {
+    if (!init_sensors()) return false;
+
+    start_sensors(NULL);
+    return true;
+}
+
 
-    // Average the data and store in acc, mag, gyro
-    acc->x  = acc_sums[0]  / aggregate_count;
-    acc->y  = acc_sums[1]  / aggregate_count;
-    acc->z  = acc_sums[2]  / aggregate_count;
-    mag->x  = mag_sums[0]  / aggregate_count;
-    mag->y  = mag_sums[1]  / aggregate_count;
-    mag->z  = mag_sums[2]  / aggregate_count;
-    gyro->x = gyro_sums[0] / aggregate_count;
-    gyro->y = gyro_sums[1] / aggregate_count;
-    gyro->z = gyro_sums[2] / aggregate_count;
-    baro->temp = baro_sums[0] / aggregate_count;
-    baro->pressure = baro_sums[1] / aggregate_count;
-    baro->altitude = baro_sums[2] / aggregate_count;
+uint64_t imu_poll() {
+    acquire(0);
+    return sensor_schedule_next_us(&schedule);
 }
@@ -1,10 +1,22 @@
 #ifndef IMU_H
 #define IMU_H
 
-#define I2C_PORT         i2c0
-#define SCL_PIN          20
-#define SDA_PIN          21
+#include <stdbool.h>
+#include "sample_ring.h"
 
-void imu_logger_task();
+// Rings the acquisition task publishes every sample into
+#define IMU_MAX_CONSUMERS 4
 
-#endif
\ No newline at end of file
+typedef void (*imu_callback_t)();
+
+bool imu_add_consumer(sample_ring_t *ring);
+void imu_set_raw_consumer(sample_ring_t *ring);
+void imu_set_gyro_callback(imu_callback_t callback);
+void imu_task();
+void imu_start_core1();
+bool imu_start_polled();
+uint64_t imu_poll();
+uint32_t imu_idle_us();
+void imu_logger_task(void *ring);
+
+#endif
@@ -0,0 +1,189 @@
+#include "imu.h"
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdio.h>
+#include "common.h"
+#include "board.h"
+#include "ahrs.h"
+#include "periodic.h"
+#include "console.h"
+
+// How often the ring is emptied, it has to hold everything published
+// in between
+#define LOGGER_POLL_MS 10
+
+// Streams give rad/s, the display is in degrees per second
+#define RAD_TO_DEG 57.29578f
+
+
+/*
+ * Rounded integer mean of accumulated raw counts
+ */
+static int32_t raw_average(int32_t sum, uint16_t count) {
+    return (sum + (sum >= 0 ? count / 2 : -(count / 2))) / count;
+}
+
+
+/*
+ * Mean of the timestamps summed as offsets from the first one, the
+ * middle of the samples that went into an average
+ */
+static uint64_t time_average(uint64_t first_us, uint64_t offset_sum, uint16_t count) {
+    return first_us + (offset_sum + count / 2) / count;
+}
+
+
+/*
+ * Quaternion sample back to the estimator state, for ahrs_attitude()
+ */
+static void attitude_from_sample(ahrs_t *ahrs, const sample_t *sample) {
+    for (int i = 0; i < 4; i++) {
+        ahrs->q[i] = sample->data[i];
+    }
+}
+
+
+/*
+ * Collect every sample published over one display period
+ * Accel and gyro come out of the acquisition filters already smoothed,
+ * so the newest of each is shown. Mag and baro raw counts are summed as
+ * integers and averaged. Everything is scaled to float once at the end,
+ * and any sensor that produced nothing keeps its previous value. Each
+ * reading is stamped with the sample it shows, or the mean time of the
+ * ones it averages.
+ */
+static void get_aggregated_data(
+    sample_ring_t *ring,
+    Accelerometer *acc,
+    Magnetometer *mag,
+    Gyroscope *gyro,
+    Barometer *baro,
+    ahrs_t *ahrs,
+    periodic_t *poll,
+    uint16_t display_rate
+) {
+    int32_t acc_latest[3];
+    int32_t gyro_latest[3];
+    int32_t mag_sums[3]  = {0, 0, 0};
+    int32_t baro_sums[3] = {0, 0, 0};
+    uint16_t acc_count  = 0;
+    uint16_t mag_count  = 0;
+    uint16_t gyro_count = 0;
+    uint16_t baro_count = 0;
+    uint64_t acc_us = 0, gyro_us = 0;
+    uint64_t mag_first_us = 0, baro_first_us = 0;
+    uint64_t mag_offsets = 0, baro_offsets = 0;
+
+    for (uint16_t polls = display_rate / LOGGER_POLL_MS; polls > 0; polls--) {
+        periodic_wait(poll);
+
+        sample_t sample;
+        while (sample_ring_pop(ring, &sample)) {
+            int32_t *sums = NULL;
+            int32_t *latest = NULL;
+            uint64_t *first_us = NULL;
+            uint64_t *offsets = NULL;
+            switch (sample.type) {
+                case SAMPLE_ACC:
+                    latest = acc_latest; acc_us = sample.timestamp_us; acc_count++;
+                    break;
+                case SAMPLE_MAG:
+                    sums = mag_sums; first_us = &mag_first_us; offsets = &mag_offsets;
+                    if (mag_count++ == 0) mag_first_us = sample.timestamp_us;
+                    break;
+                case SAMPLE_GYRO:
+                    latest = gyro_latest; gyro_us = sample.timestamp_us; gyro_count++;
+                    break;
+                case SAMPLE_BARO:
+                    sums = baro_sums; first_us = &baro_first_us; offsets = &baro_offsets;
+                    if (baro_count++ == 0) baro_first_us = sample.timestamp_us;
+                    break;
+                case SAMPLE_ATTITUDE: attitude_from_sample(ahrs, &sample); break;
+            }
+
+            if (offsets != NULL) {
+                *offsets += sample.timestamp_us - *first_us;
+            }
+
+            if (sums != NULL) {
+                sums[0] += sample.data[0];
+                sums[1] += sample.data[1];
+                sums[2] += sample.data[2];
+            }
+            if (latest != NULL) {
+                latest[0] = sample.data[0];
+                latest[1] = sample.data[1];
+                latest[2] = sample.data[2];
+            }
+        }
+    }
+
+    if (acc_count > 0) {
+        acc->x  = q16_to_float(SENSOR_CALL(BOARD_ACC, to_q16)(acc_latest[0]));
+        acc->y  = q16_to_float(SENSOR_CALL(BOARD_ACC, to_q16)(acc_latest[1]));
+        acc->z  = q16_to_float(SENSOR_CALL(BOARD_ACC, to_q16)(acc_latest[2]));
+        acc->timestamp_us = acc_us;
+    }
+    if (mag_count > 0) {
+        mag->x  = q16_to_float(SENSOR_CALL(BOARD_MAG, to_q16)(raw_average(mag_sums[0], mag_count)));
+        mag->y  = q16_to_float(SENSOR_CALL(BOARD_MAG, to_q16)(raw_average(mag_sums[1], mag_count)));
+        mag->z  = q16_to_float(SENSOR_CALL(BOARD_MAG, to_q16)(raw_average(mag_sums[2], mag_count)));
+        mag->timestamp_us = time_average(mag_first_us, mag_offsets, mag_count);
+    }
+    if (gyro_count > 0) {
+        gyro->x = q16_to_float(SENSOR_CALL(BOARD_GYRO, to_q16)(gyro_latest[0])) * RAD_TO_DEG;
+        gyro->y = q16_to_float(SENSOR_CALL(BOARD_GYRO, to_q16)(gyro_latest[1])) * RAD_TO_DEG;
+        gyro->z = q16_to_float(SENSOR_CALL(BOARD_GYRO, to_q16)(gyro_latest[2])) * RAD_TO_DEG;
+        gyro->timestamp_us = gyro_us;
+    }
+    if (baro_count > 0) {
+        // Pa to hPa, 0.1 C to C and cm to m
+        baro->pressure = raw_average(baro_sums[0], baro_count) / 100.0f;
+        baro->temp     = raw_average(baro_sums[1], baro_count) / 10.0f;
+        baro->altitude = raw_average(baro_sums[2], baro_count) / 100.0f;
+        baro->timestamp_us = time_average(baro_first_us, baro_offsets, baro_count);
+    }
+}
+
+
+/*
+ * Consumer of one sample ring, prints averaged readings for a person
+ * Runs at low priority, printf never holds up the acquisition task.
+ */
+void imu_logger_task(void *ring) {
+    // Setup Data Gathering
+    uint16_t display_rate = 250;  // ms
+
+    Accelerometer acc = {0};
+    Magnetometer mag = {0};
+    Gyroscope gyro = {0};
+    Barometer baro = {0};
+    ahrs_t ahrs;
+    ahrs_init(&ahrs, AHRS_DEFAULT_KP, AHRS_DEFAULT_KI);
+
+    static periodic_t poll;
+    periodic_init(&poll, "IMU Logger", LOGGER_POLL_MS);
+
+    // Main Loop
+    while (true) {
+        get_aggregated_data(ring, &acc, &mag, &gyro, &baro, &ahrs, &poll, display_rate);
+
+        // Display Acc and Mag Data
+        console_claim_port();
+        printf("Acc:  (x: %2.2f, y: %2.2f, z: %2.2f) at %.3f s\n", acc.x, acc.y, acc.z, acc.timestamp_us / 1e6);
+        printf("Mag:  (x: %2.2f, y: %2.2f, z: %2.2f) at %.3f s\n", mag.x, mag.y, mag.z, mag.timestamp_us / 1e6);
+        printf("Gyro: (x: %2.2f, y: %2.2f, z: %2.2f) at %.3f s\n", gyro.x, gyro.y, gyro.z, gyro.timestamp_us / 1e6);
+        printf("Baro: (Temp: %2.2f, Pressure: %2.2f, Altitude: %2.2f) at %.3f s\n",
+               baro.temp, baro.pressure, baro.altitude, baro.timestamp_us / 1e6);
+
+        Attitude att = ahrs_attitude(&ahrs);
+        printf("Att:  (roll: %2.2f, pitch: %2.2f, yaw: %2.2f)\n", att.roll, att.pitch, att.yaw);
+
+        uint32_t dropped = sample_ring_dropped(ring);
+        if (dropped > 0) {
+            printf("Dropped: %lu\n", (unsigned long)dropped);
+        }
+        printf("--------------------\n");
+        console_release_port();
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef RAW_H
+#define RAW_H
+
+#include <stdint.h>
+#include "fixed.h"
+
+// Raw sensor counts, straight from the output registers
+typedef struct raw_xyz {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+} RawXYZ;
+
+#endif
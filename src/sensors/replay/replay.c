@@ -0,0 +1,143 @@
+#include "replay.h"
+#include "pico/stdlib.h"
+
+// Accel, mag, gyro and baro, indexed by sample type
+#define REPLAY_TYPES 4
+
+static const sample_t *recording;
+static uint32_t recorded;
+
+// Next sample of each type to hand out, and how many are left
+static uint32_t cursor[REPLAY_TYPES];
+static uint32_t remaining[REPLAY_TYPES];
+
+
+/*
+ * Play back count samples, each type in time order. The samples are
+ * not copied, they must outlive the replay.
+ */
+void replay_load(const sample_t *samples, uint32_t count) {
+    recording = samples;
+    recorded = count;
+
+    for (int type = 0; type < REPLAY_TYPES; type++) {
+        cursor[type] = 0;
+        remaining[type] = 0;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (samples[i].type < REPLAY_TYPES) remaining[samples[i].type]++;
+    }
+}
+
+
+uint64_t replay_first_us() {
+    uint64_t first = UINT64_MAX;
+    for (uint32_t i = 0; i < recorded; i++) {
+        if (recording[i].timestamp_us < first) first = recording[i].timestamp_us;
+    }
+    return first;
+}
+
+
+uint64_t replay_last_us() {
+    uint64_t last = 0;
+    for (uint32_t i = 0; i < recorded; i++) {
+        if (recording[i].timestamp_us > last) last = recording[i].timestamp_us;
+    }
+    return last;
+}
+
+
+bool replay_done() {
+    for (int type = 0; type < REPLAY_TYPES; type++) {
+        if (remaining[type] > 0) return false;
+    }
+    return true;
+}
+
+
+/*
+ * Next sample of a type at or after the cursor, NULL when there are none
+ */
+static const sample_t *peek(uint8_t type) {
+    if (remaining[type] == 0) return NULL;
+
+    while (recording[cursor[type]].type != type) cursor[type]++;
+    return &recording[cursor[type]];
+}
+
+
+/*
+ * Mean interval of a type over the recording, the rate it was sampled at
+ */
+static uint32_t recorded_period(uint8_t type, uint32_t rate_hz) {
+    uint64_t first = 0, last = 0;
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < recorded; i++) {
+        if (recording[i].type != type) continue;
+        if (count++ == 0) first = recording[i].timestamp_us;
+        last = recording[i].timestamp_us;
+    }
+    if (count < 2 || last == first) return 1000000 / rate_hz;
+    return (uint32_t)((last - first) / (count - 1));
+}
+
+
+static bool poll(uint8_t type) {
+    const sample_t *next = peek(type);
+    return next != NULL && next->timestamp_us <= time_us_64();
+}
+
+
+static uint8_t read_batch(uint8_t type, sample_t *samples, uint8_t max, uint64_t now_us) {
+    uint8_t count = 0;
+    const sample_t *next;
+
+    while (count < max && (next = peek(type)) != NULL && next->timestamp_us <= now_us) {
+        samples[count++] = *next;
+        cursor[type]++;
+        remaining[type]--;
+    }
+    return count;
+}
+
+
+bool replay_acc_init(const sensor_bus_t *bus)     { return true; }
+uint32_t replay_acc_configure(uint32_t rate_hz)   { return recorded_period(SAMPLE_ACC, rate_hz); }
+void replay_acc_start()                           {}
+bool replay_acc_poll()                            { return poll(SAMPLE_ACC); }
+
+uint8_t replay_acc_read_batch(sample_t *samples, uint8_t max, uint64_t now_us) {
+    return read_batch(SAMPLE_ACC, samples, max, now_us);
+}
+
+
+bool replay_mag_init(const sensor_bus_t *bus)     { return true; }
+uint32_t replay_mag_configure(uint32_t rate_hz)   { return recorded_period(SAMPLE_MAG, rate_hz); }
+void replay_mag_start()                           {}
+bool replay_mag_poll()                            { return poll(SAMPLE_MAG); }
+
+uint8_t replay_mag_read_batch(sample_t *samples, uint8_t max, uint64_t now_us) {
+    return read_batch(SAMPLE_MAG, samples, max, now_us);
+}
+
+
+bool replay_gyro_init(const sensor_bus_t *bus)    { return true; }
+uint32_t replay_gyro_configure(uint32_t rate_hz)  { return recorded_period(SAMPLE_GYRO, rate_hz); }
+void replay_gyro_start()                          {}
+bool replay_gyro_poll()                           { return poll(SAMPLE_GYRO); }
+
+uint8_t replay_gyro_read_batch(sample_t *samples, uint8_t max, uint64_t now_us) {
+    return read_batch(SAMPLE_GYRO, samples, max, now_us);
+}
+
+
+bool replay_baro_init(const sensor_bus_t *bus)    { return true; }
+uint32_t replay_baro_configure(uint32_t rate_hz)  { return recorded_period(SAMPLE_BARO, rate_hz); }
+void replay_baro_start()                          {}
+bool replay_baro_poll()                           { return poll(SAMPLE_BARO); }
+
+uint8_t replay_baro_read_batch(sample_t *samples, uint8_t max, uint64_t now_us) {
+    return read_batch(SAMPLE_BARO, samples, max, now_us);
+}
@@ -0,0 +1,59 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "sensor.h"
+#include "gy89/gy89.h"
+
+/*
+ * Recorded samples played back as the board's sensors, for the host
+ * replay (UAV_BOARD_REPLAY)
+ *
+ * Each stream hands out the recorded samples of its type once the clock
+ * passes them, with the timestamps they were recorded at, so everything
+ * from acquisition up runs as it did live, only in virtual time. The
+ * samples are raw counts as the blackbox logs them, from the GY-89,
+ * whose scales the streams convert with.
+ */
+
+void replay_load(const sample_t *samples, uint32_t count);
+uint64_t replay_first_us();
+uint64_t replay_last_us();
+bool replay_done();
+
+bool replay_acc_init(const sensor_bus_t *bus);
+uint32_t replay_acc_configure(uint32_t rate_hz);
+void replay_acc_start();
+bool replay_acc_poll();
+uint8_t replay_acc_read_batch(sample_t *samples, uint8_t max, uint64_t now_us);
+
+static inline q16_t replay_acc_to_q16(int32_t raw) {
+    return gy89_acc_to_q16(raw);
+}
+
+bool replay_mag_init(const sensor_bus_t *bus);
+uint32_t replay_mag_configure(uint32_t rate_hz);
+void replay_mag_start();
+bool replay_mag_poll();
+uint8_t replay_mag_read_batch(sample_t *samples, uint8_t max, uint64_t now_us);
+
+static inline q16_t replay_mag_to_q16(int32_t raw) {
+    return gy89_mag_to_q16(raw);
+}
+
+bool replay_gyro_init(const sensor_bus_t *bus);
+uint32_t replay_gyro_configure(uint32_t rate_hz);
+void replay_gyro_start();
+bool replay_gyro_poll();
+uint8_t replay_gyro_read_batch(sample_t *samples, uint8_t max, uint64_t now_us);
+
+static inline q16_t replay_gyro_to_q16(int32_t raw) {
+    return gy89_gyro_to_q16(raw);
+}
+
+bool replay_baro_init(const sensor_bus_t *bus);
+uint32_t replay_baro_configure(uint32_t rate_hz);
+void replay_baro_start();
+bool replay_baro_poll();
+uint8_t replay_baro_read_batch(sample_t *samples, uint8_t max, uint64_t now_us);
+
+#endif
@@ -0,0 +1,66 @@
+#include "sample_ring.h"
+
+#define SAMPLE_RING_MASK (SAMPLE_RING_CAPACITY - 1)
+
+_Static_assert((SAMPLE_RING_CAPACITY & SAMPLE_RING_MASK) == 0,
+               "SAMPLE_RING_CAPACITY must be a power of two");
+
+
+void sample_ring_init(sample_ring_t *ring) {
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->dropped, 0);
+}
+
+
+/*
+ * Copy a sample in, returns false and counts a drop if the ring is full
+ * The slot is written before head is released, so the consumer never
+ * sees a half written sample.
+ */
+bool sample_ring_push(sample_ring_t *ring, const sample_t *sample) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if (head - tail >= SAMPLE_RING_CAPACITY) {
+        // Only the producer writes it, and the M0+ has no atomic add
+        uint32_t dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+        atomic_store_explicit(&ring->dropped, dropped + 1, memory_order_relaxed);
+        return false;
+    }
+
+    ring->slots[head & SAMPLE_RING_MASK] = *sample;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return true;
+}
+
+
+/*
+ * Copy the oldest sample out, returns false if the ring is empty
+ * tail is only released once the copy is done, so the producer cannot
+ * reuse the slot underneath it.
+ */
+bool sample_ring_pop(sample_ring_t *ring, sample_t *sample) {
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    if (head == tail) {
+        return false;
+    }
+
+    *sample = ring->slots[tail & SAMPLE_RING_MASK];
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+
+uint32_t sample_ring_count(sample_ring_t *ring) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    return head - tail;
+}
+
+
+uint32_t sample_ring_dropped(sample_ring_t *ring) {
+    return atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+}
@@ -0,0 +1,54 @@
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Lock free single producer, single consumer ring of timestamped samples
+ *
+ * The acquisition task owns head and the consumer owns tail, each side
+ * only ever writes its own index, so neither needs a mutex or a critical
+ * section. The acquire/release ordering on the indices makes it safe
+ * between the two RP2040 cores as well as between tasks. A full ring
+ * drops the new sample rather than ever blocking the producer.
+ *
+ * For more than one consumer give each its own ring.
+ */
+
+// Power of two so the free running indices wrap with a mask
+#define SAMPLE_RING_CAPACITY 128
+
+typedef enum {
+    SAMPLE_ACC,         // raw counts
+    SAMPLE_MAG,         // raw counts
+    SAMPLE_GYRO,        // raw counts
+    SAMPLE_BARO,        // pressure Pa, temperature 0.1 C, altitude cm
+    SAMPLE_ATTITUDE     // quaternion, Q2.30
+} sample_type_t;
+
+typedef struct sample {
+    uint64_t timestamp_us;
+    uint8_t type;
+    int32_t data[4];
+} sample_t;
+
+typedef struct sample_ring {
+    sample_t slots[SAMPLE_RING_CAPACITY];
+    _Atomic uint32_t head;      // next slot to write, producer only
+    _Atomic uint32_t tail;      // next slot to read, consumer only
+    _Atomic uint32_t dropped;   // samples lost to a full ring, producer only
+} sample_ring_t;
+
+void sample_ring_init(sample_ring_t *ring);
+
+// Producer side
+bool sample_ring_push(sample_ring_t *ring, const sample_t *sample);
+
+// Consumer side
+bool sample_ring_pop(sample_ring_t *ring, sample_t *sample);
+uint32_t sample_ring_count(sample_ring_t *ring);
+uint32_t sample_ring_dropped(sample_ring_t *ring);
+
+#endif
@@ -0,0 +1,14 @@
+#include "sensor.h"
+#include "hardware/gpio.h"
+
+
+/*
+ * Bring up the bus shared by a board's sensors
+ */
+void sensor_bus_init(const sensor_bus_t *bus) {
+    i2c_init(bus->i2c, bus->baudrate);
+    gpio_set_function(bus->sda_pin, GPIO_FUNC_I2C);
+    gpio_set_function(bus->scl_pin, GPIO_FUNC_I2C);
+    gpio_pull_up(bus->sda_pin);
+    gpio_pull_up(bus->scl_pin);
+}
@@ -0,0 +1,100 @@
+#ifndef SENSOR_H
+#define SENSOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico.h"
+#include "hardware/i2c.h"
+#include "fixed.h"
+#include "sample_ring.h"
+
+/*
+ * Sensor driver interface
+ *
+ * A driver provides one stream per quantity it measures. A stream is a
+ * set of functions named <stream>_<operation>:
+ *
+ *   bool     <s>_init(const sensor_bus_t *bus)
+ *            Probe and reset the part, false if it did not answer.
+ *   uint32_t <s>_configure(uint32_t rate_hz)
+ *            Pick the nearest output rate at or above rate_hz and
+ *            return the sample period it gives, us.
+ *   void     <s>_start()
+ *            Begin sampling and drive its data ready line, if it has one,
+ *            once per sample period. The schedule polls a role whose
+ *            line has been quiet for one and a half periods.
+ *   bool     <s>_poll()
+ *            New data waiting. Used when no data ready line is wired,
+ *            or it went quiet.
+ *   uint8_t  <s>_read_batch(sample_t *samples, uint8_t max, uint64_t now_us)
+ *            Read everything waiting, oldest first, up to max samples.
+ *            now_us is when the newest one was taken, the data ready
+ *            edge when the read answers one.
+ *   q16_t    <s>_to_q16(int32_t raw)
+ *            Counts to m/s2, gauss or rad/s. Only the 3 axis streams.
+ *
+ * board.h binds each sensor role to a stream, and callers reach it
+ * through SENSOR_CALL(), which pastes the names together. Every call is
+ * a direct call the compiler can inline, there is no dispatch table.
+ */
+
+#define SENSOR_PASTE(stream, op) stream##_##op
+#define SENSOR_CALL(stream, op)  SENSOR_PASTE(stream, op)
+
+// Largest batch any stream returns, the deepest FIFO
+#define SENSOR_MAX_BATCH 32
+
+typedef struct sensor_bus {
+    i2c_inst_t *i2c;
+    uint sda_pin;
+    uint scl_pin;
+    uint baudrate;
+} sensor_bus_t;
+
+// Acceleration, Measured in m/s2
+typedef struct accelerometer {
+    float x;
+    float y;
+    float z;
+    uint64_t timestamp_us;  // sampled at, us since boot
+} Accelerometer;
+
+// Magnetometer, Measured in Gauss
+typedef struct magnetometer {
+    float x;
+    float y;
+    float z;
+    uint64_t timestamp_us;
+} Magnetometer;
+
+// Gyroscope, Measured in degrees per second
+typedef struct gyroscope {
+    float x;
+    float y;
+    float z;
+    uint64_t timestamp_us;
+} Gyroscope;
+
+// Temp, Pressure and Altitude
+typedef struct barometer {
+    float temp;
+    float pressure;
+    float altitude;
+    uint64_t timestamp_us;
+} Barometer;
+
+void sensor_bus_init(const sensor_bus_t *bus);
+
+
+/*
+ * Timestamp a batch read from a FIFO. The newest sample was taken at
+ * about now_us and the rest are one sample period apart before it.
+ */
+static inline void sensor_stamp_batch(sample_t *samples, uint8_t count,
+                                      uint64_t now_us, uint32_t period_us) {
+    for (uint8_t i = 0; i < count; i++) {
+        samples[i].timestamp_us = now_us - (uint64_t)(count - 1 - i) * period_us;
+    }
+}
+
+#endif
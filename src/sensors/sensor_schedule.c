@@ -0,0 +1,100 @@
+#include "sensor_schedule.h"
+
+
+void sensor_schedule_init(sensor_schedule_t *schedule) {
+    schedule->count = 0;
+}
+
+
+/*
+ * Add a role, keeping the slots in rate monotonic order
+ * Returns false when the schedule is full or the period is zero.
+ */
+bool sensor_schedule_add(sensor_schedule_t *schedule, uint8_t type, uint32_t period_us, uint32_t phase_us) {
+    if (schedule->count >= SENSOR_SCHEDULE_MAX || period_us == 0) return false;
+
+    // Insertion sort, equal periods keep the order they were added in
+    uint8_t i = schedule->count;
+    while (i > 0 && schedule->slots[i - 1].period_us > period_us) {
+        schedule->slots[i] = schedule->slots[i - 1];
+        i--;
+    }
+
+    sensor_slot_t *slot = &schedule->slots[i];
+    slot->type = type;
+    slot->period_us = period_us;
+    slot->phase_us = phase_us % period_us;
+    slot->release_us = 0;
+    slot->releases = 0;
+    slot->skipped = 0;
+    schedule->count++;
+    return true;
+}
+
+
+/*
+ * Lay the first release of every role at its phase from now
+ */
+void sensor_schedule_start(sensor_schedule_t *schedule, uint64_t now_us) {
+    for (uint8_t i = 0; i < schedule->count; i++) {
+        schedule->slots[i].release_us = now_us + schedule->slots[i].phase_us;
+    }
+}
+
+
+/*
+ * Roles in mask were read on their data ready line
+ * Their next release is half a period after the line should fire again,
+ * so it only comes due if the line goes quiet. That holds for a line
+ * that fires every sample period, a stream interrupting once per batch
+ * would be polled before its line ever fired.
+ */
+void sensor_schedule_served(sensor_schedule_t *schedule, uint32_t mask, uint64_t now_us) {
+    for (uint8_t i = 0; i < schedule->count; i++) {
+        sensor_slot_t *slot = &schedule->slots[i];
+        if (mask & (1u << slot->type)) {
+            slot->release_us = now_us + slot->period_us + slot->period_us / 2;
+        }
+    }
+}
+
+
+/*
+ * Mask of the roles due at now_us, each moved on to its next release
+ * Releases step a whole period from the last one, on the phase grid
+ * until served() moves a role onto its data ready line instead. A loop
+ * that ran more than a period late drops the ones it missed rather than
+ * reading back to back.
+ */
+uint32_t sensor_schedule_due(sensor_schedule_t *schedule, uint64_t now_us) {
+    uint32_t due = 0;
+
+    for (uint8_t i = 0; i < schedule->count; i++) {
+        sensor_slot_t *slot = &schedule->slots[i];
+        if (slot->release_us > now_us) continue;
+
+        due |= 1u << slot->type;
+        slot->releases++;
+        slot->release_us += slot->period_us;
+
+        if (slot->release_us <= now_us) {
+            uint32_t missed = (uint32_t)((now_us - slot->release_us) / slot->period_us) + 1;
+            slot->skipped += missed;
+            slot->release_us += (uint64_t)missed * slot->period_us;
+        }
+    }
+    return due;
+}
+
+
+/*
+ * Earliest release of any role, UINT64_MAX when there are none
+ */
+uint64_t sensor_schedule_next_us(const sensor_schedule_t *schedule) {
+    uint64_t next = UINT64_MAX;
+
+    for (uint8_t i = 0; i < schedule->count; i++) {
+        if (schedule->slots[i].release_us < next) next = schedule->slots[i].release_us;
+    }
+    return next;
+}
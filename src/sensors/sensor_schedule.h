@@ -0,0 +1,42 @@
+#ifndef SENSOR_SCHEDULE_H
+#define SENSOR_SCHEDULE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Rate monotonic acquisition schedule
+ *
+ * Each sensor role is released once per its own period, offset by its
+ * phase, so a slow part is not read at the rate of a fast one and roles
+ * with related rates do not all land on the bus at once. Slots are kept
+ * shortest period first, the order roles due together are served in.
+ * Roles are named by their sample type and returned as 1 << type masks.
+ *
+ * Pure bookkeeping on the times passed in, no clock or bus access.
+ */
+
+#define SENSOR_SCHEDULE_MAX 8
+
+typedef struct sensor_slot {
+    uint8_t type;           // sample type of the role
+    uint32_t period_us;
+    uint32_t phase_us;
+    uint64_t release_us;    // next time the role is due
+    uint32_t releases;
+    uint32_t skipped;       // releases lost outright as the loop ran late
+} sensor_slot_t;
+
+typedef struct sensor_schedule {
+    sensor_slot_t slots[SENSOR_SCHEDULE_MAX];
+    uint8_t count;
+} sensor_schedule_t;
+
+void sensor_schedule_init(sensor_schedule_t *schedule);
+bool sensor_schedule_add(sensor_schedule_t *schedule, uint8_t type, uint32_t period_us, uint32_t phase_us);
+void sensor_schedule_start(sensor_schedule_t *schedule, uint64_t now_us);
+void sensor_schedule_served(sensor_schedule_t *schedule, uint32_t mask, uint64_t now_us);
+uint32_t sensor_schedule_due(sensor_schedule_t *schedule, uint64_t now_us);
+uint64_t sensor_schedule_next_us(const sensor_schedule_t *schedule);
+
+#endif
@@ -0,0 +1,246 @@
+#include "telemetry.h"
+#include <string.h>
+#include "crc16.h"
+
+_Static_assert(SAMPLE_ACC == TELEMETRY_SAMPLE_ACC &&
+               SAMPLE_MAG == TELEMETRY_SAMPLE_MAG &&
+               SAMPLE_GYRO == TELEMETRY_SAMPLE_GYRO &&
+               SAMPLE_BARO == TELEMETRY_SAMPLE_BARO &&
+               SAMPLE_ATTITUDE == TELEMETRY_SAMPLE_ATTITUDE,
+               "sample_type_t and the telemetry sample types must match");
+
+_Static_assert(TASK_STATS_NAME_LEN == TELEMETRY_TASK_NAME_SIZE &&
+               PERIODIC_NAME_LEN == TELEMETRY_TASK_NAME_SIZE,
+               "task and loop names must fit the telemetry records");
+
+
+static void put_u16(uint8_t *p, uint16_t value) {
+    p[0] = value;
+    p[1] = value >> 8;
+}
+
+
+static void put_u32(uint8_t *p, uint32_t value) {
+    put_u16(p, value);
+    put_u16(p + 2, value >> 16);
+}
+
+
+static void put_u64(uint8_t *p, uint64_t value) {
+    put_u32(p, value);
+    put_u32(p + 4, value >> 32);
+}
+
+
+static uint8_t record_size(uint8_t type) {
+    switch (type) {
+        case SAMPLE_ACC:
+        case SAMPLE_MAG:
+        case SAMPLE_GYRO:     return TELEMETRY_RECORD_RAW_SIZE;
+        case SAMPLE_BARO:     return TELEMETRY_RECORD_BARO_SIZE;
+        case SAMPLE_ATTITUDE: return TELEMETRY_RECORD_QUAT_SIZE;
+        default:              return 0;
+    }
+}
+
+
+static void start_frame(telemetry_encoder_t *encoder) {
+    encoder->length = TELEMETRY_HEADER_SIZE;
+    encoder->records = 0;
+    encoder->base_us = 0;
+}
+
+
+void telemetry_encoder_init(telemetry_encoder_t *encoder) {
+    encoder->sequence = 0;
+    start_frame(encoder);
+}
+
+
+bool telemetry_frame_empty(const telemetry_encoder_t *encoder) {
+    return encoder->records == 0;
+}
+
+
+/*
+ * Room for a record of this size and frame type, starting the frame if
+ * it is empty
+ */
+static bool reserve(telemetry_encoder_t *encoder, uint8_t type, uint8_t size, uint64_t base_us) {
+    if (encoder->records == 0) {
+        encoder->type = type;
+        encoder->base_us = base_us;
+    }
+
+    return encoder->type == type
+        && encoder->length + size <= TELEMETRY_MAX_FRAME
+        && encoder->records < UINT8_MAX;
+}
+
+
+/*
+ * Calibrated counts can run past the sensor's own 16 bits near full
+ * scale, they are pinned to the ends rather than wrapping sign
+ */
+static int16_t saturate_i16(int32_t value) {
+    if (value > INT16_MAX) return INT16_MAX;
+    if (value < INT16_MIN) return INT16_MIN;
+    return (int16_t)value;
+}
+
+
+/*
+ * Append one sample to the frame being built
+ * Returns false if it does not fit, or the frame holds something other
+ * than samples. Finish the frame and add it again. Sample types with no
+ * record format are skipped.
+ */
+bool telemetry_add_sample(telemetry_encoder_t *encoder, const sample_t *sample) {
+    uint8_t size = record_size(sample->type);
+    if (size == 0) return true;
+
+    if (!reserve(encoder, TELEMETRY_FRAME_SAMPLES, size, sample->timestamp_us)) {
+        return false;
+    }
+
+    uint8_t *p = &encoder->frame[encoder->length];
+    p[0] = sample->type;
+    put_u32(p + 1, (uint32_t)(int32_t)(sample->timestamp_us - encoder->base_us));
+    p += TELEMETRY_RECORD_PREFIX;
+
+    if (size == TELEMETRY_RECORD_RAW_SIZE) {
+        for (int i = 0; i < 3; i++) put_u16(p + 2 * i, (uint16_t)saturate_i16(sample->data[i]));
+    } else {
+        int values = (size - TELEMETRY_RECORD_PREFIX) / 4;
+        for (int i = 0; i < values; i++) put_u32(p + 4 * i, (uint32_t)sample->data[i]);
+    }
+
+    encoder->length += size;
+    encoder->records++;
+    return true;
+}
+
+
+/*
+ * Append the stats of one task to the frame being built, the same way as
+ * telemetry_add_sample()
+ */
+bool telemetry_add_task(telemetry_encoder_t *encoder, const task_stats_t *stats, uint64_t now_us) {
+    if (!reserve(encoder, TELEMETRY_FRAME_TASKS, TELEMETRY_RECORD_TASK_SIZE, now_us)) {
+        return false;
+    }
+
+    uint8_t *p = &encoder->frame[encoder->length];
+    p[0] = stats->number;
+    p[1] = stats->priority;
+    memcpy(p + 2, stats->name, TELEMETRY_TASK_NAME_SIZE);
+    p += 2 + TELEMETRY_TASK_NAME_SIZE;
+    put_u16(p, stats->cpu_permille);
+    put_u32(p + 2, stats->switches);
+    put_u32(p + 6, stats->max_run_us);
+    put_u16(p + 10, stats->stack_free);
+
+    encoder->length += TELEMETRY_RECORD_TASK_SIZE;
+    encoder->records++;
+    return true;
+}
+
+
+/*
+ * Append the timing stats of one periodic loop, the same way as
+ * telemetry_add_sample()
+ */
+bool telemetry_add_loop(telemetry_encoder_t *encoder, uint8_t index, const periodic_t *loop, uint64_t now_us) {
+    if (!reserve(encoder, TELEMETRY_FRAME_LOOPS, TELEMETRY_RECORD_LOOP_SIZE, now_us)) {
+        return false;
+    }
+
+    periodic_stats_t stats;
+    periodic_get_stats(loop, &stats);
+
+    uint32_t values[9] = {
+        stats.period_us, stats.iterations, stats.misses,
+        stats.period_p50_us, stats.period_p99_us, stats.period_max_us,
+        stats.exec_p50_us, stats.exec_p99_us, stats.exec_max_us
+    };
+
+    uint8_t *p = &encoder->frame[encoder->length];
+    p[0] = index;
+    memcpy(p + 1, loop->name, TELEMETRY_TASK_NAME_SIZE);
+    p += 1 + TELEMETRY_TASK_NAME_SIZE;
+    for (int i = 0; i < 9; i++) put_u32(p + 4 * i, values[i]);
+
+    encoder->length += TELEMETRY_RECORD_LOOP_SIZE;
+    encoder->records++;
+    return true;
+}
+
+
+/*
+ * Append console text, the same way as telemetry_add_sample(). Each byte
+ * counts as a record, at most TELEMETRY_MAX_TEXT fit a frame.
+ */
+bool telemetry_add_text(telemetry_encoder_t *encoder, const char *text, size_t length, uint64_t now_us) {
+    if (length > TELEMETRY_MAX_TEXT || !reserve(encoder, TELEMETRY_FRAME_TEXT, (uint8_t)length, now_us)) {
+        return false;
+    }
+
+    memcpy(&encoder->frame[encoder->length], text, length);
+    encoder->length += length;
+    encoder->records += length;
+    return true;
+}
+
+
+/*
+ * Close the frame, append the CRC and COBS encode it into out, which
+ * must hold TELEMETRY_MAX_ENCODED bytes. Returns the bytes to send,
+ * including the 0x00 delimiter, or 0 if there was nothing to send.
+ */
+size_t telemetry_finish_frame(telemetry_encoder_t *encoder, uint8_t *out) {
+    if (encoder->records == 0) return 0;
+
+    uint8_t *frame = encoder->frame;
+    frame[0] = encoder->type;
+    put_u16(frame + 1, encoder->sequence);
+    put_u64(frame + 3, encoder->base_us);
+    frame[11] = encoder->records;
+
+    put_u16(frame + encoder->length, crc16(frame, encoder->length));
+
+    size_t length = cobs_encode(frame, encoder->length + TELEMETRY_CRC_SIZE, out);
+    out[length++] = 0x00;
+
+    encoder->sequence++;
+    start_frame(encoder);
+    return length;
+}
+
+
+/*
+ * Consistent overhead byte stuffing, removes every 0x00 from the data so
+ * it can be used as the frame delimiter. Does not write the delimiter.
+ */
+size_t cobs_encode(const uint8_t *data, size_t length, uint8_t *out) {
+    size_t code_at = 0;
+    size_t n = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] == 0) {
+            out[code_at] = code;
+            code_at = n++;
+            code = 1;
+        } else {
+            out[n++] = data[i];
+            if (++code == 0xFF) {
+                out[code_at] = code;
+                code_at = n++;
+                code = 1;
+            }
+        }
+    }
+
+    out[code_at] = code;
+    return n;
+}
@@ -0,0 +1,37 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sample_ring.h"
+#include "task_stats.h"
+#include "periodic.h"
+#include "telemetry_format.h"
+
+/*
+ * Packs samples into framed binary telemetry, see telemetry_format.h
+ * The encoder itself does no I/O so it runs the same on the host.
+ */
+typedef struct telemetry_encoder {
+    uint8_t frame[TELEMETRY_MAX_FRAME + TELEMETRY_CRC_SIZE];
+    uint16_t length;
+    uint8_t type;           // of the frame being built, set by its first record
+    uint8_t records;
+    uint16_t sequence;
+    uint64_t base_us;
+} telemetry_encoder_t;
+
+void telemetry_encoder_init(telemetry_encoder_t *encoder);
+bool telemetry_add_sample(telemetry_encoder_t *encoder, const sample_t *sample);
+bool telemetry_add_task(telemetry_encoder_t *encoder, const task_stats_t *stats, uint64_t now_us);
+bool telemetry_add_loop(telemetry_encoder_t *encoder, uint8_t index, const periodic_t *loop, uint64_t now_us);
+bool telemetry_add_text(telemetry_encoder_t *encoder, const char *text, size_t length, uint64_t now_us);
+size_t telemetry_finish_frame(telemetry_encoder_t *encoder, uint8_t *out);
+bool telemetry_frame_empty(const telemetry_encoder_t *encoder);
+
+size_t cobs_encode(const uint8_t *data, size_t length, uint8_t *out);
+
+void telemetry_task(void *ring);
+
+#endif
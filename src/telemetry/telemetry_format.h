@@ -0,0 +1,84 @@
+#ifndef TELEMETRY_FORMAT_H
+#define TELEMETRY_FORMAT_H
+
+/*
+ * Binary telemetry frame layout, shared by the firmware encoder and the
+ * host decoder in tools/telemetry
+ *
+ * On the wire each frame is COBS encoded and ends in a single 0x00, so a
+ * reader can resync on the next zero after any corruption. Decoded, a
+ * frame is:
+ *
+ *   header   frame type   u8
+ *            sequence     u16, +1 per frame, gaps are lost frames
+ *            base time    u64, us
+ *            records      u8
+ *   records  sample type  u8
+ *            time offset  i32, us from the base time
+ *            data         see TELEMETRY_RECORD_*_SIZE
+ *   crc      u16, CRC-16/CCITT-FALSE over header and records
+ *
+ * All fields are little endian. Samples are sent as the raw fixed point
+ * values from the sample ring, scaling is left to the host.
+ *
+ * Task frames have the same header, the base time is when the stats were
+ * collected. Their records have no type or time offset:
+ *
+ *   task     number       u8
+ *            priority     u8
+ *            name         12 bytes, NUL padded
+ *            cpu          u16, per mille over the period
+ *            switches     u32, over the period
+ *            max run      u32, us, since boot
+ *            stack free   u16, words, low-water since boot
+ *
+ * Loop frames are the same, with one record per periodic loop:
+ *
+ *   loop     index        u8
+ *            name         12 bytes, NUL padded
+ *            period       u32, us, nominal
+ *            iterations   u32, since boot
+ *            misses       u32, deadline misses since boot
+ *            period       u32 x 3, us, p50 p99 max
+ *            execution    u32 x 3, us, p50 p99 max
+ *
+ * Text frames carry the console's replies and prompts. The record count
+ * is the number of bytes of text after the header, with no terminator,
+ * and a line may carry on into the next text frame.
+ */
+
+#define TELEMETRY_FRAME_SAMPLES     1
+#define TELEMETRY_FRAME_TASKS       2
+#define TELEMETRY_FRAME_LOOPS       3
+#define TELEMETRY_FRAME_TEXT        4
+
+#define TELEMETRY_HEADER_SIZE       12
+#define TELEMETRY_CRC_SIZE          2
+
+// Header plus records, before the CRC
+#define TELEMETRY_MAX_FRAME         240
+
+// COBS adds at most two bytes to a frame this size, then the delimiter
+#define TELEMETRY_MAX_ENCODED       (TELEMETRY_MAX_FRAME + TELEMETRY_CRC_SIZE + 3)
+
+// Text in one frame
+#define TELEMETRY_MAX_TEXT          (TELEMETRY_MAX_FRAME - TELEMETRY_HEADER_SIZE)
+
+// Record sizes including the type and time offset
+#define TELEMETRY_RECORD_PREFIX     5
+#define TELEMETRY_RECORD_RAW_SIZE   (TELEMETRY_RECORD_PREFIX + 3 * 2)   // acc, mag, gyro as i16 counts, saturated
+#define TELEMETRY_RECORD_BARO_SIZE  (TELEMETRY_RECORD_PREFIX + 3 * 4)   // Pa, 0.1 C, cm as i32
+#define TELEMETRY_RECORD_QUAT_SIZE  (TELEMETRY_RECORD_PREFIX + 4 * 4)   // Q2.30 quaternion as i32
+
+#define TELEMETRY_TASK_NAME_SIZE    12
+#define TELEMETRY_RECORD_TASK_SIZE  (2 + TELEMETRY_TASK_NAME_SIZE + 2 + 4 + 4 + 2)
+#define TELEMETRY_RECORD_LOOP_SIZE  (1 + TELEMETRY_TASK_NAME_SIZE + 3 * 4 + 6 * 4)
+
+// Sample types, the same values as sample_type_t
+#define TELEMETRY_SAMPLE_ACC        0
+#define TELEMETRY_SAMPLE_MAG        1
+#define TELEMETRY_SAMPLE_GYRO       2
+#define TELEMETRY_SAMPLE_BARO       3
+#define TELEMETRY_SAMPLE_ATTITUDE   4
+
+#endif
@@ -0,0 +1,106 @@
+#include "telemetry.h"
+#include <FreeRTOS.h>
+#include <task.h>
+#include "pico/stdlib.h"
+#include "common.h"
+#include "console.h"
+
+// Frames go out at least this often, more when the ring fills them
+#define TELEMETRY_PERIOD_MS 5
+
+static telemetry_encoder_t encoder;
+static uint8_t encoded[TELEMETRY_MAX_ENCODED];
+
+static task_stats_window_t task_window;
+static task_stats_t tasks[TASK_STATS_MAX_TASKS];
+
+static periodic_t loop;
+
+
+/*
+ * Raw bytes to the USB serial port, without the newline translation
+ * printf does. The port is claimed around each period's frames.
+ */
+static void send(const uint8_t *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        putchar_raw(data[i]);
+    }
+}
+
+
+/*
+ * Send the stats of every task and periodic loop, in as many frames as
+ * it takes
+ */
+static void send_task_stats() {
+    uint8_t count = task_stats_collect(&task_window, tasks, TASK_STATS_MAX_TASKS);
+    uint64_t now = time_us_64();
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (!telemetry_add_task(&encoder, &tasks[i], now)) {
+            send(encoded, telemetry_finish_frame(&encoder, encoded));
+            telemetry_add_task(&encoder, &tasks[i], now);
+        }
+    }
+    send(encoded, telemetry_finish_frame(&encoder, encoded));
+
+    for (uint8_t i = 0; i < periodic_count(); i++) {
+        if (!telemetry_add_loop(&encoder, i, periodic_get(i), now)) {
+            send(encoded, telemetry_finish_frame(&encoder, encoded));
+            telemetry_add_loop(&encoder, i, periodic_get(i), now);
+        }
+    }
+    send(encoded, telemetry_finish_frame(&encoder, encoded));
+}
+
+
+/*
+ * Send whatever the console has printed, a frame at a time
+ */
+static void send_text() {
+    char text[TELEMETRY_MAX_TEXT];
+    size_t length;
+
+    while ((length = console_take_text(text, sizeof(text))) > 0) {
+        if (!telemetry_add_text(&encoder, text, length, time_us_64())) {
+            send(encoded, telemetry_finish_frame(&encoder, encoded));
+            telemetry_add_text(&encoder, text, length, time_us_64());
+        }
+        send(encoded, telemetry_finish_frame(&encoder, encoded));
+    }
+}
+
+
+/*
+ * Consumer of one sample ring, streams every sample as binary frames,
+ * the console text and the task stats every TASK_STATS_PERIOD_MS
+ */
+void telemetry_task(void *ring) {
+    telemetry_encoder_init(&encoder);
+    task_stats_window_init(&task_window);
+    periodic_init(&loop, "Telemetry", TELEMETRY_PERIOD_MS);
+
+    while (true) {
+        periodic_wait(&loop);
+        console_claim_port();
+
+        if (loop.iterations % (TASK_STATS_PERIOD_MS / TELEMETRY_PERIOD_MS) == 0) {
+            send_task_stats();
+        }
+
+        sample_t sample;
+        while (sample_ring_pop(ring, &sample)) {
+            if (!telemetry_add_sample(&encoder, &sample)) {
+                send(encoded, telemetry_finish_frame(&encoder, encoded));
+                telemetry_add_sample(&encoder, &sample);
+            }
+        }
+
+        if (!telemetry_frame_empty(&encoder)) {
+            send(encoded, telemetry_finish_frame(&encoder, encoded));
+        }
+
+        send_text();
+        console_release_port();
+    }
+}
@@ -0,0 +1,110 @@
+/*
+ * Decode the blackbox flight log to CSV
+ *
+ *   blackbox_decode [--stats] <flash image | console dump | ->
+ *
+ * Takes a binary image of the log region or of the whole flash (from
+ * picotool save, or the host build's UAV_FLASH_IMAGE), or a capture of
+ * the serial console after the d command. One line per record:
+ * type,timestamp_us,values... in raw counts, RC records are the pulse
+ * widths in us and lost records the samples dropped before them. --stats
+ * prints a summary to stderr at the end.
+ *
+ * A console capture that is missing lines, has garbled ones or stops
+ * before the dump's end line is reported on stderr, and the exit status
+ * is 1. What could be read is still decoded.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "decoder.h"
+#include "blackbox_format.h"
+
+namespace {
+
+const char *type_name(uint8_t type) {
+    switch (type) {
+        case BLACKBOX_RECORD_ACC:  return "acc";
+        case BLACKBOX_RECORD_MAG:  return "mag";
+        case BLACKBOX_RECORD_GYRO: return "gyro";
+        case BLACKBOX_RECORD_BARO: return "baro";
+        case BLACKBOX_RECORD_RC:   return "rc";
+        case BLACKBOX_RECORD_LOST: return "lost";
+        default:                   return "unknown";
+    }
+}
+
+int usage(const char *name) {
+    fprintf(stderr, "usage: %s [--stats] <flash image | console dump | ->\n", name);
+    return 2;
+}
+
+}  // namespace
+
+
+int main(int argc, char **argv) {
+    bool show_stats = false;
+    const char *path = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--stats") == 0) {
+            show_stats = true;
+        } else if (path == nullptr) {
+            path = argv[i];
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (path == nullptr) return usage(argv[0]);
+
+    int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return 1;
+    }
+
+    std::vector<uint8_t> input;
+    uint8_t buffer[65536];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+        input.insert(input.end(), buffer, buffer + n);
+    }
+
+    // A console capture has the log as hex lines, anything else is taken
+    // as a binary image
+    blackbox::DumpStats dump;
+    std::vector<uint8_t> image = blackbox::read_dump(std::string(input.begin(), input.end()), dump);
+    bool dump_ok = true;
+    if (image.empty()) {
+        image.swap(input);
+    } else if (dump.malformed > 0 || dump.missing > 0 || !dump.ended) {
+        fprintf(stderr, "dump incomplete: %llu lines read, %llu malformed, %llu missing%s\n",
+                (unsigned long long)dump.lines, (unsigned long long)dump.malformed,
+                (unsigned long long)dump.missing, dump.ended ? "" : ", no end line");
+        dump_ok = false;
+    }
+
+    blackbox::Decoder decoder([](const blackbox::Block &block) {
+        for (const auto &record : block.records) {
+            printf("%s,%llu", type_name(record.type), (unsigned long long)record.timestamp_us);
+            for (int i = 0; i < record.count; i++) printf(",%ld", (long)record.values[i]);
+            printf("\n");
+        }
+    });
+    decoder.decode(image);
+
+    if (show_stats) {
+        const blackbox::Stats &stats = decoder.stats();
+        fprintf(stderr, "blocks %llu, records %llu, sessions %llu, crc errors %llu, "
+                        "malformed %llu, lost blocks %llu, lost samples %llu\n",
+                (unsigned long long)stats.blocks, (unsigned long long)stats.records,
+                (unsigned long long)stats.sessions, (unsigned long long)stats.crc_errors,
+                (unsigned long long)stats.malformed, (unsigned long long)stats.lost_blocks,
+                (unsigned long long)stats.lost_samples);
+    }
+    return dump_ok ? 0 : 1;
+}
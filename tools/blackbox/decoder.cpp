@@ -0,0 +1,219 @@
+#include "decoder.h"
+#include <cctype>
+#include <cstring>
+#include <sstream>
+#include "../telemetry/decoder.h"
+
+namespace blackbox {
+
+namespace {
+
+uint16_t get_u16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+uint64_t get_u64(const uint8_t *p) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) value = (value << 8) | p[i];
+    return value;
+}
+
+// LEB128, false if it runs past the end
+bool get_varint(const uint8_t *&p, const uint8_t *end, uint64_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p == end) return false;
+        uint8_t byte = *p++;
+        value |= uint64_t(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+int64_t unzigzag(uint64_t value) {
+    return int64_t(value >> 1) ^ -int64_t(value & 1);
+}
+
+struct Stream {
+    uint64_t last_us;
+    int64_t last_interval_us = 0;
+    uint8_t count = 0;
+    int32_t last[BLACKBOX_MAX_VALUES] = {};
+};
+
+uint8_t value_count(uint8_t type) {
+    switch (type) {
+        case BLACKBOX_RECORD_ACC:
+        case BLACKBOX_RECORD_MAG:
+        case BLACKBOX_RECORD_GYRO:
+        case BLACKBOX_RECORD_BARO: return BLACKBOX_SAMPLE_VALUES;
+        case BLACKBOX_RECORD_LOST: return BLACKBOX_LOST_VALUES;
+        default:                   return 0;
+    }
+}
+
+}  // namespace
+
+
+std::optional<Block> parse_block(const uint8_t *block) {
+    Block out;
+    out.session = get_u16(block + 4);
+    out.sequence = get_u16(block + 6);
+    out.base_us = get_u64(block + 8);
+    uint16_t length = get_u16(block + 16);
+
+    if (block[18] != BLACKBOX_VERSION || BLACKBOX_HEADER_SIZE + length > BLACKBOX_BLOCK_SIZE) {
+        return std::nullopt;
+    }
+
+    // Every stream starts from zero at the base time, as in the encoder
+    Stream streams[BLACKBOX_RECORD_TYPES];
+    for (Stream &stream : streams) stream.last_us = out.base_us;
+
+    const uint8_t *p = block + BLACKBOX_HEADER_SIZE;
+    const uint8_t *end = p + length;
+    while (p < end) {
+        Record record{};
+        uint8_t tag = *p++;
+        record.type = tag & ((1 << BLACKBOX_TAG_TYPE_BITS) - 1);
+        if (record.type >= BLACKBOX_RECORD_TYPES) return std::nullopt;
+        Stream &stream = streams[record.type];
+
+        uint64_t raw = tag >> BLACKBOX_TAG_TYPE_BITS;
+        if (raw == BLACKBOX_TAG_TIME_ESCAPE && !get_varint(p, end, raw)) return std::nullopt;
+        int64_t interval = stream.last_interval_us + unzigzag(raw);
+        record.timestamp_us = stream.last_us + interval;
+
+        record.count = value_count(record.type);
+        if (record.type == BLACKBOX_RECORD_RC) {
+            if (!get_varint(p, end, raw) || raw > BLACKBOX_MAX_VALUES) return std::nullopt;
+            record.count = raw;
+            if (record.count != stream.count) memset(stream.last, 0, sizeof(stream.last));
+        } else if (record.count == 0) {
+            return std::nullopt;
+        }
+
+        for (uint8_t i = 0; i < record.count; i++) {
+            if (!get_varint(p, end, raw)) return std::nullopt;
+            record.values[i] = int32_t(uint32_t(stream.last[i]) + uint32_t(unzigzag(raw)));
+        }
+
+        stream.last_us = record.timestamp_us;
+        stream.last_interval_us = interval;
+        stream.count = record.count;
+        memcpy(stream.last, record.values, sizeof(stream.last));
+        out.records.push_back(record);
+    }
+    return out;
+}
+
+
+namespace {
+
+// A dump line as its bytes, false unless it is a whole one
+bool parse_dump_line(const std::string &line, unsigned long &offset, std::vector<uint8_t> &bytes) {
+    char hex[2 * 256 + 2];
+    int end = 0;
+    if (sscanf(line.c_str(), "bb %lx %513s%n", &offset, hex, &end) != 2) return false;
+    if (line.find_first_not_of(" \r", end) != std::string::npos) return false;
+
+    size_t length = strlen(hex);
+    if (length == 0 || length % 2 != 0 || length > 2 * 256) return false;
+
+    bytes.clear();
+    for (size_t i = 0; i < length; i += 2) {
+        if (!isxdigit((unsigned char)hex[i]) || !isxdigit((unsigned char)hex[i + 1])) return false;
+        bytes.push_back(uint8_t(std::stoi(std::string(hex + i, 2), nullptr, 16)));
+    }
+    return true;
+}
+
+}  // namespace
+
+
+std::vector<uint8_t> read_dump(const std::string &text, DumpStats &stats) {
+    std::vector<uint8_t> image;
+    std::istringstream lines(text);
+    std::string line;
+    std::vector<uint8_t> bytes;
+    unsigned long expected = 0;
+
+    while (std::getline(lines, line)) {
+        // A telemetry frame just before a line ends in a zero byte
+        size_t frame_end = line.rfind('\0');
+        if (frame_end != std::string::npos) line.erase(0, frame_end + 1);
+        if (line.compare(0, 3, "bb ") != 0) continue;
+
+        unsigned long blocks, count;
+        int end = 0;
+        if (sscanf(line.c_str(), "bb end %lu blocks %n", &blocks, &end) == 1 && end > 0) {
+            stats.ended = true;
+            if (sscanf(line.c_str() + end, "%lu lines", &count) == 1) expected = count;
+            continue;
+        }
+
+        unsigned long offset;
+        if (!parse_dump_line(line, offset, bytes)) {
+            stats.malformed++;
+            continue;
+        }
+        stats.lines++;
+
+        if (image.size() < offset + bytes.size()) {
+            image.resize((offset + bytes.size() + BLACKBOX_BLOCK_SIZE - 1) / BLACKBOX_BLOCK_SIZE * BLACKBOX_BLOCK_SIZE, 0xFF);
+        }
+        memcpy(&image[offset], bytes.data(), bytes.size());
+    }
+
+    if (expected > stats.lines) stats.missing = expected - stats.lines;
+    return image;
+}
+
+
+Decoder::Decoder(BlockHandler handler)
+    : handler_(std::move(handler))
+{
+}
+
+
+void Decoder::decode(const std::vector<uint8_t> &image) {
+    for (size_t at = 0; at + BLACKBOX_BLOCK_SIZE <= image.size(); at += BLACKBOX_BLOCK_SIZE) {
+        const uint8_t *block = &image[at];
+        if (get_u16(block) != BLACKBOX_MAGIC) continue;
+
+        uint16_t length = get_u16(block + 16);
+        if (BLACKBOX_HEADER_SIZE + length > BLACKBOX_BLOCK_SIZE) {
+            stats_.malformed++;
+            continue;
+        }
+        uint16_t crc = telemetry::crc16(block + BLACKBOX_CRC_START,
+                                        BLACKBOX_HEADER_SIZE - BLACKBOX_CRC_START + length);
+        if (crc != get_u16(block + 2)) {
+            stats_.crc_errors++;
+            continue;
+        }
+
+        std::optional<Block> parsed = parse_block(block);
+        if (!parsed) {
+            stats_.malformed++;
+            continue;
+        }
+
+        if (last_session_ != parsed->session) {
+            stats_.sessions++;
+        } else if (parsed->sequence != uint16_t(last_sequence_ + 1)) {
+            stats_.lost_blocks += uint16_t(parsed->sequence - last_sequence_ - 1);
+        }
+        last_session_ = parsed->session;
+        last_sequence_ = parsed->sequence;
+
+        stats_.blocks++;
+        stats_.records += parsed->records.size();
+        for (const Record &record : parsed->records) {
+            if (record.type == BLACKBOX_RECORD_LOST) stats_.lost_samples += uint32_t(record.values[0]);
+        }
+        handler_(*parsed);
+    }
+}
+
+}  // namespace blackbox
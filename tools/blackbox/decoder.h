@@ -0,0 +1,77 @@
+#ifndef BLACKBOX_DECODER_H
+#define BLACKBOX_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+#include "blackbox_format.h"
+
+/*
+ * Host side decoder for the firmware's blackbox flight log
+ * The log layout is described in src/blackbox/blackbox_format.h.
+ */
+namespace blackbox {
+
+struct Record {
+    uint8_t type;
+    uint64_t timestamp_us;
+    uint8_t count;          // values used
+    int32_t values[BLACKBOX_MAX_VALUES];
+};
+
+struct Block {
+    uint16_t session;
+    uint16_t sequence;
+    uint64_t base_us;
+    std::vector<Record> records;
+};
+
+struct Stats {
+    uint64_t blocks = 0;
+    uint64_t records = 0;
+    uint64_t sessions = 0;
+    uint64_t crc_errors = 0;
+    uint64_t malformed = 0;
+    uint64_t lost_blocks = 0;   // from gaps in the sequence numbers
+    uint64_t lost_samples = 0;  // dropped on the Pico, from the lost records
+};
+
+// What read_dump() made of the hex lines
+struct DumpStats {
+    uint64_t lines = 0;
+    uint64_t malformed = 0;     // bb lines that are not a data or end line
+    uint64_t missing = 0;       // from the count on the end line
+    bool ended = false;         // the end line was there
+};
+
+// Parse one block of BLACKBOX_BLOCK_SIZE bytes, nullopt if it is
+// malformed. The magic and CRC are checked by the caller.
+std::optional<Block> parse_block(const uint8_t *block);
+
+// Flash contents from the console dump's hex lines, other lines ignored.
+// Empty if there were none.
+std::vector<uint8_t> read_dump(const std::string &text, DumpStats &stats);
+
+class Decoder {
+public:
+    using BlockHandler = std::function<void(const Block &)>;
+
+    explicit Decoder(BlockHandler handler);
+
+    // Every block in a flash image, the log region or all of flash
+    void decode(const std::vector<uint8_t> &image);
+    const Stats &stats() const { return stats_; }
+
+private:
+    BlockHandler handler_;
+    Stats stats_;
+    std::optional<uint16_t> last_session_;
+    uint16_t last_sequence_ = 0;
+};
+
+}  // namespace blackbox
+
+#endif
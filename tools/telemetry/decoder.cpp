@@ -0,0 +1,238 @@
+#include "decoder.h"
+#include <cstring>
+#include "telemetry_format.h"
+
+namespace telemetry {
+
+namespace {
+
+uint16_t get_u16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+uint32_t get_u32(const uint8_t *p) {
+    return get_u16(p) | (uint32_t(get_u16(p + 2)) << 16);
+}
+
+uint64_t get_u64(const uint8_t *p) {
+    return get_u32(p) | (uint64_t(get_u32(p + 4)) << 32);
+}
+
+size_t record_size(uint8_t type) {
+    switch (type) {
+        case TELEMETRY_SAMPLE_ACC:
+        case TELEMETRY_SAMPLE_MAG:
+        case TELEMETRY_SAMPLE_GYRO:     return TELEMETRY_RECORD_RAW_SIZE;
+        case TELEMETRY_SAMPLE_BARO:     return TELEMETRY_RECORD_BARO_SIZE;
+        case TELEMETRY_SAMPLE_ATTITUDE: return TELEMETRY_RECORD_QUAT_SIZE;
+        default:                        return 0;
+    }
+}
+
+}  // namespace
+
+
+// CRC-16/CCITT-FALSE, the same as crc16() in the firmware
+uint16_t crc16(const uint8_t *data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= uint16_t(data[i]) << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+
+// Undo the byte stuffing, the delimiter must already be stripped
+std::optional<std::vector<uint8_t>> cobs_decode(const uint8_t *data, size_t length) {
+    std::vector<uint8_t> out;
+    out.reserve(length);
+
+    size_t i = 0;
+    while (i < length) {
+        uint8_t code = data[i++];
+        if (code == 0 || i + code - 1 > length) {
+            return std::nullopt;
+        }
+        for (uint8_t j = 1; j < code; j++) {
+            out.push_back(data[i++]);
+        }
+        if (code != 0xFF && i < length) {
+            out.push_back(0);
+        }
+    }
+    return out;
+}
+
+
+namespace {
+
+bool parse_tasks(const std::vector<uint8_t> &bytes, uint8_t count, Frame &frame) {
+    if (bytes.size() != TELEMETRY_HEADER_SIZE + size_t(count) * TELEMETRY_RECORD_TASK_SIZE) {
+        return false;
+    }
+
+    const uint8_t *p = &bytes[TELEMETRY_HEADER_SIZE];
+    for (uint8_t n = 0; n < count; n++, p += TELEMETRY_RECORD_TASK_SIZE) {
+        const char *name = reinterpret_cast<const char *>(p + 2);
+        const uint8_t *stats = p + 2 + TELEMETRY_TASK_NAME_SIZE;
+
+        TaskRecord task;
+        task.number = p[0];
+        task.priority = p[1];
+        task.name.assign(name, strnlen(name, TELEMETRY_TASK_NAME_SIZE));
+        task.cpu_permille = get_u16(stats);
+        task.switches = get_u32(stats + 2);
+        task.max_run_us = get_u32(stats + 6);
+        task.stack_free = get_u16(stats + 10);
+        frame.tasks.push_back(task);
+    }
+    return true;
+}
+
+bool parse_loops(const std::vector<uint8_t> &bytes, uint8_t count, Frame &frame) {
+    if (bytes.size() != TELEMETRY_HEADER_SIZE + size_t(count) * TELEMETRY_RECORD_LOOP_SIZE) {
+        return false;
+    }
+
+    const uint8_t *p = &bytes[TELEMETRY_HEADER_SIZE];
+    for (uint8_t n = 0; n < count; n++, p += TELEMETRY_RECORD_LOOP_SIZE) {
+        const char *name = reinterpret_cast<const char *>(p + 1);
+        const uint8_t *stats = p + 1 + TELEMETRY_TASK_NAME_SIZE;
+
+        LoopRecord loop;
+        loop.index = p[0];
+        loop.name.assign(name, strnlen(name, TELEMETRY_TASK_NAME_SIZE));
+        loop.period_us = get_u32(stats);
+        loop.iterations = get_u32(stats + 4);
+        loop.misses = get_u32(stats + 8);
+        for (int i = 0; i < 3; i++) {
+            loop.period_pct_us[i] = get_u32(stats + 12 + 4 * i);
+            loop.exec_pct_us[i] = get_u32(stats + 24 + 4 * i);
+        }
+        frame.loops.push_back(loop);
+    }
+    return true;
+}
+
+}  // namespace
+
+
+std::optional<Frame> parse_frame(const std::vector<uint8_t> &bytes) {
+    if (bytes.size() < TELEMETRY_HEADER_SIZE) {
+        return std::nullopt;
+    }
+
+    Frame frame;
+    frame.type = bytes[0];
+    frame.sequence = get_u16(&bytes[1]);
+    frame.base_us = get_u64(&bytes[3]);
+    uint8_t count = bytes[11];
+
+    if (frame.type == TELEMETRY_FRAME_TASKS) {
+        if (!parse_tasks(bytes, count, frame)) return std::nullopt;
+        return frame;
+    }
+    if (frame.type == TELEMETRY_FRAME_LOOPS) {
+        if (!parse_loops(bytes, count, frame)) return std::nullopt;
+        return frame;
+    }
+    if (frame.type == TELEMETRY_FRAME_TEXT) {
+        if (bytes.size() != TELEMETRY_HEADER_SIZE + size_t(count)) return std::nullopt;
+        frame.text.assign(bytes.begin() + TELEMETRY_HEADER_SIZE, bytes.end());
+        return frame;
+    }
+    if (frame.type != TELEMETRY_FRAME_SAMPLES) {
+        return std::nullopt;
+    }
+
+    size_t at = TELEMETRY_HEADER_SIZE;
+    for (uint8_t n = 0; n < count; n++) {
+        if (at >= bytes.size()) return std::nullopt;
+
+        size_t size = record_size(bytes[at]);
+        if (size == 0 || at + size > bytes.size()) return std::nullopt;
+
+        const uint8_t *p = &bytes[at];
+        Record record{};
+        record.type = p[0];
+        record.timestamp_us = frame.base_us + int64_t(int32_t(get_u32(p + 1)));
+        p += TELEMETRY_RECORD_PREFIX;
+
+        if (size == TELEMETRY_RECORD_RAW_SIZE) {
+            record.count = 3;
+            for (int i = 0; i < 3; i++) record.data[i] = int16_t(get_u16(p + 2 * i));
+        } else {
+            record.count = (size - TELEMETRY_RECORD_PREFIX) / 4;
+            for (int i = 0; i < record.count; i++) record.data[i] = int32_t(get_u32(p + 4 * i));
+        }
+
+        frame.records.push_back(record);
+        at += size;
+    }
+
+    if (at != bytes.size()) return std::nullopt;
+    return frame;
+}
+
+
+Decoder::Decoder(FrameHandler handler)
+    : handler_(std::move(handler))
+{
+    packet_.reserve(TELEMETRY_MAX_ENCODED);
+}
+
+
+void Decoder::feed(const uint8_t *data, size_t length) {
+    stats_.bytes += length;
+
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] == 0) {
+            end_of_packet();
+            packet_.clear();
+        } else if (packet_.size() < TELEMETRY_MAX_ENCODED) {
+            packet_.push_back(data[i]);
+        } else {
+            // Runaway packet, a delimiter was lost. Wait for the next one.
+            stats_.malformed++;
+            packet_.clear();
+        }
+    }
+}
+
+
+void Decoder::end_of_packet() {
+    if (packet_.empty()) return;
+
+    auto bytes = cobs_decode(packet_.data(), packet_.size());
+    if (!bytes || bytes->size() < TELEMETRY_CRC_SIZE) {
+        stats_.malformed++;
+        return;
+    }
+
+    size_t body = bytes->size() - TELEMETRY_CRC_SIZE;
+    if (crc16(bytes->data(), body) != get_u16(bytes->data() + body)) {
+        stats_.crc_errors++;
+        return;
+    }
+    bytes->resize(body);
+
+    auto frame = parse_frame(*bytes);
+    if (!frame) {
+        stats_.malformed++;
+        return;
+    }
+
+    if (last_sequence_) {
+        stats_.lost_frames += uint16_t(frame->sequence - *last_sequence_ - 1);
+    }
+    last_sequence_ = frame->sequence;
+
+    stats_.frames++;
+    stats_.records += frame->records.size() + frame->tasks.size() + frame->loops.size();
+    handler_(*frame);
+}
+
+}  // namespace telemetry
@@ -0,0 +1,90 @@
+#ifndef TELEMETRY_DECODER_H
+#define TELEMETRY_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+/*
+ * Host side decoder for the firmware's binary telemetry stream
+ * The wire format is described in src/telemetry/telemetry_format.h.
+ */
+namespace telemetry {
+
+struct Record {
+    uint8_t type;
+    uint64_t timestamp_us;
+    uint8_t count;          // values used in data
+    int32_t data[4];
+};
+
+struct TaskRecord {
+    uint8_t number;
+    uint8_t priority;
+    std::string name;
+    uint16_t cpu_permille;
+    uint32_t switches;
+    uint32_t max_run_us;
+    uint16_t stack_free;    // words
+};
+
+struct LoopRecord {
+    uint8_t index;
+    std::string name;
+    uint32_t period_us;
+    uint32_t iterations;
+    uint32_t misses;
+    uint32_t period_pct_us[3];  // p50, p99, max
+    uint32_t exec_pct_us[3];
+};
+
+struct Frame {
+    uint8_t type;
+    uint16_t sequence;
+    uint64_t base_us;
+    std::vector<Record> records;    // sample frames
+    std::vector<TaskRecord> tasks;  // task frames
+    std::vector<LoopRecord> loops;  // loop frames
+    std::string text;               // text frames
+};
+
+struct Stats {
+    uint64_t bytes = 0;
+    uint64_t frames = 0;
+    uint64_t records = 0;
+    uint64_t crc_errors = 0;
+    uint64_t malformed = 0;
+    uint64_t lost_frames = 0;   // from gaps in the sequence numbers
+};
+
+uint16_t crc16(const uint8_t *data, size_t length);
+std::optional<std::vector<uint8_t>> cobs_decode(const uint8_t *data, size_t length);
+
+// Parse one COBS decoded frame, nullopt if it is malformed
+std::optional<Frame> parse_frame(const std::vector<uint8_t> &frame);
+
+class Decoder {
+public:
+    using FrameHandler = std::function<void(const Frame &)>;
+
+    explicit Decoder(FrameHandler handler);
+
+    // Feed any number of bytes, the handler runs for each good frame
+    void feed(const uint8_t *data, size_t length);
+    const Stats &stats() const { return stats_; }
+
+private:
+    void end_of_packet();
+
+    FrameHandler handler_;
+    std::vector<uint8_t> packet_;
+    Stats stats_;
+    std::optional<uint16_t> last_sequence_;
+};
+
+}  // namespace telemetry
+
+#endif
@@ -0,0 +1,166 @@
+/*
+ * Decode the firmware's binary telemetry to CSV
+ *
+ *   telemetry_decode [--scaled] [--stats] <serial device | file | ->
+ *
+ * One line per sample: type,timestamp_us,values... Raw fixed point by
+ * default, --scaled converts to m/s2, gauss, dps, hPa / C / m and unit
+ * quaternions. --stats prints link statistics to stderr at the end.
+ *
+ * Task and loop timing stats go to stderr as tables, once per report from
+ * the firmware, and the console's replies and prompts go to stderr as
+ * they arrive.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include "decoder.h"
+#include "telemetry_format.h"
+
+namespace {
+
+// Sensor scales, must match the drivers in src/sensors/gy89
+const double ACC_MS2_PER_LSB   = 0.122e-3 * 9.81;
+const double MAG_GAUSS_PER_LSB = 0.16e-3;
+const double GYRO_DPS_PER_LSB  = 0.00875;
+
+const char *type_name(uint8_t type) {
+    switch (type) {
+        case TELEMETRY_SAMPLE_ACC:      return "acc";
+        case TELEMETRY_SAMPLE_MAG:      return "mag";
+        case TELEMETRY_SAMPLE_GYRO:     return "gyro";
+        case TELEMETRY_SAMPLE_BARO:     return "baro";
+        case TELEMETRY_SAMPLE_ATTITUDE: return "attitude";
+        default:                        return "unknown";
+    }
+}
+
+void print_raw(const telemetry::Record &record) {
+    printf("%s,%llu", type_name(record.type), (unsigned long long)record.timestamp_us);
+    for (int i = 0; i < record.count; i++) printf(",%ld", (long)record.data[i]);
+    printf("\n");
+}
+
+void print_scaled(const telemetry::Record &record) {
+    double scale[4] = {1, 1, 1, 1};
+    switch (record.type) {
+        case TELEMETRY_SAMPLE_ACC:  scale[0] = scale[1] = scale[2] = ACC_MS2_PER_LSB; break;
+        case TELEMETRY_SAMPLE_MAG:  scale[0] = scale[1] = scale[2] = MAG_GAUSS_PER_LSB; break;
+        case TELEMETRY_SAMPLE_GYRO: scale[0] = scale[1] = scale[2] = GYRO_DPS_PER_LSB; break;
+        case TELEMETRY_SAMPLE_BARO: scale[0] = 0.01; scale[1] = 0.1; scale[2] = 0.01; break;
+        case TELEMETRY_SAMPLE_ATTITUDE:
+            for (double &s : scale) s = 1.0 / (1 << 30);
+            break;
+    }
+
+    printf("%s,%llu", type_name(record.type), (unsigned long long)record.timestamp_us);
+    for (int i = 0; i < record.count; i++) printf(",%.6f", record.data[i] * scale[i]);
+    printf("\n");
+}
+
+void print_tasks(const telemetry::Frame &frame) {
+    // One report may span frames, they share the collection time
+    static uint64_t report_us = UINT64_MAX;
+    if (frame.tasks.empty()) return;
+    if (frame.base_us != report_us) {
+        report_us = frame.base_us;
+        fprintf(stderr, "\ntasks at %.3f s\n%-12s %3s %6s %8s %10s %10s\n",
+                frame.base_us * 1e-6, "Task", "Pri", "CPU%", "Switches", "MaxRun us", "StackFree");
+    }
+    for (const auto &task : frame.tasks) {
+        fprintf(stderr, "%-12s %3u %6.1f %8lu %10lu %10u\n",
+                task.name.c_str(), task.priority, task.cpu_permille * 0.1,
+                (unsigned long)task.switches, (unsigned long)task.max_run_us, task.stack_free);
+    }
+}
+
+void print_loops(const telemetry::Frame &frame) {
+    static uint64_t report_us = UINT64_MAX;
+    if (frame.loops.empty()) return;
+    if (frame.base_us != report_us) {
+        report_us = frame.base_us;
+        fprintf(stderr, "%-12s %8s %10s %8s %26s %26s\n", "Loop", "Period", "Iterations", "Misses",
+                "period p50/p99/max us", "exec p50/p99/max us");
+    }
+    for (const auto &loop : frame.loops) {
+        fprintf(stderr, "%-12s %8lu %10lu %8lu %8lu %8lu %8lu %8lu %8lu %8lu\n",
+                loop.name.c_str(), (unsigned long)loop.period_us,
+                (unsigned long)loop.iterations, (unsigned long)loop.misses,
+                (unsigned long)loop.period_pct_us[0], (unsigned long)loop.period_pct_us[1],
+                (unsigned long)loop.period_pct_us[2], (unsigned long)loop.exec_pct_us[0],
+                (unsigned long)loop.exec_pct_us[1], (unsigned long)loop.exec_pct_us[2]);
+    }
+}
+
+// Serial devices need raw mode or the tty layer mangles the bytes
+void make_raw(int fd) {
+    termios tio;
+    if (tcgetattr(fd, &tio) != 0) return;
+    cfmakeraw(&tio);
+    tcsetattr(fd, TCSANOW, &tio);
+}
+
+int usage(const char *name) {
+    fprintf(stderr, "usage: %s [--scaled] [--stats] <serial device | file | ->\n", name);
+    return 2;
+}
+
+}  // namespace
+
+
+int main(int argc, char **argv) {
+    bool scaled = false;
+    bool show_stats = false;
+    const char *path = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--scaled") == 0) {
+            scaled = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            show_stats = true;
+        } else if (path == nullptr) {
+            path = argv[i];
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (path == nullptr) return usage(argv[0]);
+
+    int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY | O_NOCTTY);
+    if (fd < 0) {
+        perror(path);
+        return 1;
+    }
+    if (isatty(fd)) make_raw(fd);
+
+    telemetry::Decoder decoder([scaled](const telemetry::Frame &frame) {
+        if (!frame.text.empty()) {
+            fwrite(frame.text.data(), 1, frame.text.size(), stderr);
+        }
+        print_tasks(frame);
+        print_loops(frame);
+        for (const auto &record : frame.records) {
+            scaled ? print_scaled(record) : print_raw(record);
+        }
+    });
+
+    uint8_t buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+        decoder.feed(buffer, n);
+    }
+
+    if (show_stats) {
+        const telemetry::Stats &stats = decoder.stats();
+        fprintf(stderr, "bytes %llu, frames %llu, records %llu, crc errors %llu, "
+                        "malformed %llu, lost frames %llu\n",
+                (unsigned long long)stats.bytes, (unsigned long long)stats.frames,
+                (unsigned long long)stats.records, (unsigned long long)stats.crc_errors,
+                (unsigned long long)stats.malformed, (unsigned long long)stats.lost_frames);
+    }
+    return 0;
+}